@@ -4,6 +4,7 @@
 
 #include <dlfcn.h>
 int dl_lmid_swap_tls (Lmid_t lmid, pthread_t *t1, pthread_t *t2);
+int dl_lmid_reset (Lmid_t lmid);
 // custom flags
 
 // dl(m)open() flag. Specifies that the loaded file should be placed in load
@@ -12,6 +13,10 @@ int dl_lmid_swap_tls (Lmid_t lmid, pthread_t *t1, pthread_t *t2);
 // dl(m)open() flag. Specifies that the loaded file should be placed in load
 // order as though it were added via LD_PRELOAD, in this context only.
 #define RTLD_INTERPOSE 0x00040
+// dl(m)open() flag. Keeps a copy of the writable segments of the loaded files
+// so that their namespace can later be returned to its freshly loaded state
+// with dl_lmid_reset().
+#define RTLD_RESETTABLE 0x00080
 
 // dlinfo() flag. Populates info field with the size of the currently used
 // static TLS.
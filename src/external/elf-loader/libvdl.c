@@ -104,3 +104,9 @@ dl_lmid_swap_tls (Lmid_t lmid, pthread_t *t1, pthread_t *t2)
 {
   return vdl_dl_lmid_swap_tls_public (lmid, t1, t2);
 }
+
+EXPORT int
+dl_lmid_reset (Lmid_t lmid)
+{
+  return vdl_dl_lmid_reset_public (lmid);
+}
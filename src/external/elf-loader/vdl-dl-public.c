@@ -97,6 +97,12 @@ vdl_dl_lmid_swap_tls_public (Lmid_t lmid, pthread_t *t1, pthread_t *t2)
   return vdl_dl_lmid_swap_tls (lmid, t1, t2);
 }
 
+EXPORT int
+vdl_dl_lmid_reset_public (Lmid_t lmid)
+{
+  return vdl_dl_lmid_reset (lmid);
+}
+
 
 EXPORT int
 vdl_dl_iterate_phdr_public (int (*callback) (struct dl_phdr_info * info,
@@ -21,7 +21,9 @@
 #include "vdl-unmap.h"
 #include "vdl-init.h"
 #include "vdl-fini.h"
+#include "vdl-mem.h"
 #include "dl.h"
+#include <sys/mman.h>
 
 // reuse glibc flag.
 #define __RTLD_OPENEXEC 0x20000000
@@ -160,6 +162,64 @@ get_post_interpose (struct VdlContext *context, int preload)
   return cur;
 }
 
+static void
+save_pristine_maps (struct VdlFile *file)
+{
+  void **i;
+  for (i = vdl_list_begin (file->maps);
+       i != vdl_list_end (file->maps);
+       i = vdl_list_next (file->maps, i))
+    {
+      struct VdlFileMap *map = *i;
+      unsigned long size = map->mem_size_align - map->mem_anon_size_align;
+      if (!(map->mmap_flags & PROT_WRITE) || map->pristine != 0 || size == 0)
+        {
+          continue;
+        }
+      map->pristine = vdl_alloc_malloc (size);
+      vdl_memcpy (map->pristine, (void *) map->mem_start_align, size);
+    }
+}
+
+// returns false if the file was not opened with RTLD_RESETTABLE
+static bool
+has_pristine_maps (struct VdlFile *file)
+{
+  void **i;
+  for (i = vdl_list_begin (file->maps);
+       i != vdl_list_end (file->maps);
+       i = vdl_list_next (file->maps, i))
+    {
+      struct VdlFileMap *map = *i;
+      unsigned long size = map->mem_size_align - map->mem_anon_size_align;
+      if ((map->mmap_flags & PROT_WRITE) && size != 0 && map->pristine == 0)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+static void
+restore_pristine_maps (struct VdlFile *file)
+{
+  void **i;
+  for (i = vdl_list_begin (file->maps);
+       i != vdl_list_end (file->maps);
+       i = vdl_list_next (file->maps, i))
+    {
+      struct VdlFileMap *map = *i;
+      unsigned long size = map->mem_size_align - map->mem_anon_size_align;
+      if (!(map->mmap_flags & PROT_WRITE) || size == 0)
+        {
+          continue;
+        }
+      vdl_memcpy ((void *) map->mem_start_align, map->pristine, size);
+      vdl_memset ((void *) map->mem_anon_start_align, 0,
+                  map->mem_anon_size_align);
+    }
+}
+
 static void *
 find_main_executable (struct VdlContext *context)
 {
@@ -310,6 +370,14 @@ dlopen_with_context (struct VdlContext *context, const char *filename,
 
   glibc_patch (map.newly_mapped);
 
+  if (flags & RTLD_RESETTABLE)
+    {
+      // the relocated state is what we go back to on reset, so we must
+      // take the copy before any constructor gets to modify it
+      vdl_list_iterate (map.newly_mapped,
+                        (void (*)(void *)) save_pristine_maps);
+    }
+
   // we need to release the lock before calling the initializers
   // to avoid a deadlock if one of them calls dlopen or
   // a symbol resolution function
@@ -944,3 +1012,60 @@ error:
   write_unlock (g_vdl.global_lock);
   return -1;
 }
+
+/* returns all files of the given namespace to the state they were in right
+   after they were loaded, and runs their constructors again. Every file in
+   the namespace must have been opened with RTLD_RESETTABLE.
+   The finalizers are not run, and memory the namespace allocated is not
+   released. The tls of the calling thread is re-initialized, so it is the
+   user's job to ensure that no other thread holds tls of this namespace that
+   will be used again, and that no code of the namespace is still running.
+*/
+int
+vdl_dl_lmid_reset (Lmid_t lmid)
+{
+  VDL_LOG_FUNCTION ("", 0);
+  write_lock (g_vdl.global_lock);
+  struct VdlContext *context = (struct VdlContext *) lmid;
+  if (search_context (context) == 0)
+    {
+      set_error ("dl_lmid_reset: invalid namespace");
+      goto error;
+    }
+  void **cur;
+  // check every file first, so that a failed reset leaves the namespace
+  // untouched instead of partly reset
+  for (cur = vdl_list_begin (context->loaded);
+       cur != vdl_list_end (context->loaded);
+       cur = vdl_list_next (context->loaded, cur))
+    {
+      struct VdlFile *file = *cur;
+      if (!has_pristine_maps (file))
+        {
+          set_error ("dl_lmid_reset: \"%s\" was not opened with RTLD_RESETTABLE",
+                     file->name);
+          goto error;
+        }
+    }
+  for (cur = vdl_list_begin (context->loaded);
+       cur != vdl_list_end (context->loaded);
+       cur = vdl_list_next (context->loaded, cur))
+    {
+      struct VdlFile *file = *cur;
+      restore_pristine_maps (file);
+      file->init_called = 0;
+      file->fini_call_lock = 0;
+      file->fini_called = 0;
+    }
+  vdl_tls_reset_context (context, machine_thread_pointer_get ());
+  struct VdlList *call_init = vdl_sort_call_init (context->loaded);
+  write_unlock (g_vdl.global_lock);
+
+  // like dlopen, we can not hold the lock while the constructors run
+  vdl_init_call (call_init);
+  vdl_list_delete (call_init);
+  return 0;
+error:
+  write_unlock (g_vdl.global_lock);
+  return -1;
+}
@@ -45,6 +45,10 @@ struct VdlFileMap
   // zero-initialized anon pages.
   unsigned long mem_anon_start_align;
   unsigned long mem_anon_size_align;
+  // copy of the file-backed part of a writable map, taken after relocation
+  // but before the constructors ran. Only set for files opened with
+  // RTLD_RESETTABLE, 0 otherwise.
+  void *pristine;
 };
 
 // equivalent of link_map in include/link.h in glibc
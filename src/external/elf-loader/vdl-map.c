@@ -123,6 +123,7 @@ pt_load_to_file_map (const ElfW (Phdr) *phdr)
   map->mmap_flags |= (phdr->p_flags & PF_X) ? PROT_EXEC : 0;
   map->mmap_flags |= (phdr->p_flags & PF_R) ? PROT_READ : 0;
   map->mmap_flags |= (phdr->p_flags & PF_W) ? PROT_WRITE : 0;
+  map->pristine = 0;
   return map;
 }
 
@@ -732,3 +732,57 @@ vdl_tls_swap_context (struct VdlContext *context, unsigned long t1, unsigned lon
   vdl_list_search_on (context->loaded, &args, vdl_tls_swap_file);
   write_unlock (g_vdl.tls_lock);
 }
+
+struct ResetArgs
+{
+  unsigned long t;
+  dtv_t *dtv;
+};
+
+static void *
+vdl_tls_reset_file (void **data, void *aux)
+{
+  struct VdlFile *file = *data;
+  struct ResetArgs *args = aux;
+  void *block;
+
+  if (!file->has_tls)
+    {
+      return 0;
+    }
+
+  if (file->tls_is_static)
+    {
+      block = (void *) args->t + file->tls_offset;
+    }
+  else if (file->tls_index > 0)
+    {
+      // a dynamic block that was not allocated yet will be
+      // initialized from the template when it is first accessed
+      block = args->dtv[file->tls_index].ptrs.value;
+    }
+  else
+    {
+      block = 0;
+    }
+
+  if (block != 0)
+    {
+      vdl_memcpy (block, (void *) file->tls_tmpl_start, file->tls_tmpl_size);
+      vdl_memset (block + file->tls_tmpl_size, 0, file->tls_init_zero_size);
+    }
+  return 0;
+}
+
+void
+vdl_tls_reset_context (struct VdlContext *context, unsigned long t)
+{
+  write_lock (g_vdl.tls_lock);
+  dtv_t *dtv = get_current_dtv (t);
+  vdl_tls_dtv_update_given (t, dtv);
+  struct ResetArgs args;
+  args.t = t;
+  args.dtv = get_current_dtv (t);
+  vdl_list_search_on (context->loaded, &args, vdl_tls_reset_file);
+  write_unlock (g_vdl.tls_lock);
+}
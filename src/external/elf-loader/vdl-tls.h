@@ -39,6 +39,9 @@ unsigned long vdl_tls_get_addr_fast (unsigned long module, unsigned long offset)
 unsigned long vdl_tls_get_addr_slow (unsigned long module, unsigned long offset);
 void vdl_tls_swap_context (struct VdlContext *context,
                            unsigned long t1, unsigned long t2);
+// re-initialize the tls blocks of the thread t for all files of the context
+// from their templates, as if the thread never accessed them
+void vdl_tls_reset_context (struct VdlContext *context, unsigned long t);
 
 // ensure that the caller dtv is uptodate.
 void vdl_tls_dtv_update (void);
@@ -51,7 +51,18 @@ file_delete (struct VdlFile *file, bool mapping)
   vdl_alloc_free (file->name);
   vdl_alloc_free (file->filename);
   vdl_alloc_free (file->phdr);
-  vdl_list_iterate (file->maps, vdl_alloc_free);
+  void **cur;
+  for (cur = vdl_list_begin (file->maps);
+       cur != vdl_list_end (file->maps);
+       cur = vdl_list_next (file->maps, cur))
+    {
+      struct VdlFileMap *map = *cur;
+      if (map->pristine != 0)
+        {
+          vdl_alloc_free (map->pristine);
+        }
+      vdl_alloc_free (map);
+    }
   vdl_list_delete (file->maps);
   rwlock_delete (file->lock);
 
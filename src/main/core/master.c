@@ -15,6 +15,7 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <stddef.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "main/core/logger/shadow_logger.h"
@@ -52,6 +53,8 @@ struct _Master {
     SimulationTime minJumpTimeConfig;
     SimulationTime minJumpTime;
     SimulationTime nextMinJumpTime;
+    /* windows that were longer than the min jump time because of host lookahead */
+    guint64 numExtendedWindows;
 
     /* start of current window of execution */
     SimulationTime executeWindowStart;
@@ -308,9 +311,74 @@ static void _master_registerHostCallback(ConfigurationHostElement* he, Master* m
 
     guint64 quantity = he->quantity.isSet ? he->quantity.integer : 1;
 
-    for(guint64 i = 0; i < quantity; i++) {
-        HostParameters* params = g_new0(HostParameters, 1);
+    /* all instances of this host element share the same parameters except for their
+     * names, so we only resolve them once. the id and seed are set by the slave. */
+    HostParameters params;
+    memset(&params, 0, sizeof(HostParameters));
+
+    /* cpu params - if they didnt specify a CPU frequency, use the slave machine frequency */
+    gint slaveCPUFreq = slave_getRawCPUFrequency(master->slave);
+    params.cpuFrequency = he->cpufrequency.isSet ? he->cpufrequency.integer : (slaveCPUFreq > 0) ? (guint64)slaveCPUFreq : 0;
+    if(params.cpuFrequency == 0) {
+        params.cpuFrequency = 2500000; // 2.5 GHz
+        debug("both configured and raw slave cpu frequencies unavailable, using 2500000 KHz");
+    }
+
+    gint defaultCPUThreshold = options_getCPUThreshold(master->options);
+    params.cpuThreshold = defaultCPUThreshold > 0 ? defaultCPUThreshold : 0;
+    gint defaultCPUPrecision = options_getCPUPrecision(master->options);
+    params.cpuPrecision = defaultCPUPrecision > 0 ? defaultCPUPrecision : 0;
+
+    params.logLevel = he->loglevel.isSet ?
+            loglevel_fromStr(he->loglevel.string->str) :
+            options_getLogLevel(master->options);
+
+    params.heartbeatLogLevel = he->heartbeatloglevel.isSet ?
+            loglevel_fromStr(he->heartbeatloglevel.string->str) :
+            options_getHeartbeatLogLevel(master->options);
+
+    params.heartbeatInterval = he->heartbeatfrequency.isSet ?
+            (SimulationTime)(he->heartbeatfrequency.integer * SIMTIME_ONE_SECOND) :
+            options_getHeartbeatInterval(master->options);
+
+    params.heartbeatLogInfo = he->heartbeatloginfo.isSet ?
+            options_toHeartbeatLogInfo(master->options, he->heartbeatloginfo.string->str) :
+            options_getHeartbeatLogInfo(master->options);
+
+    params.logPcap = (he->logpcap.isSet && !g_ascii_strcasecmp(he->logpcap.string->str, "true")) ? TRUE : FALSE;
+    params.pcapDir = he->pcapdir.isSet ? he->pcapdir.string->str : NULL;
+
+    /* socket buffer settings - if size is set manually, turn off autotuning */
+    params.recvBufSize = he->socketrecvbuffer.isSet ? he->socketrecvbuffer.integer :
+            options_getSocketReceiveBufferSize(master->options);
+    params.autotuneRecvBuf = he->socketrecvbuffer.isSet ? FALSE :
+            options_doAutotuneReceiveBuffer(master->options);
+
+    params.sendBufSize = he->socketsendbuffer.isSet ? he->socketsendbuffer.integer :
+            options_getSocketSendBufferSize(master->options);
+    params.autotuneSendBuf = he->socketsendbuffer.isSet ? FALSE :
+            options_doAutotuneSendBuffer(master->options);
+
+    params.interfaceBufSize = he->interfacebuffer.isSet ? he->interfacebuffer.integer :
+            options_getInterfaceBufferSize(master->options);
+    params.qdisc = options_getQueuingDiscipline(master->options);
+    params.tcpSegmentationOffload = options_doTCPSegmentationOffload(master->options);
+    params.fileWriteBufferSize = (guint64)MAX(options_getFileWriteBufferSize(master->options), 0);
+
+    /* requested attributes from shadow config */
+    params.ipHint = he->ipHint.isSet ? he->ipHint.string->str : NULL;
+    params.countrycodeHint = he->countrycodeHint.isSet ? he->countrycodeHint.string->str : NULL;
+    params.citycodeHint = he->citycodeHint.isSet ? he->citycodeHint.string->str : NULL;
+    params.geocodeHint = he->geocodeHint.isSet ? he->geocodeHint.string->str : NULL;
+    params.typeHint = he->typeHint.isSet ? he->typeHint.string->str : NULL;
+    params.requestedBWDownKiBps = he->bandwidthdown.isSet ? he->bandwidthdown.integer : 0;
+    params.requestedBWUpKiBps = he->bandwidthup.isSet ? he->bandwidthup.integer : 0;
+
+    ProcessCallbackArgs processArgs;
+    processArgs.master = master;
+    processArgs.hostParams = &params;
 
+    for(guint64 i = 0; i < quantity; i++) {
         /* hostname and id params */
         const gchar* hostNameBase = he->id.string->str;
 
@@ -318,76 +386,15 @@ static void _master_registerHostCallback(ConfigurationHostElement* he, Master* m
         if(quantity > 1) {
             g_string_append_printf(hostnameBuffer, "%"G_GUINT64_FORMAT, i+1);
         }
-        params->hostname = hostnameBuffer->str;
-
-        /* cpu params - if they didnt specify a CPU frequency, use the slave machine frequency */
-        gint slaveCPUFreq = slave_getRawCPUFrequency(master->slave);
-        params->cpuFrequency = he->cpufrequency.isSet ? he->cpufrequency.integer : (slaveCPUFreq > 0) ? (guint64)slaveCPUFreq : 0;
-        if(params->cpuFrequency == 0) {
-            params->cpuFrequency = 2500000; // 2.5 GHz
-            debug("both configured and raw slave cpu frequencies unavailable, using 2500000 KHz");
-        }
-
-        gint defaultCPUThreshold = options_getCPUThreshold(master->options);
-        params->cpuThreshold = defaultCPUThreshold > 0 ? defaultCPUThreshold : 0;
-        gint defaultCPUPrecision = options_getCPUPrecision(master->options);
-        params->cpuPrecision = defaultCPUPrecision > 0 ? defaultCPUPrecision : 0;
-
-        params->logLevel = he->loglevel.isSet ?
-                loglevel_fromStr(he->loglevel.string->str) :
-                options_getLogLevel(master->options);
-
-        params->heartbeatLogLevel = he->heartbeatloglevel.isSet ?
-                loglevel_fromStr(he->heartbeatloglevel.string->str) :
-                options_getHeartbeatLogLevel(master->options);
-
-        params->heartbeatInterval = he->heartbeatfrequency.isSet ?
-                (SimulationTime)(he->heartbeatfrequency.integer * SIMTIME_ONE_SECOND) :
-                options_getHeartbeatInterval(master->options);
-
-        params->heartbeatLogInfo = he->heartbeatloginfo.isSet ?
-                options_toHeartbeatLogInfo(master->options, he->heartbeatloginfo.string->str) :
-                options_getHeartbeatLogInfo(master->options);
+        params.hostname = hostnameBuffer->str;
 
-        params->logPcap = (he->logpcap.isSet && !g_ascii_strcasecmp(he->logpcap.string->str, "true")) ? TRUE : FALSE;
-        params->pcapDir = he->pcapdir.isSet ? he->pcapdir.string->str : NULL;
-
-        /* socket buffer settings - if size is set manually, turn off autotuning */
-        params->recvBufSize = he->socketrecvbuffer.isSet ? he->socketrecvbuffer.integer :
-                options_getSocketReceiveBufferSize(master->options);
-        params->autotuneRecvBuf = he->socketrecvbuffer.isSet ? FALSE :
-                options_doAutotuneReceiveBuffer(master->options);
-
-        params->sendBufSize = he->socketsendbuffer.isSet ? he->socketsendbuffer.integer :
-                options_getSocketSendBufferSize(master->options);
-        params->autotuneSendBuf = he->socketsendbuffer.isSet ? FALSE :
-                options_doAutotuneSendBuffer(master->options);
-
-        params->interfaceBufSize = he->interfacebuffer.isSet ? he->interfacebuffer.integer :
-                options_getInterfaceBufferSize(master->options);
-        params->qdisc = options_getQueuingDiscipline(master->options);
-
-        /* requested attributes from shadow config */
-        params->ipHint = he->ipHint.isSet ? he->ipHint.string->str : NULL;
-        params->countrycodeHint = he->countrycodeHint.isSet ? he->countrycodeHint.string->str : NULL;
-        params->citycodeHint = he->citycodeHint.isSet ? he->citycodeHint.string->str : NULL;
-        params->geocodeHint = he->geocodeHint.isSet ? he->geocodeHint.string->str : NULL;
-        params->typeHint = he->typeHint.isSet ? he->typeHint.string->str : NULL;
-        params->requestedBWDownKiBps = he->bandwidthdown.isSet ? he->bandwidthdown.integer : 0;
-        params->requestedBWUpKiBps = he->bandwidthup.isSet ? he->bandwidthup.integer : 0;
-
-        slave_addNewVirtualHost(master->slave, params);
-
-        ProcessCallbackArgs processArgs;
-        processArgs.master = master;
-        processArgs.hostParams = params;
+        slave_addNewVirtualHost(master->slave, &params);
 
         /* now handle each virtual process the host will run */
         g_queue_foreach(he->processes, (GFunc)_master_registerProcessCallback, &processArgs);
 
         /* cleanup for next pass through the loop */
         g_string_free(hostnameBuffer, TRUE);
-        g_free(params);
     }
 }
 
@@ -443,12 +450,16 @@ gint master_run(Master* master) {
     }
 
     message("simulation finished, cleaning up now");
+    if(master->numExtendedWindows > 0) {
+        message("%"G_GUINT64_FORMAT" execution windows were extended past the minimum time jump "
+                "because no host could reach another one sooner", master->numExtendedWindows);
+    }
 
     return slave_free(master->slave);
 }
 
 gboolean master_slaveFinishedCurrentRound(Master* master, SimulationTime minNextEventTime,
-        SimulationTime* executeWindowStart, SimulationTime* executeWindowEnd) {
+        SimulationTime minNextDeliveryTime, SimulationTime* executeWindowStart, SimulationTime* executeWindowEnd) {
     MAGIC_ASSERT(master);
     utility_assert(executeWindowStart && executeWindowEnd);
 
@@ -462,6 +473,14 @@ gboolean master_slaveFinishedCurrentRound(Master* master, SimulationTime minNext
     SimulationTime newStart = minNextEventTime;
     SimulationTime newEnd = minNextEventTime + _master_getMinTimeJump(master);
 
+    /* hosts may not be able to reach anyone else that quickly. nothing can arrive
+     * at another host before the earliest delivery time the workers reported,
+     * so we can safely run up to there instead. */
+    if(minNextDeliveryTime > newEnd && minNextDeliveryTime != SIMTIME_MAX) {
+        newEnd = minNextDeliveryTime;
+        master->numExtendedWindows++;
+    }
+
     /* update the new window end as one interval past the new window start,
      * making sure we dont run over the experiment end time */
     if(newEnd > master->endTime) {
@@ -24,7 +24,7 @@ gint master_run(Master*);
 void master_updateMinTimeJump(Master*, gdouble);
 gdouble master_getRunTimeElapsed(Master*);
 
-gboolean master_slaveFinishedCurrentRound(Master*, SimulationTime, SimulationTime*, SimulationTime*);
+gboolean master_slaveFinishedCurrentRound(Master*, SimulationTime, SimulationTime, SimulationTime*, SimulationTime*);
 gdouble master_getLatency(Master* master, Address* srcAddress, Address* dstAddress);
 
 // TODO remove these eventually since they cant be shared accross remote slaves
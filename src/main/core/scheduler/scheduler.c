@@ -9,6 +9,7 @@
 #include <glib.h>
 #include <math.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stddef.h>
 #include <sys/types.h>
 
@@ -20,7 +21,9 @@
 #include "main/core/worker.h"
 #include "main/host/host.h"
 #include "main/utility/count_down_latch.h"
+#include "main/utility/cpu_topology.h"
 #include "main/utility/random.h"
+#include "main/utility/round_barrier.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
@@ -33,14 +36,26 @@ struct _Scheduler {
 
     /* barrier for worker threads to start and stop running */
     CountDownLatch* startBarrier;
-    CountDownLatch* bootBarrier;
     CountDownLatch* finishBarrier;
-    /* barrier to wait for worker threads to finish processing this round */
-    CountDownLatch* executeEventsBarrier;
-    /* barrier to wait for worker threads to collect info after a round */
-    CountDownLatch* collectInfoBarrier;
-    /* barrier to wait for main thread to finish updating for the next round */
-    CountDownLatch* prepareRoundBarrier;
+    /* workers arrive here when they are done with a round (or with booting their hosts),
+     * and are held until the main thread prepared the next round. the barrier also
+     * computes the minimum next event time over all workers. */
+    RoundBarrier* roundBarrier;
+
+    /* the earliest event each worker pushed for a future round, and the earliest time the
+     * receiver of that event could deliver to another host, indexed by thread id */
+    SimulationTime* minPushedEventTimes;
+    SimulationTime* minPushedDeliveryTimes;
+    /* what each worker reported at the round barrier, indexed by thread id */
+    SimulationTime* nextDeliveryTimes;
+    guint64* numRoundEvents;
+    guint numWorkers;
+
+    /* if set, the workers advance the rounds themselves and the main thread only
+     * waits on roundsDone until they are finished */
+    SchedulerNextRoundFunc nextRound;
+    gpointer nextRoundData;
+    GCond roundsDone;
 
     /* holds a timer for each thread to track how long threads wait for execution barrier */
     GHashTable* threadToWaitTimerMap;
@@ -113,20 +128,105 @@ static void _scheduler_stopHosts(Scheduler* scheduler) {
     }
 }
 
-Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointer threadUserData,
-        guint schedulerSeed, SimulationTime endTime) {
+/* must only be called while all workers are held at the round barrier */
+static void _scheduler_collectRound(Scheduler* scheduler, SimulationTime minNextEventTime,
+        SchedulerRoundInfo* round) {
+    round->minNextEventTime = minNextEventTime;
+    round->minNextDeliveryTime = SIMTIME_MAX;
+    round->numEvents = 0;
+
+    for(guint i = 0; i < scheduler->numWorkers; i++) {
+        round->minNextDeliveryTime = MIN(round->minNextDeliveryTime, scheduler->nextDeliveryTimes[i]);
+        round->numEvents += scheduler->numRoundEvents[i];
+        scheduler->numRoundEvents[i] = 0;
+    }
+}
+
+static void _scheduler_finishRound(Scheduler* scheduler, SimulationTime minNextEventTime) {
+    MAGIC_ASSERT(scheduler);
+
+    /* we are the last worker to arrive at the round barrier, and everyone else
+     * waits until we set up the next round */
+    SchedulerRoundInfo round;
+    _scheduler_collectRound(scheduler, minNextEventTime, &round);
+
+    SimulationTime windowStart = 0, windowEnd = 0;
+    gboolean keepRunning = scheduler->nextRound(scheduler->nextRoundData, &round,
+            &windowStart, &windowEnd);
+
+    g_mutex_lock(&scheduler->globalLock);
+    scheduler->currentRound.minNextEventTime = minNextEventTime;
+    if(keepRunning) {
+        scheduler->currentRound.endTime = windowEnd;
+    } else {
+        /* the workers will exit when they are released */
+        scheduler->isRunning = FALSE;
+        g_cond_broadcast(&scheduler->roundsDone);
+    }
+    g_mutex_unlock(&scheduler->globalLock);
+}
+
+/* fills in the CPUs the worker should run on and their cache domain, and returns their NUMA node */
+static gint _scheduler_getWorkerCPUs(CPUTopology* topology, SchedulerAffinityType affinityType,
+        guint workerIndex, guint nWorkers, cpu_set_t* cpus, gint* cacheDomain) {
+    CPU_ZERO(cpus);
+    gint node = -1;
+    *cacheDomain = -1;
+
+    guint numCPUs = cputopology_getNumCPUs(topology);
+    if(affinityType == SA_CORE) {
+        /* neighboring workers share a node as long as it has enough CPUs */
+        gint cpu = cputopology_getCPU(topology, workerIndex % numCPUs);
+        CPU_SET(cpu, cpus);
+        node = cputopology_getNodeOfCPU(topology, cpu);
+        *cacheDomain = cputopology_getCacheDomainOfCPU(topology, cpu);
+    } else {
+        guint numNodes = cputopology_getNumNodes(topology);
+        node = cputopology_getNode(topology, (workerIndex * numNodes) / nWorkers);
+        for(guint i = 0; i < numCPUs; i++) {
+            gint cpu = cputopology_getCPU(topology, i);
+            if(cputopology_getNodeOfCPU(topology, cpu) == node) {
+                CPU_SET(cpu, cpus);
+            }
+        }
+    }
+
+    return node;
+}
+
+Scheduler* scheduler_new(SchedulerPolicyType policyType, SchedulerAffinityType affinityType,
+        guint nWorkers, gpointer threadUserData,
+        guint schedulerSeed, SimulationTime endTime,
+        SchedulerNextRoundFunc nextRound, gpointer nextRoundData) {
     Scheduler* scheduler = g_new0(Scheduler, 1);
     MAGIC_INIT(scheduler);
 
     /* global lock */
     g_mutex_init(&(scheduler->globalLock));
+    g_cond_init(&(scheduler->roundsDone));
 
     scheduler->startBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->bootBarrier = countdownlatch_new(nWorkers + 1);
     scheduler->finishBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->executeEventsBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->collectInfoBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->prepareRoundBarrier = countdownlatch_new(nWorkers+1);
+    scheduler->numWorkers = nWorkers;
+    if(nWorkers > 0) {
+        if(nextRound) {
+            scheduler->nextRound = nextRound;
+            scheduler->nextRoundData = nextRoundData;
+            scheduler->roundBarrier = roundbarrier_new(nWorkers, FALSE,
+                    (RoundBarrierCompletionFunc)_scheduler_finishRound, scheduler);
+        } else {
+            scheduler->roundBarrier = roundbarrier_new(nWorkers, TRUE, NULL, NULL);
+        }
+        scheduler->minPushedEventTimes = g_new(SimulationTime, nWorkers);
+        scheduler->minPushedDeliveryTimes = g_new(SimulationTime, nWorkers);
+        scheduler->nextDeliveryTimes = g_new(SimulationTime, nWorkers);
+        scheduler->numRoundEvents = g_new0(guint64, nWorkers);
+        for(guint i = 0; i < nWorkers; i++) {
+            scheduler->minPushedEventTimes[i] = SIMTIME_MAX;
+            scheduler->minPushedDeliveryTimes[i] = SIMTIME_MAX;
+            scheduler->nextDeliveryTimes[i] = SIMTIME_MAX;
+        }
+    }
 
     scheduler->endTime = endTime;
     scheduler->currentRound.endTime = scheduler->endTime;// default to one single round
@@ -181,6 +281,16 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
 
     scheduler->threadItems = g_queue_new();
 
+    CPUTopology* topology = NULL;
+    if(affinityType != SA_NONE && nWorkers > 0) {
+        topology = cputopology_new();
+        if(cputopology_getNumCPUs(topology) == 0) {
+            warning("unable to pin worker threads, no CPU information is available");
+            cputopology_free(topology);
+            topology = NULL;
+        }
+    }
+
     /* start up threads and create worker storage, each thread will call worker_new,
      * and wait at startBarrier until we are ready to launch */
     for(gint i = 0; i < nWorkers; i++) {
@@ -200,7 +310,51 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
         runData->notifyReadyToJoin = item->notifyReadyToJoin;
         runData->notifyJoined = item->notifyJoined;
 
-        gint returnVal = pthread_create(&(item->thread), NULL, (void*(*)(void*))worker_run, runData);
+        /* hosts allocate most of their memory from the worker that runs them, so
+         * starting the worker on its CPUs also keeps that memory on the worker's node */
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        gint node = -1;
+        gint cacheDomain = -1;
+        gboolean isPinned = FALSE;
+        if(topology) {
+            cpu_set_t cpus;
+            node = _scheduler_getWorkerCPUs(topology, affinityType, (guint)i, nWorkers, &cpus, &cacheDomain);
+            gint error = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+            if(error == 0) {
+                isPinned = TRUE;
+            } else {
+                warning("unable to pin worker thread %i: %s", i, g_strerror(error));
+            }
+        }
+
+        gint returnVal = pthread_create(&(item->thread), &attr, (void*(*)(void*))worker_run, runData);
+        if(returnVal != 0 && isPinned) {
+            /* the CPUs we picked may not be available to us */
+            warning("unable to start worker thread %i on its CPUs: %s", i, g_strerror(returnVal));
+            pthread_attr_destroy(&attr);
+            pthread_attr_init(&attr);
+            isPinned = FALSE;
+            returnVal = pthread_create(&(item->thread), &attr, (void*(*)(void*))worker_run, runData);
+        }
+        pthread_attr_destroy(&attr);
+
+        if(topology && !isPinned) {
+            /* the steal order must not rely on a placement that did not happen, so
+             * we stop pinning and forget where the earlier workers were placed */
+            warning("falling back to unpinned worker threads");
+            node = -1;
+            cacheDomain = -1;
+            if(scheduler->policy->setThreadLocation) {
+                for(GList* link = g_queue_peek_head_link(scheduler->threadItems); link; link = link->next) {
+                    SchedulerThreadItem* pinnedItem = link->data;
+                    scheduler->policy->setThreadLocation(scheduler->policy, pinnedItem->thread, -1, -1);
+                }
+            }
+            cputopology_free(topology);
+            topology = NULL;
+        }
+
         if(returnVal != 0) {
             critical("unable to create worker thread");
             return NULL;
@@ -212,11 +366,21 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
         }
         utility_assert(item->thread);
 
+        if(scheduler->policy->setThreadLocation) {
+            scheduler->policy->setThreadLocation(scheduler->policy, item->thread, node, cacheDomain);
+        }
+
         g_queue_push_tail(scheduler->threadItems, item);
         shadow_logger_register(shadow_logger_getDefault(), item->thread);
 
         g_string_free(name, TRUE);
     }
+    if(topology) {
+        message("pinned %u worker threads over %u CPU(s) on %u NUMA node(s)", nWorkers,
+                cputopology_getNumCPUs(topology), cputopology_getNumNodes(topology));
+        cputopology_free(topology);
+    }
+
     message("main scheduler thread will operate with %u worker threads", nWorkers);
 
     return scheduler;
@@ -306,13 +470,17 @@ static void _scheduler_free(Scheduler* scheduler) {
 
     g_queue_free(scheduler->threadItems);
 
-    countdownlatch_free(scheduler->executeEventsBarrier);
-    countdownlatch_free(scheduler->collectInfoBarrier);
-    countdownlatch_free(scheduler->prepareRoundBarrier);
+    if(scheduler->roundBarrier) {
+        roundbarrier_free(scheduler->roundBarrier);
+        g_free(scheduler->minPushedEventTimes);
+        g_free(scheduler->minPushedDeliveryTimes);
+        g_free(scheduler->nextDeliveryTimes);
+        g_free(scheduler->numRoundEvents);
+    }
     countdownlatch_free(scheduler->startBarrier);
-    countdownlatch_free(scheduler->bootBarrier);
     countdownlatch_free(scheduler->finishBarrier);
 
+    g_cond_clear(&(scheduler->roundsDone));
     g_mutex_clear(&(scheduler->globalLock));
 
     message("%i worker threads finished", nWorkers);
@@ -353,12 +521,59 @@ gboolean scheduler_push(Scheduler* scheduler, Event* event, Host* sender, Host*
     utility_assert(receiver);
     utility_assert(receiver == event_getHost(event));
 
+    /* workers report their next event time when they arrive at the round barrier, while
+     * others may still be running. the receiver's worker may have already reported, so
+     * the sender accounts for events it pushes beyond the end of the round. */
+    SimulationTime roundEndTime = scheduler->currentRound.endTime;
+    if(scheduler->roundBarrier && worker_isAlive()) {
+        SimulationTime pushedTime = eventTime;
+        if(sender != receiver && pushedTime < roundEndTime) {
+            /* the policy will delay it until the next round */
+            pushedTime = roundEndTime;
+        }
+        if(pushedTime >= roundEndTime) {
+            guint threadID = (guint)worker_getThreadID();
+            utility_assert(threadID < scheduler->numWorkers);
+            scheduler->minPushedEventTimes[threadID] =
+                    MIN(scheduler->minPushedEventTimes[threadID], pushedTime);
+            scheduler->minPushedDeliveryTimes[threadID] =
+                    MIN(scheduler->minPushedDeliveryTimes[threadID], pushedTime + host_getLookahead(receiver));
+        }
+    }
+
     /* push to a queue based on the policy */
-    scheduler->policy->push(scheduler->policy, event, sender, receiver, scheduler->currentRound.endTime);
+    scheduler->policy->push(scheduler->policy, event, sender, receiver, roundEndTime);
 
     return TRUE;
 }
 
+static SimulationTime _scheduler_getNextTime(Scheduler* scheduler, guint threadID) {
+    MAGIC_ASSERT(scheduler);
+    utility_assert(threadID < scheduler->numWorkers);
+
+    /* our queues can now only change through events that other workers push,
+     * which they account for themselves, so we can report our next event time
+     * without waiting for everyone else to finish the round first. */
+    SimulationTime policyNextTime = SIMTIME_MAX;
+    if(scheduler->policy->getNextTime) {
+        policyNextTime = scheduler->policy->getNextTime(scheduler->policy);
+    }
+
+    /* if the policy does not know when its hosts may next send to other hosts,
+     * the next event is the earliest time they could */
+    SimulationTime policyDeliveryTime = policyNextTime;
+    if(scheduler->policy->getNextDeliveryTime) {
+        policyDeliveryTime = scheduler->policy->getNextDeliveryTime(scheduler->policy);
+    }
+
+    SimulationTime nextTime = MIN(scheduler->minPushedEventTimes[threadID], policyNextTime);
+    scheduler->nextDeliveryTimes[threadID] = MIN(scheduler->minPushedDeliveryTimes[threadID], policyDeliveryTime);
+    scheduler->minPushedEventTimes[threadID] = SIMTIME_MAX;
+    scheduler->minPushedDeliveryTimes[threadID] = SIMTIME_MAX;
+
+    return nextTime;
+}
+
 Event* scheduler_pop(Scheduler* scheduler) {
     MAGIC_ASSERT(scheduler);
 
@@ -371,6 +586,13 @@ Event* scheduler_pop(Scheduler* scheduler) {
 
         if(nextEvent != NULL) {
             /* we have an event, let the worker run it */
+            if(scheduler->roundBarrier) {
+                scheduler->numRoundEvents[worker_getThreadID()]++;
+            }
+            if(scheduler->policyType == SP_SERIAL_GLOBAL) {
+                /* the serial run never ends a round, so write out process output as we go */
+                outputsink_flushIfDue(worker_getOutputSink());
+            }
             return nextEvent;
         } else if(scheduler->policyType == SP_SERIAL_GLOBAL) {
             /* the running thread has no more events to execute this round, but we only have a
@@ -382,33 +604,25 @@ Event* scheduler_pop(Scheduler* scheduler) {
              * track idle times, so let's start by making sure we have timer elements in place. */
             GTimer* executeEventsBarrierWaitTime = g_hash_table_lookup(scheduler->threadToWaitTimerMap, GUINT_TO_POINTER(pthread_self()));
 
-            /* wait for all other worker threads to finish their events too, and track wait time */
+            guint threadID = (guint)worker_getThreadID();
+            SimulationTime nextTime = _scheduler_getNextTime(scheduler, threadID);
+
+            /* clear all log messages from the last round */
+            shadow_logger_flushRecords(shadow_logger_getDefault(),
+                                       pthread_self());
+            /* and process output that waited long enough, since the processes
+             * may not write again for a while */
+            outputsink_flushIfDue(worker_getOutputSink());
+
+            /* wait for all other worker threads to finish their events too, and for the main
+             * thread to prepare the next round, and track wait time */
             if(executeEventsBarrierWaitTime) {
                 g_timer_continue(executeEventsBarrierWaitTime);
             }
-            countdownlatch_countDownAwait(scheduler->executeEventsBarrier);
+            roundbarrier_arriveAndAwait(scheduler->roundBarrier, threadID, nextTime);
             if(executeEventsBarrierWaitTime) {
                 g_timer_stop(executeEventsBarrierWaitTime);
             }
-
-            /* now all threads reached the current round end barrier time.
-             * asynchronously collect some stats that the main thread will use. */
-            if(scheduler->policy->getNextTime) {
-                SimulationTime nextTime = scheduler->policy->getNextTime(scheduler->policy);
-                g_mutex_lock(&(scheduler->globalLock));
-                scheduler->currentRound.minNextEventTime = MIN(scheduler->currentRound.minNextEventTime, nextTime);
-                g_mutex_unlock(&(scheduler->globalLock));
-            }
-
-            /* clear all log messages from the last round */
-            shadow_logger_flushRecords(shadow_logger_getDefault(),
-                                       pthread_self());
-
-            /* wait for other threads to finish their collect step */
-            countdownlatch_countDownAwait(scheduler->collectInfoBarrier);
-
-            /* now wait for main thread to process a barrier update for the next round */
-            countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
         }
     }
 
@@ -591,11 +805,13 @@ void scheduler_awaitStart(Scheduler* scheduler) {
     /* each thread will boot their own hosts */
     _scheduler_startHosts(scheduler);
 
-    /* when all hosts are started, the main thread can prepare round 1 */
-    countdownlatch_countDownAwait(scheduler->bootBarrier);
-
-    /* everyone will wait for the next round to be ready */
-    countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+    /* when all hosts are started, round 1 can be prepared (by the main thread, or by
+     * the last worker to arrive), and everyone will wait for it to be ready */
+    if(scheduler->roundBarrier) {
+        guint threadID = (guint)worker_getThreadID();
+        roundbarrier_arriveAndAwait(scheduler->roundBarrier, threadID,
+                _scheduler_getNextTime(scheduler, threadID));
+    }
 }
 
 void scheduler_awaitFinish(Scheduler* scheduler) {
@@ -626,8 +842,10 @@ void scheduler_start(Scheduler* scheduler) {
         /* this will cause all workers to start their hosts in awaitStart */
         countdownlatch_countDownAwait(scheduler->startBarrier);
         /* we wait for the workers to finish starting hosts before preparing
-         * round 1 */
-        countdownlatch_countDownAwait(scheduler->bootBarrier);
+         * round 1, unless they run the rounds without us */
+        if(!scheduler->nextRound) {
+            roundbarrier_awaitArrivals(scheduler->roundBarrier);
+        }
     }
 }
 
@@ -640,33 +858,54 @@ void scheduler_continueNextRound(Scheduler* scheduler, SimulationTime windowStar
     g_mutex_unlock(&scheduler->globalLock);
 
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
+        utility_assert(!scheduler->nextRound);
         /* workers are waiting for preparation of the next round
-         * this will cause them to start running events */
-        countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
-
-        /* workers are running events now, and will wait at executeEventsBarrier
-         * when blocked because there are no more events available in the current round */
-        countdownlatch_reset(scheduler->prepareRoundBarrier);
+         * this will cause them to start running events. they will arrive at the
+         * round barrier again when there are no more events in the current round */
+        roundbarrier_release(scheduler->roundBarrier);
     }
 }
 
-SimulationTime scheduler_awaitNextRound(Scheduler* scheduler) {
+void scheduler_awaitNextRound(Scheduler* scheduler, SchedulerRoundInfo* round) {
     /* Called by the scheduler thread. */
+    utility_assert(round);
+
+    SimulationTime minNextEventTime = SIMTIME_MAX;
 
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
-        /* other workers will also wait at this barrier when they are finished with their events */
-        countdownlatch_countDownAwait(scheduler->executeEventsBarrier);
-        countdownlatch_reset(scheduler->executeEventsBarrier);
-        /* then they collect stats and wait at this barrier */
-        countdownlatch_countDownAwait(scheduler->collectInfoBarrier);
-        countdownlatch_reset(scheduler->collectInfoBarrier);
+        utility_assert(!scheduler->nextRound);
+        /* workers arrive at the barrier when they are finished with their events,
+         * and bring along the time of their next event */
+        minNextEventTime = roundbarrier_awaitArrivals(scheduler->roundBarrier);
+        _scheduler_collectRound(scheduler, minNextEventTime, round);
+    } else {
+        round->minNextEventTime = minNextEventTime;
+        round->minNextDeliveryTime = SIMTIME_MAX;
+        round->numEvents = 0;
     }
 
-    SimulationTime minNextEventTime = SIMTIME_MAX;
     g_mutex_lock(&scheduler->globalLock);
-    minNextEventTime = scheduler->currentRound.minNextEventTime;
+    scheduler->currentRound.minNextEventTime = minNextEventTime;
     g_mutex_unlock(&scheduler->globalLock);
-    return minNextEventTime;
+}
+
+gboolean scheduler_awaitRounds(Scheduler* scheduler, gint64 timeoutMicros) {
+    /* Called by the scheduler thread when the workers advance the rounds themselves.
+     * Returns TRUE if they are still running rounds after the timeout. */
+    MAGIC_ASSERT(scheduler);
+
+    gint64 deadline = g_get_monotonic_time() + timeoutMicros;
+
+    g_mutex_lock(&scheduler->globalLock);
+    while(scheduler->isRunning) {
+        if(!g_cond_wait_until(&scheduler->roundsDone, &scheduler->globalLock, deadline)) {
+            break;
+        }
+    }
+    gboolean isRunning = scheduler->isRunning;
+    g_mutex_unlock(&scheduler->globalLock);
+
+    return isRunning;
 }
 
 void scheduler_finish(Scheduler* scheduler) {
@@ -677,8 +916,11 @@ void scheduler_finish(Scheduler* scheduler) {
 
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
         /* wake up threads from their waiting for the next round.
-         * because isRunning is now false, they will all exit and wait at finishBarrier */
-        countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+         * because isRunning is now false, they will all exit and wait at finishBarrier.
+         * if the workers ran the rounds themselves, they already left. */
+        if(!scheduler->nextRound) {
+            roundbarrier_release(scheduler->roundBarrier);
+        }
 
         /* wait for them to be ready to finish */
         countdownlatch_countDownAwait(scheduler->finishBarrier);
@@ -16,8 +16,38 @@
 
 typedef struct _Scheduler Scheduler;
 
-Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointer threadUserData,
-        guint schedulerSeed, SimulationTime endTime);
+typedef enum {
+    /* workers may run on any CPU */
+    SA_NONE,
+    /* each worker is pinned to its own CPU, filling up one NUMA node after another */
+    SA_CORE,
+    /* each worker is pinned to all CPUs of a NUMA node, with workers spread evenly over nodes */
+    SA_NODE,
+} SchedulerAffinityType;
+
+/* what the workers reported at the end of a round */
+typedef struct _SchedulerRoundInfo SchedulerRoundInfo;
+struct _SchedulerRoundInfo {
+    /* the earliest event of any host */
+    SimulationTime minNextEventTime;
+    /* the earliest time at which any host may deliver an event to another host */
+    SimulationTime minNextDeliveryTime;
+    /* the number of events the workers ran in the round */
+    guint64 numEvents;
+};
+
+/* computes the next execution window from what the workers reported,
+ * and returns FALSE if the simulation should stop instead */
+typedef gboolean (*SchedulerNextRoundFunc)(gpointer userData, const SchedulerRoundInfo* round,
+        SimulationTime* windowStart, SimulationTime* windowEnd);
+
+/* if nextRound is given, the last worker to finish a round runs it and starts the next
+ * round right away. otherwise, the main thread coordinates each round using
+ * scheduler_continueNextRound and scheduler_awaitNextRound. */
+Scheduler* scheduler_new(SchedulerPolicyType policyType, SchedulerAffinityType affinityType,
+        guint nWorkers, gpointer threadUserData,
+        guint schedulerSeed, SimulationTime endTime,
+        SchedulerNextRoundFunc nextRound, gpointer nextRoundData);
 void scheduler_ref(Scheduler*);
 void scheduler_unref(Scheduler*);
 void scheduler_shutdown(Scheduler* scheduler);
@@ -26,7 +56,8 @@ void scheduler_awaitStart(Scheduler*);
 void scheduler_awaitFinish(Scheduler*);
 void scheduler_start(Scheduler*);
 void scheduler_continueNextRound(Scheduler*, SimulationTime, SimulationTime);
-SimulationTime scheduler_awaitNextRound(Scheduler*);
+void scheduler_awaitNextRound(Scheduler*, SchedulerRoundInfo* round);
+gboolean scheduler_awaitRounds(Scheduler*, gint64 timeoutMicros);
 void scheduler_finish(Scheduler*);
 
 gboolean scheduler_push(Scheduler*, Event*, Host* sender, Host* receiver);
@@ -35,6 +35,8 @@ typedef GQueue* (*SchedulerPolicyGetHostsFunc)(SchedulerPolicy*);
 typedef void (*SchedulerPolicyPushFunc)(SchedulerPolicy*, Event*, Host*, Host*, SimulationTime);
 typedef Event* (*SchedulerPolicyPopFunc)(SchedulerPolicy*, SimulationTime);
 typedef SimulationTime (*SchedulerPolicyGetNextTimeFunc)(SchedulerPolicy*);
+typedef SimulationTime (*SchedulerPolicyGetNextDeliveryTimeFunc)(SchedulerPolicy*);
+typedef void (*SchedulerPolicySetThreadLocationFunc)(SchedulerPolicy*, pthread_t, gint, gint);
 typedef void (*SchedulerPolicyFreeFunc)(SchedulerPolicy*);
 
 struct _SchedulerPolicy {
@@ -46,6 +48,12 @@ struct _SchedulerPolicy {
     SchedulerPolicyPushFunc push;
     SchedulerPolicyPopFunc pop;
     SchedulerPolicyGetNextTimeFunc getNextTime;
+    /* optional, the earliest time at which the calling thread's hosts may deliver an
+     * event to another host, as found by the last call to getNextTime on that thread */
+    SchedulerPolicyGetNextDeliveryTimeFunc getNextDeliveryTime;
+    /* optional, tells the policy on which NUMA node and in which cache domain
+     * a worker thread runs; either may be -1 if unknown */
+    SchedulerPolicySetThreadLocationFunc setThreadLocation;
     SchedulerPolicyFreeFunc free;
     MAGIC_DECLARE;
 };
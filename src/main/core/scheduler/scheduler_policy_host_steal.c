@@ -5,7 +5,6 @@
 
 #include <glib.h>
 #include <pthread.h>
-#include <stdbool.h>
 #include <string.h>
 
 #include "main/core/scheduler/scheduler_policy.h"
@@ -23,6 +22,52 @@ struct _HostStealQueueData {
     SimulationTime lastEventTime;
     gsize nPushed;
     gsize nPopped;
+    /* the time of the next event in the queue, or SIMTIME_MAX if it is empty. it is updated
+     * whenever the queue changes, so that it can be read without locking the queue. */
+    SimulationTime nextEventTime;
+    /* protected by the calendar lock, but only set while also holding our lock */
+    gboolean isSleeping;
+    /* the time of our valid alarm in the calendar, or SIMTIME_MAX if we have none */
+    SimulationTime wakeTime;
+};
+
+/* an entry in the calendar of sleeping hosts. the alarm is stale if the host was
+ * woken up, or if it got an earlier alarm since. */
+typedef struct _HostStealAlarm HostStealAlarm;
+struct _HostStealAlarm {
+    SimulationTime time;
+    Host* host;
+    HostStealQueueData* qdata;
+};
+
+/* hosts with nothing to do for a while sleep here instead of moving through the
+ * thread queues every round, so each round only touches the hosts that are due */
+typedef struct _HostStealCalendar HostStealCalendar;
+struct _HostStealCalendar {
+    GMutex lock;
+    /* HostStealAlarms, earliest first */
+    PriorityQueue* alarms;
+    /* all sleeping hosts, including those with no events that have no alarm */
+    GHashTable* sleepingHosts;
+    /* bound over every host that ever slept, used to plan conservatively */
+    SimulationTime minLookahead;
+    /* the last round whose due hosts were woken up */
+    SimulationTime wakeBarrier;
+    gsize nSleeps;
+    gsize nWakeups;
+};
+
+/* how close a victim is to the thief, nearest first */
+typedef enum _HostStealTier HostStealTier;
+enum _HostStealTier {
+    HST_SAME_CACHE, HST_SAME_NODE, HST_REMOTE, HST_NUM_TIERS,
+};
+
+/* where a pinned thread runs */
+typedef struct _HostStealLocation HostStealLocation;
+struct _HostStealLocation {
+    gint node;
+    gint cacheDomain;
 };
 
 typedef struct _HostStealThreadData HostStealThreadData;
@@ -37,13 +82,27 @@ struct _HostStealThreadData {
     GQueue* processedHosts;
     /* the host this worker is running; belongs to neither unprocessedHosts nor processedHosts */
     Host* runningHost;
+    /* the barrier of the round for which our workload is ready to be stolen */
     SimulationTime currentBarrier;
     GTimer* pushIdleTime;
     GTimer* popIdleTime;
     /* which worker thread this is */
     guint tnumber;
+    /* where the thread is pinned to, or -1 */
+    HostStealLocation location;
+    /* the other threads, ordered by HostStealTier, and where each tier ends */
+    GArray* victims;
+    guint victimTierEnds[HST_NUM_TIERS];
+    /* shuffles the victims within each tier */
+    GRand* victimRandom;
+    /* steal statistics, only updated by this thread */
+    gsize nStealAttempts;
+    gsize nSteals;
+    gsize nCrossNodeSteals;
+    GTimer* stealTime;
+    /* the earliest time our hosts may deliver to another host, as of the last getNextTime */
+    SimulationTime nextDeliveryTime;
     GMutex lock;
-    bool isStealable;
 };
 
 typedef struct _HostStealPolicyData HostStealPolicyData;
@@ -53,6 +112,9 @@ struct _HostStealPolicyData {
     GHashTable* hostToQueueDataMap;
     GHashTable* threadToThreadDataMap;
     GHashTable* hostToThreadMap;
+    /* the HostStealLocation of each pinned thread */
+    GHashTable* threadToLocationMap;
+    HostStealCalendar calendar;
     GRWLock lock;
     MAGIC_DECLARE;
 };
@@ -61,6 +123,7 @@ typedef struct _HostStealSearchState HostStealSearchState;
 struct _HostStealSearchState {
     HostStealPolicyData* data;
     SimulationTime nextEventTime;
+    SimulationTime nextDeliveryTime;
 };
 
 static HostStealThreadData* _hoststealthreaddata_new() {
@@ -77,6 +140,12 @@ static HostStealThreadData* _hoststealthreaddata_new() {
     g_timer_stop(tdata->pushIdleTime);
     tdata->popIdleTime = g_timer_new();
     g_timer_stop(tdata->popIdleTime);
+    tdata->stealTime = g_timer_new();
+    g_timer_stop(tdata->stealTime);
+    tdata->victims = g_array_new(FALSE, FALSE, sizeof(HostStealThreadData*));
+    tdata->location.node = -1;
+    tdata->location.cacheDomain = -1;
+    tdata->nextDeliveryTime = SIMTIME_MAX;
     g_mutex_init(&(tdata->lock));
     tdata->runningHost = NULL;
     return tdata;
@@ -104,10 +173,24 @@ static void _hoststealthreaddata_free(HostStealThreadData* tdata) {
             totalPopWaitTime = g_timer_elapsed(tdata->popIdleTime, NULL);
             g_timer_destroy(tdata->popIdleTime);
         }
+        gdouble totalStealTime = 0.0;
+        if(tdata->stealTime) {
+            totalStealTime = g_timer_elapsed(tdata->stealTime, NULL);
+            g_timer_destroy(tdata->stealTime);
+        }
+        if(tdata->victims) {
+            g_array_free(tdata->victims, TRUE);
+        }
+        if(tdata->victimRandom) {
+            g_rand_free(tdata->victimRandom);
+        }
 
-        g_free(tdata);
         message("scheduler thread data destroyed, total push wait time was %f seconds, "
                 "total pop wait time was %f seconds", totalPushWaitTime, totalPopWaitTime);
+        message("scheduler thread %u stole %"G_GSIZE_FORMAT" hosts in %"G_GSIZE_FORMAT" attempts "
+                "(%"G_GSIZE_FORMAT" from other NUMA nodes), total steal time was %f seconds",
+                tdata->tnumber, tdata->nSteals, tdata->nStealAttempts, tdata->nCrossNodeSteals, totalStealTime);
+        g_free(tdata);
     }
 }
 
@@ -116,6 +199,8 @@ static HostStealQueueData* _hoststealqueuedata_new() {
 
     g_mutex_init(&(qdata->lock));
     qdata->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    qdata->nextEventTime = SIMTIME_MAX;
+    qdata->wakeTime = SIMTIME_MAX;
 
     return qdata;
 }
@@ -130,6 +215,105 @@ static void _hoststealqueuedata_free(HostStealQueueData* qdata) {
     }
 }
 
+/* must be called with the queue lock held, after every change to the queue */
+static void _hoststealqueuedata_updateNextEventTime(HostStealQueueData* qdata) {
+    Event* event = priorityqueue_peek(qdata->pq);
+    SimulationTime nextEventTime = (event != NULL) ? event_getTime(event) : SIMTIME_MAX;
+    __atomic_store_n(&qdata->nextEventTime, nextEventTime, __ATOMIC_RELAXED);
+}
+
+static gint _hoststealalarm_compare(const HostStealAlarm* a, const HostStealAlarm* b, gpointer userData) {
+    return a->time > b->time ? +1 : a->time == b->time ? 0 : -1;
+}
+
+/* must be called with the calendar lock held */
+static void _hoststealcalendar_setAlarm(HostStealCalendar* calendar, Host* host,
+        HostStealQueueData* qdata, SimulationTime time) {
+    qdata->wakeTime = time;
+    if(time != SIMTIME_MAX) {
+        HostStealAlarm* alarm = g_new0(HostStealAlarm, 1);
+        alarm->time = time;
+        alarm->host = host;
+        alarm->qdata = qdata;
+        priorityqueue_push(calendar->alarms, alarm);
+    }
+}
+
+/* must be called with the calendar lock held. drops stale alarms from the front
+ * of the calendar, so that the returned alarm is valid. */
+static HostStealAlarm* _hoststealcalendar_peek(HostStealCalendar* calendar) {
+    HostStealAlarm* alarm = NULL;
+    while((alarm = priorityqueue_peek(calendar->alarms)) != NULL) {
+        if(alarm->qdata->isSleeping && alarm->qdata->wakeTime == alarm->time) {
+            return alarm;
+        }
+        g_free(priorityqueue_pop(calendar->alarms));
+    }
+    return NULL;
+}
+
+/* must be called with the host's queue lock held, after the host ran out of events
+ * for the round. returns TRUE if the host now sleeps in the calendar. */
+static gboolean _hoststealcalendar_trySleep(HostStealCalendar* calendar, Host* host,
+        HostStealQueueData* qdata, SimulationTime barrier) {
+    SimulationTime nextEventTime = qdata->nextEventTime;
+    if(nextEventTime != SIMTIME_MAX &&
+            (nextEventTime < barrier || nextEventTime - barrier < CONFIG_HOST_SLEEP_THRESHOLD)) {
+        /* the host is due again soon, keeping it in the thread queues is cheaper */
+        return FALSE;
+    }
+
+    g_mutex_lock(&calendar->lock);
+    __atomic_store_n(&qdata->isSleeping, TRUE, __ATOMIC_RELAXED);
+    g_hash_table_add(calendar->sleepingHosts, host);
+    _hoststealcalendar_setAlarm(calendar, host, qdata, nextEventTime);
+    calendar->minLookahead = MIN(calendar->minLookahead, host_getLookahead(host));
+    calendar->nSleeps++;
+    g_mutex_unlock(&calendar->lock);
+
+    return TRUE;
+}
+
+/* must be called with the host's queue lock held, after an event was pushed */
+static void _hoststealcalendar_updateAlarm(HostStealCalendar* calendar, Host* host, HostStealQueueData* qdata) {
+    /* hosts are only put to sleep while holding their queue lock, which we hold */
+    if(!__atomic_load_n(&qdata->isSleeping, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    g_mutex_lock(&calendar->lock);
+    if(qdata->isSleeping && qdata->nextEventTime < qdata->wakeTime) {
+        /* the old alarm becomes stale and is dropped when it reaches the front */
+        _hoststealcalendar_setAlarm(calendar, host, qdata, qdata->nextEventTime);
+    }
+    g_mutex_unlock(&calendar->lock);
+}
+
+/* moves the hosts that are due before the barrier into the given queue */
+static void _hoststealcalendar_wakeHosts(HostStealCalendar* calendar, GQueue* hosts, SimulationTime barrier) {
+    /* the first thread to start the round wakes everyone up */
+    if(__atomic_load_n(&calendar->wakeBarrier, __ATOMIC_ACQUIRE) >= barrier) {
+        return;
+    }
+
+    g_mutex_lock(&calendar->lock);
+    if(calendar->wakeBarrier < barrier) {
+        HostStealAlarm* alarm = NULL;
+        while((alarm = _hoststealcalendar_peek(calendar)) != NULL && alarm->time < barrier) {
+            priorityqueue_pop(calendar->alarms);
+            __atomic_store_n(&alarm->qdata->isSleeping, FALSE, __ATOMIC_RELAXED);
+            alarm->qdata->wakeTime = SIMTIME_MAX;
+            g_hash_table_remove(calendar->sleepingHosts, alarm->host);
+            g_queue_push_tail(hosts, alarm->host);
+            calendar->nWakeups++;
+            g_free(alarm);
+        }
+
+        __atomic_store_n(&calendar->wakeBarrier, barrier, __ATOMIC_RELEASE);
+    }
+    g_mutex_unlock(&calendar->lock);
+}
+
 /* this must be run synchronously, or the thread must be protected by locks */
 static void _schedulerpolicyhoststeal_addHost(SchedulerPolicy* policy, Host* host, pthread_t randomThread) {
     MAGIC_ASSERT(policy);
@@ -152,8 +336,13 @@ static void _schedulerpolicyhoststeal_addHost(SchedulerPolicy* policy, Host* hos
     if(!tdata) {
         tdata = _hoststealthreaddata_new();
         g_rw_lock_writer_lock(&data->lock);
+        HostStealLocation* location = g_hash_table_lookup(data->threadToLocationMap, GUINT_TO_POINTER(assignedThread));
+        if(location) {
+            tdata->location = *location;
+        }
         g_hash_table_replace(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread), tdata);
         tdata->tnumber = data->threadCount;
+        tdata->victimRandom = g_rand_new_with_seed((guint32)tdata->tnumber);
         data->threadCount++;
         g_array_append_val(data->threadList, tdata);
     } else {
@@ -210,17 +399,38 @@ static GQueue* _schedulerpolicyhoststeal_getHosts(SchedulerPolicy* policy) {
     if(!tdata) {
         return NULL;
     }
-    if(g_queue_is_empty(tdata->unprocessedHosts)) {
-        return tdata->processedHosts;
+
+    /* sleeping hosts still belong to the thread they were last assigned to */
+    GQueue* sleepingHosts = g_queue_new();
+    g_mutex_lock(&data->calendar.lock);
+    g_rw_lock_reader_lock(&data->lock);
+    GHashTableIter iter;
+    gpointer host;
+    g_hash_table_iter_init(&iter, data->calendar.sleepingHosts);
+    while(g_hash_table_iter_next(&iter, &host, NULL)) {
+        if((pthread_t)g_hash_table_lookup(data->hostToThreadMap, host) == pthread_self()) {
+            g_queue_push_tail(sleepingHosts, host);
+        }
     }
-    if(g_queue_is_empty(tdata->processedHosts)) {
-        return tdata->unprocessedHosts;
+    g_rw_lock_reader_unlock(&data->lock);
+    g_mutex_unlock(&data->calendar.lock);
+
+    if(g_queue_is_empty(sleepingHosts)) {
+        g_queue_free(sleepingHosts);
+        if(g_queue_is_empty(tdata->unprocessedHosts)) {
+            return tdata->processedHosts;
+        }
+        if(g_queue_is_empty(tdata->processedHosts)) {
+            return tdata->unprocessedHosts;
+        }
     }
     if(tdata->allHosts) {
         g_queue_free(tdata->allHosts);
     }
     tdata->allHosts = g_queue_copy(tdata->processedHosts);
     g_queue_foreach(tdata->unprocessedHosts, (GFunc)concat_queue_iter, tdata->allHosts);
+    g_queue_foreach(sleepingHosts, (GFunc)concat_queue_iter, tdata->allHosts);
+    g_queue_free(sleepingHosts);
     return tdata->allHosts;
 }
 
@@ -265,6 +475,8 @@ static void _schedulerpolicyhoststeal_push(SchedulerPolicy* policy, Event* event
     /* 'deliver' the event to the destination queue */
     priorityqueue_push(qdata->pq, event);
     qdata->nPushed++;
+    _hoststealqueuedata_updateNextEventTime(qdata);
+    _hoststealcalendar_updateAlarm(&data->calendar, dstHost, qdata);
 
     /* release the destination queue lock */
     g_mutex_unlock(&(qdata->lock));
@@ -301,6 +513,7 @@ static Event* _schedulerpolicyhoststeal_popFromThread(SchedulerPolicy* policy, H
             qdata->lastEventTime = eventTime;
             nextEvent = priorityqueue_pop(qdata->pq);
             qdata->nPopped++;
+            _hoststealqueuedata_updateNextEventTime(qdata);
             /* migrate iff a migration is needed */
             _schedulerpolicyhoststeal_migrateHost(policy, host, pthread_self());
         } else {
@@ -308,8 +521,11 @@ static Event* _schedulerpolicyhoststeal_popFromThread(SchedulerPolicy* policy, H
         }
 
         if(nextEvent == NULL) {
-            /* no more events on the runningHost, mark it as NULL so we get a new one */
-            g_queue_push_tail(tdata->processedHosts, host);
+            /* no more events on the runningHost, mark it as NULL so we get a new one.
+             * if it has nothing to do for a while, it sleeps until it is due again. */
+            if(!_hoststealcalendar_trySleep(&data->calendar, host, qdata, barrier)) {
+                g_queue_push_tail(tdata->processedHosts, host);
+            }
             tdata->runningHost = NULL;
         }
 
@@ -324,6 +540,96 @@ static Event* _schedulerpolicyhoststeal_popFromThread(SchedulerPolicy* policy, H
     return NULL;
 }
 
+static Event* _schedulerpolicyhoststeal_stealFromThread(SchedulerPolicy* policy, HostStealThreadData* tdata,
+        HostStealThreadData* stolenTdata, SimulationTime barrier) {
+    /* Make sure the workload has been updated for this round.
+     * This is preventing race conditions upon the start of each round,
+     * and since we don't expect it to take long for the other threads to run
+     * through the unprocessedHosts reset above, spinning is OK. Comparing against
+     * the barrier means nobody needs to reset a flag between rounds, so a thread
+     * may report its next event time while others are still stealing. */
+    while (__atomic_load_n(&stolenTdata->currentBarrier, __ATOMIC_ACQUIRE) < barrier) {
+    };
+
+    /* We don't need a lock here, because we're only reading, and a misread just means either
+     * we read as empty when it's not, in which case the assigned thread (or one of the others)
+     * will pick it up anyway, or it reads as non-empty when it is empty, in which case we'll
+     * just get a NULL event and move on. Accepting this reduces lock contention towards the end
+     * of every round. */
+    if(g_queue_is_empty(stolenTdata->unprocessedHosts)) {
+        return NULL;
+    }
+    /* We need to lock the thread we're stealing from, to be sure that we're not stealing
+     * something already being stolen, as well as our own lock, to be sure nobody steals
+     * what we just stole. But we also need to do this in a well-ordered manner, to
+     * prevent deadlocks. To do this, we always lock the lock with the smaller thread
+     * number first. */
+    g_timer_continue(tdata->popIdleTime);
+    if(tdata->tnumber < stolenTdata->tnumber) {
+        g_mutex_lock(&(tdata->lock));
+        g_mutex_lock(&(stolenTdata->lock));
+    } else {
+        g_mutex_lock(&(stolenTdata->lock));
+        g_mutex_lock(&(tdata->lock));
+    }
+    g_timer_stop(tdata->popIdleTime);
+
+    /* attempt to get event from the other thread's queue, likely moving a host from its
+     * unprocessedHosts into this threads runningHost (and eventually processedHosts) */
+    Event* nextEvent = _schedulerpolicyhoststeal_popFromThread(policy, tdata, stolenTdata->unprocessedHosts, barrier);
+
+    /* must unlock in reverse order of locking */
+    if(tdata->tnumber < stolenTdata->tnumber) {
+        g_mutex_unlock(&(stolenTdata->lock));
+        g_mutex_unlock(&(tdata->lock));
+    } else {
+        g_mutex_unlock(&(tdata->lock));
+        g_mutex_unlock(&(stolenTdata->lock));
+    }
+
+    return nextEvent;
+}
+
+static HostStealTier _schedulerpolicyhoststeal_getTier(HostStealThreadData* tdata, HostStealThreadData* victim) {
+    if(tdata->location.node != victim->location.node) {
+        return HST_REMOTE;
+    } else if(tdata->location.cacheDomain >= 0 && tdata->location.cacheDomain == victim->location.cacheDomain) {
+        return HST_SAME_CACHE;
+    } else {
+        return HST_SAME_NODE;
+    }
+}
+
+/* must be called with the data lock held for reading */
+static void _schedulerpolicyhoststeal_orderVictims(HostStealPolicyData* data, HostStealThreadData* tdata) {
+    g_array_set_size(tdata->victims, 0);
+
+    for(HostStealTier tier = 0; tier < HST_NUM_TIERS; tier++) {
+        for(guint i = 0; i < data->threadCount; i++) {
+            HostStealThreadData* victim = g_array_index(data->threadList, HostStealThreadData*, i);
+            if(victim != tdata && _schedulerpolicyhoststeal_getTier(tdata, victim) == tier) {
+                g_array_append_val(tdata->victims, victim);
+            }
+        }
+        tdata->victimTierEnds[tier] = tdata->victims->len;
+    }
+}
+
+/* so that thieves in the same tier don't all go after the same victim first */
+static void _schedulerpolicyhoststeal_shuffleVictims(HostStealThreadData* tdata) {
+    guint start = 0;
+    for(HostStealTier tier = 0; tier < HST_NUM_TIERS; tier++) {
+        guint end = tdata->victimTierEnds[tier];
+        for(guint i = end; i > start + 1; i--) {
+            guint j = (guint)g_rand_int_range(tdata->victimRandom, (gint32)start, (gint32)i);
+            HostStealThreadData* swap = g_array_index(tdata->victims, HostStealThreadData*, i - 1);
+            g_array_index(tdata->victims, HostStealThreadData*, i - 1) = g_array_index(tdata->victims, HostStealThreadData*, j);
+            g_array_index(tdata->victims, HostStealThreadData*, j) = swap;
+        }
+        start = end;
+    }
+}
+
 static Event* _schedulerpolicyhoststeal_pop(SchedulerPolicy* policy, SimulationTime barrier) {
     MAGIC_ASSERT(policy);
     HostStealPolicyData* data = policy->data;
@@ -345,8 +651,6 @@ static Event* _schedulerpolicyhoststeal_pop(SchedulerPolicy* policy, SimulationT
     g_timer_stop(tdata->popIdleTime);
 
     if(barrier > tdata->currentBarrier) {
-        tdata->currentBarrier = barrier;
-
         /* make sure all of the hosts that were processed last time get processed in the next round */
         if(g_queue_is_empty(tdata->unprocessedHosts) && !g_queue_is_empty(tdata->processedHosts)) {
             GQueue* swap = tdata->unprocessedHosts;
@@ -357,9 +661,10 @@ static Event* _schedulerpolicyhoststeal_pop(SchedulerPolicy* policy, SimulationT
                 g_queue_push_tail(tdata->unprocessedHosts, g_queue_pop_head(tdata->processedHosts));
             }
         }
+        _hoststealcalendar_wakeHosts(&data->calendar, tdata->unprocessedHosts, barrier);
 
         /* we are now ready for other threads to steal our workload */
-        __atomic_store_n(&tdata->isStealable, true, __ATOMIC_RELEASE);
+        __atomic_store_n(&tdata->currentBarrier, barrier, __ATOMIC_RELEASE);
     }
     /* attempt to get an event from this thread's queue */
     Event* nextEvent = _schedulerpolicyhoststeal_popFromThread(policy, tdata, tdata->unprocessedHosts, barrier);
@@ -368,65 +673,30 @@ static Event* _schedulerpolicyhoststeal_pop(SchedulerPolicy* policy, SimulationT
         return nextEvent;
     }
 
-    /* no more hosts with events on this thread, try to steal a host from the other threads' queues */
-    GHashTableIter iter;
-    gpointer key, value;
+    /* no more hosts with events on this thread, try to steal a host from the other threads' queues.
+     * a stolen host keeps its memory and cache footprint where it last ran, so we first try the
+     * threads sharing our cache, then the ones on our NUMA node, and only then the remote ones. */
     g_rw_lock_reader_lock(&data->lock);
-    guint i, n = data->threadCount;
+    if(tdata->victims->len + 1 != data->threadCount) {
+        _schedulerpolicyhoststeal_orderVictims(data, tdata);
+    }
     g_rw_lock_reader_unlock(&data->lock);
-    for(i = 1; i < n; i++) {
-        guint stolenTnumber = (i + tdata->tnumber) % n;
-        g_rw_lock_reader_lock(&data->lock);
-        HostStealThreadData* stolenTdata = g_array_index(data->threadList, HostStealThreadData*, stolenTnumber);
-        g_rw_lock_reader_unlock(&data->lock);
-
-        /* Make sure the workload has been updated for this round.
-         * This boolean is preventing race conditions upon the start of each round,
-         * and since we don't expect it to take long for the other threads to run
-         * through the unprocessedHosts reset above, spinning is OK. */
-        while (!__atomic_load_n(&stolenTdata->isStealable, __ATOMIC_ACQUIRE)) {
-        };
-
-        /* We don't need a lock here, because we're only reading, and a misread just means either
-         * we read as empty when it's not, in which case the assigned thread (or one of the others)
-         * will pick it up anyway, or it reads as non-empty when it is empty, in which case we'll
-         * just get a NULL event and move on. Accepting this reduces lock contention towards the end
-         * of every round. */
-        if(g_queue_is_empty(stolenTdata->unprocessedHosts)) {
-            continue;
-        }
-        /* We need to lock the thread we're stealing from, to be sure that we're not stealing
-         * something already being stolen, as well as our own lock, to be sure nobody steals
-         * what we just stole. But we also need to do this in a well-ordered manner, to
-         * prevent deadlocks. To do this, we always lock the lock with the smaller thread
-         * number first. */
-        g_timer_continue(tdata->popIdleTime);
-        if(tdata->tnumber < stolenTnumber) {
-            g_mutex_lock(&(tdata->lock));
-            g_mutex_lock(&(stolenTdata->lock));
-        } else {
-            g_mutex_lock(&(stolenTdata->lock));
-            g_mutex_lock(&(tdata->lock));
-        }
-        g_timer_stop(tdata->popIdleTime);
-
-        /* attempt to get event from the other thread's queue, likely moving a host from its
-         * unprocessedHosts into this threads runningHost (and eventually processedHosts) */
-        nextEvent = _schedulerpolicyhoststeal_popFromThread(policy, tdata, stolenTdata->unprocessedHosts, barrier);
-
-        /* must unlock in reverse order of locking */
-        if(tdata->tnumber < stolenTnumber) {
-            g_mutex_unlock(&(stolenTdata->lock));
-            g_mutex_unlock(&(tdata->lock));
-        } else {
-            g_mutex_unlock(&(tdata->lock));
-            g_mutex_unlock(&(stolenTdata->lock));
-        }
+    _schedulerpolicyhoststeal_shuffleVictims(tdata);
 
+    g_timer_continue(tdata->stealTime);
+    for(guint i = 0; i < tdata->victims->len && nextEvent == NULL; i++) {
+        HostStealThreadData* stolenTdata = g_array_index(tdata->victims, HostStealThreadData*, i);
+        tdata->nStealAttempts++;
+        nextEvent = _schedulerpolicyhoststeal_stealFromThread(policy, tdata, stolenTdata, barrier);
         if(nextEvent != NULL) {
-            break;
+            tdata->nSteals++;
+            if(stolenTdata->location.node != tdata->location.node) {
+                tdata->nCrossNodeSteals++;
+            }
         }
     }
+    g_timer_stop(tdata->stealTime);
+
     return nextEvent;
 }
 
@@ -436,12 +706,11 @@ static void _schedulerpolicyhoststeal_findMinTime(Host* host, HostStealSearchSta
     g_rw_lock_reader_unlock(&state->data->lock);
     utility_assert(qdata);
 
-    g_mutex_lock(&(qdata->lock));
-    Event* event = priorityqueue_peek(qdata->pq);
-    g_mutex_unlock(&(qdata->lock));
-
-    if(event != NULL) {
-        state->nextEventTime = MIN(state->nextEventTime, event_getTime(event));
+    /* a push that races with this read is also recorded by the scheduler for the pushing thread */
+    SimulationTime eventTime = __atomic_load_n(&qdata->nextEventTime, __ATOMIC_RELAXED);
+    if(eventTime != SIMTIME_MAX) {
+        state->nextEventTime = MIN(state->nextEventTime, eventTime);
+        state->nextDeliveryTime = MIN(state->nextDeliveryTime, eventTime + host_getLookahead(host));
     }
 }
 
@@ -454,31 +723,86 @@ static SimulationTime _schedulerpolicyhoststeal_getNextTime(SchedulerPolicy* pol
     memset(&searchState, 0, sizeof(HostStealSearchState));
     searchState.data = data;
     searchState.nextEventTime = SIMTIME_MAX;
+    searchState.nextDeliveryTime = SIMTIME_MAX;
 
     g_rw_lock_reader_lock(&data->lock);
     HostStealThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
     g_rw_lock_reader_unlock(&data->lock);
     if(tdata) {
+        /* other threads may still be stealing from us */
+        g_mutex_lock(&(tdata->lock));
         /* make sure we get all hosts, which are probably held in the processedHosts queue between rounds */
         g_queue_foreach(tdata->unprocessedHosts, (GFunc)_schedulerpolicyhoststeal_findMinTime, &searchState);
         g_queue_foreach(tdata->processedHosts, (GFunc)_schedulerpolicyhoststeal_findMinTime, &searchState);
+        tdata->nextDeliveryTime = searchState.nextDeliveryTime;
+        g_mutex_unlock(&(tdata->lock));
+    }
 
-        /* since we are in-between rounds, reset our stealable flag */
-        __atomic_store_n(&tdata->isStealable, false, __ATOMIC_RELEASE);
+    /* the sleeping hosts are shared, so every thread includes the earliest of them */
+    g_mutex_lock(&data->calendar.lock);
+    HostStealAlarm* alarm = _hoststealcalendar_peek(&data->calendar);
+    if(alarm != NULL) {
+        searchState.nextEventTime = MIN(searchState.nextEventTime, alarm->time);
+        searchState.nextDeliveryTime = MIN(searchState.nextDeliveryTime, alarm->time + data->calendar.minLookahead);
+        if(tdata) {
+            tdata->nextDeliveryTime = searchState.nextDeliveryTime;
+        }
     }
+    g_mutex_unlock(&data->calendar.lock);
 
-    info("next event at time %"G_GUINT64_FORMAT, searchState.nextEventTime);
+    info("next event at time %"G_GUINT64_FORMAT", next delivery at time %"G_GUINT64_FORMAT,
+            searchState.nextEventTime, searchState.nextDeliveryTime);
 
     return searchState.nextEventTime;
 }
 
+static SimulationTime _schedulerpolicyhoststeal_getNextDeliveryTime(SchedulerPolicy* policy) {
+    MAGIC_ASSERT(policy);
+    HostStealPolicyData* data = policy->data;
+
+    g_rw_lock_reader_lock(&data->lock);
+    HostStealThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
+    g_rw_lock_reader_unlock(&data->lock);
+
+    return tdata ? tdata->nextDeliveryTime : SIMTIME_MAX;
+}
+
+static void _schedulerpolicyhoststeal_setThreadLocation(SchedulerPolicy* policy, pthread_t thread,
+        gint node, gint cacheDomain) {
+    MAGIC_ASSERT(policy);
+    HostStealPolicyData* data = policy->data;
+
+    HostStealLocation* location = g_new0(HostStealLocation, 1);
+    location->node = node;
+    location->cacheDomain = cacheDomain;
+
+    g_rw_lock_writer_lock(&data->lock);
+    g_hash_table_replace(data->threadToLocationMap, GUINT_TO_POINTER(thread), location);
+    HostStealThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(thread));
+    if(tdata) {
+        tdata->location = *location;
+    }
+    /* the victim order of every thread depends on the locations */
+    for(guint i = 0; i < data->threadCount; i++) {
+        g_array_set_size(g_array_index(data->threadList, HostStealThreadData*, i)->victims, 0);
+    }
+    g_rw_lock_writer_unlock(&data->lock);
+}
+
 static void _schedulerpolicyhoststeal_free(SchedulerPolicy* policy) {
     MAGIC_ASSERT(policy);
     HostStealPolicyData* data = policy->data;
 
+    message("idle hosts were put to sleep %"G_GSIZE_FORMAT" times and woken up %"G_GSIZE_FORMAT" times",
+            data->calendar.nSleeps, data->calendar.nWakeups);
+
     g_hash_table_destroy(data->hostToQueueDataMap);
     g_hash_table_destroy(data->threadToThreadDataMap);
     g_hash_table_destroy(data->hostToThreadMap);
+    g_hash_table_destroy(data->threadToLocationMap);
+    priorityqueue_free(data->calendar.alarms);
+    g_hash_table_destroy(data->calendar.sleepingHosts);
+    g_mutex_clear(&data->calendar.lock);
     g_rw_lock_clear(&data->lock);
     g_free(data);
 
@@ -492,6 +816,11 @@ SchedulerPolicy* schedulerpolicyhoststeal_new() {
     data->hostToQueueDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_hoststealqueuedata_free);
     data->threadToThreadDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_hoststealthreaddata_free);
     data->hostToThreadMap = g_hash_table_new(g_direct_hash, g_direct_equal);
+    data->threadToLocationMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    g_mutex_init(&data->calendar.lock);
+    data->calendar.alarms = priorityqueue_new((GCompareDataFunc)_hoststealalarm_compare, NULL, g_free);
+    data->calendar.sleepingHosts = g_hash_table_new(g_direct_hash, g_direct_equal);
+    data->calendar.minLookahead = SIMTIME_MAX;
     g_rw_lock_init(&data->lock);
 
     SchedulerPolicy* policy = g_new0(SchedulerPolicy, 1);
@@ -501,6 +830,8 @@ SchedulerPolicy* schedulerpolicyhoststeal_new() {
     policy->push = _schedulerpolicyhoststeal_push;
     policy->pop = _schedulerpolicyhoststeal_pop;
     policy->getNextTime = _schedulerpolicyhoststeal_getNextTime;
+    policy->getNextDeliveryTime = _schedulerpolicyhoststeal_getNextDeliveryTime;
+    policy->setThreadLocation = _schedulerpolicyhoststeal_setThreadLocation;
     policy->free = _schedulerpolicyhoststeal_free;
 
     policy->type = SP_PARALLEL_HOST_STEAL;
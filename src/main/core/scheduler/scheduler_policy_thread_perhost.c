@@ -32,6 +32,8 @@ struct _ThreadPerHostThreadData {
     /* this thread has pqueue that holds future events during each round, and is emptied into
      * the priority queue in qdata after each round */
     GHashTable* hostToPQueueMap;
+    /* the round end for which we last moved the mailboxes into qdata */
+    SimulationTime drainedBarrier;
 };
 
 typedef struct _ThreadPerHostPolicyData ThreadPerHostPolicyData;
@@ -63,6 +65,7 @@ static ThreadPerHostThreadData* _threadperhostthreaddata_new() {
     tdata->hostToPQueueMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)priorityqueue_free);
     tdata->qdata = _threadperhostqueuedata_new();
     tdata->assignedHosts = g_queue_new();
+    tdata->drainedBarrier = SIMTIME_INVALID;
     g_mutex_init(&(tdata->lock));
     return tdata;
 }
@@ -133,10 +136,9 @@ static void _schedulerpolicythreadperhost_push(SchedulerPolicy* policy, Event* e
         priorityqueue_push(tdata->qdata->pq, event);
         tdata->qdata->nPushed++;
     } else {
-        /* we need to lock this if srcThread != pthread_self */
-        if(!pthread_equal(srcThread, self)) {
-            g_mutex_lock(&(tdata->lock));
-        }
+        /* the destination thread may be draining its mailboxes while we push, since
+         * it reports its next event time before the other threads finished the round */
+        g_mutex_lock(&(tdata->lock));
 
         /* now make sure we have a mailbox for the source and create one if needed */
         PriorityQueue* futureEvents = g_hash_table_lookup(tdata->hostToPQueueMap, srcHost);
@@ -148,10 +150,30 @@ static void _schedulerpolicythreadperhost_push(SchedulerPolicy* policy, Event* e
         /* 'deliver' the event there */
         priorityqueue_push(futureEvents, event);
 
-        if(!pthread_equal(srcThread, self)) {
-            g_mutex_unlock(&(tdata->lock));
+        g_mutex_unlock(&(tdata->lock));
+    }
+}
+
+/* moves the events other threads pushed for us into our main queue */
+static void _schedulerpolicythreadperhost_drainMailboxes(ThreadPerHostThreadData* tdata) {
+    g_mutex_lock(&(tdata->lock));
+    GList* values = g_hash_table_get_values(tdata->hostToPQueueMap);
+    GList* item = values;
+    while(item) {
+        PriorityQueue* futureEvents = item->data;
+
+        while(!priorityqueue_isEmpty(futureEvents)) {
+            Event* event = priorityqueue_pop(futureEvents);
+            priorityqueue_push(tdata->qdata->pq, event);
+            tdata->qdata->nPushed++;
         }
+
+        item = g_list_next(item);
     }
+    if(values) {
+        g_list_free(values);
+    }
+    g_mutex_unlock(&(tdata->lock));
 }
 
 static Event* _schedulerpolicythreadperhost_pop(SchedulerPolicy* policy, SimulationTime barrier) {
@@ -166,6 +188,13 @@ static Event* _schedulerpolicythreadperhost_pop(SchedulerPolicy* policy, Simulat
         return NULL;
     }
 
+    /* other threads may have pushed to our mailboxes after we drained them at the end of
+     * the last round, so pick up those events once at the start of each new round */
+    if(barrier != tdata->drainedBarrier) {
+        _schedulerpolicythreadperhost_drainMailboxes(tdata);
+        tdata->drainedBarrier = barrier;
+    }
+
     Event* nextEvent = priorityqueue_peek(tdata->qdata->pq);
     SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
 
@@ -190,23 +219,10 @@ static SimulationTime _schedulerpolicythreadperhost_getNextTime(SchedulerPolicy*
 
     ThreadPerHostThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
     if(tdata) {
-        /* we are in between rounds. first we have to drain all future events into the priority queue */
-        GList* values = g_hash_table_get_values(tdata->hostToPQueueMap);
-        GList* item = values;
-        while(item) {
-            PriorityQueue* futureEvents = item->data;
-
-            while(!priorityqueue_isEmpty(futureEvents)) {
-                Event* event = priorityqueue_pop(futureEvents);
-                priorityqueue_push(tdata->qdata->pq, event);
-                tdata->qdata->nPushed++;
-            }
-
-            item = g_list_next(item);
-        }
-        if(values) {
-            g_list_free(values);
-        }
+        /* we are done with this round. first we have to drain all future events into the priority queue.
+         * events that others push after this are accounted for by the pushing thread, and will
+         * be drained when we pop for the next round. */
+        _schedulerpolicythreadperhost_drainMailboxes(tdata);
 
         Event* nextEvent = priorityqueue_peek(tdata->qdata->pq);
         if(nextEvent != NULL) {
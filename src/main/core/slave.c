@@ -9,6 +9,8 @@
 #include <pthread.h>
 #include <stddef.h>
 #include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "main/core/logger/shadow_logger.h"
 #include "main/core/master.h"
@@ -73,6 +75,12 @@ struct _Slave {
 
     /* the last time we logged heartbeat information */
     SimulationTime simClockLastHeartbeat;
+    /* the current execution window, protected by the slave lock */
+    SimulationTime simClockWindowStart;
+    SimulationTime simClockWindowEnd;
+    /* how many rounds the workers ran, and their events, protected by the slave lock */
+    guint64 numRounds;
+    guint64 numRoundEvents;
 
     guint numPluginErrors;
 
@@ -119,6 +127,20 @@ static SchedulerPolicyType _slave_getEventSchedulerPolicy(Slave* slave) {
     }
 }
 
+static SchedulerAffinityType _slave_getWorkerAffinity(Slave* slave) {
+    const gchar* affinityStr = options_getWorkerAffinity(slave->options);
+    if (g_ascii_strcasecmp(affinityStr, "none") == 0) {
+        return SA_NONE;
+    } else if (g_ascii_strcasecmp(affinityStr, "core") == 0) {
+        return SA_CORE;
+    } else if (g_ascii_strcasecmp(affinityStr, "node") == 0) {
+        return SA_NODE;
+    } else {
+        error("unknown worker affinity '%s'; valid values are 'none', 'core', or 'node'", affinityStr);
+        return SA_NONE;
+    }
+}
+
 _ProgramMeta* _program_meta_new(const gchar* name, const gchar* path, const gchar* startSymbol) {
     if((name == NULL) || (path == NULL)) {
         error("attempting to register a program with a null name and/or path");
@@ -165,6 +187,32 @@ static guint _slave_nextRandomUInt(Slave* slave) {
     return r;
 }
 
+static gboolean _slave_finishRound(Slave* slave, const SchedulerRoundInfo* round,
+        SimulationTime* windowStart, SimulationTime* windowEnd) {
+    MAGIC_ASSERT(slave);
+
+    _slave_lock(slave);
+
+    /* we are in control now, the workers are waiting for the next round */
+    info("finished execution window [%"G_GUINT64_FORMAT"--%"G_GUINT64_FORMAT"] with %"G_GUINT64_FORMAT" events, "
+            "next event at %"G_GUINT64_FORMAT", next delivery to another host at %"G_GUINT64_FORMAT,
+            slave->simClockWindowStart, slave->simClockWindowEnd, round->numEvents,
+            round->minNextEventTime, round->minNextDeliveryTime);
+    slave->numRounds++;
+    slave->numRoundEvents += round->numEvents;
+
+    /* notify master that we finished this round, and the time of our next event
+     * in order to fast-forward our execute window if possible */
+    gboolean keepRunning = master_slaveFinishedCurrentRound(slave->master, round->minNextEventTime,
+            round->minNextDeliveryTime, windowStart, windowEnd);
+    slave->simClockWindowStart = *windowStart;
+    slave->simClockWindowEnd = *windowEnd;
+
+    _slave_unlock(slave);
+
+    return keepRunning;
+}
+
 Slave* slave_new(Master* master, Options* options, SimulationTime endTime, SimulationTime unlimBWEndTime, guint randomSeed) {
     if(globalSlave != NULL) {
         return NULL;
@@ -195,8 +243,15 @@ Slave* slave_new(Master* master, Options* options, SimulationTime endTime, Simul
 
     guint nWorkers = options_getNWorkerThreads(options);
     SchedulerPolicyType policy = _slave_getEventSchedulerPolicy(slave);
+    SchedulerAffinityType affinity = _slave_getWorkerAffinity(slave);
     guint schedulerSeed = _slave_nextRandomUInt(slave);
-    slave->scheduler = scheduler_new(policy, nWorkers, slave, schedulerSeed, endTime);
+    if(nWorkers > 0 && options_doRunDecentralizedRounds(options)) {
+        /* the workers run _slave_finishRound themselves */
+        slave->scheduler = scheduler_new(policy, affinity, nWorkers, slave, schedulerSeed, endTime,
+                (SchedulerNextRoundFunc)_slave_finishRound, slave);
+    } else {
+        slave->scheduler = scheduler_new(policy, affinity, nWorkers, slave, schedulerSeed, endTime, NULL, NULL);
+    }
 
     slave->cwdPath = g_get_current_dir();
     slave->dataPath = g_build_filename(slave->cwdPath, options_getDataOutputPath(options), NULL);
@@ -425,13 +480,48 @@ void slave_run(Slave* slave) {
         /* the worker takes control of data pointer and frees it */
         worker_run(data);
 
+        scheduler_finish(slave->scheduler);
+    } else if(options_doRunDecentralizedRounds(slave->options)) {
+        /* the workers advance the execution window themselves, so the main thread is
+         * not on the critical path and only handles housekeeping in the background */
+        pid_t tid = (pid_t)syscall(SYS_gettid);
+        errno = 0;
+        gint niceness = getpriority(PRIO_PROCESS, tid);
+        gboolean isReniced = errno == 0 && setpriority(PRIO_PROCESS, tid, niceness + CONFIG_HOUSEKEEPING_NICE) == 0;
+
+        scheduler_start(slave->scheduler);
+
+        while(scheduler_awaitRounds(slave->scheduler, CONFIG_HOUSEKEEPING_INTERVAL)) {
+            _slave_lock(slave);
+            SimulationTime windowStart = slave->simClockWindowStart;
+            _slave_unlock(slave);
+
+            _slave_heartbeat(slave, windowStart);
+
+            /* flush slave threads messages */
+            shadow_logger_flushRecords(shadow_logger_getDefault(),
+                                       pthread_self());
+
+            /* let the logger know it can flush everything it got so far */
+            shadow_logger_syncToDisk(shadow_logger_getDefault());
+        }
+
+        if(isReniced) {
+            setpriority(PRIO_PROCESS, tid, niceness);
+        }
+
         scheduler_finish(slave->scheduler);
     } else {
         /* we are the main thread, we manage the execution window updates while the workers run events */
         SimulationTime windowStart = 0, windowEnd = 1;
-        SimulationTime minNextEventTime = SIMTIME_INVALID;
+        SchedulerRoundInfo round;
         gboolean keepRunning = TRUE;
 
+        _slave_lock(slave);
+        slave->simClockWindowStart = windowStart;
+        slave->simClockWindowEnd = windowEnd;
+        _slave_unlock(slave);
+
         scheduler_start(slave->scheduler);
 
         while(keepRunning) {
@@ -450,19 +540,19 @@ void slave_run(Slave* slave) {
             shadow_logger_syncToDisk(shadow_logger_getDefault());
 
             /* wait for the workers to finish processing nodes before we update the execution window */
-            minNextEventTime = scheduler_awaitNextRound(slave->scheduler);
-
-            /* we are in control now, the workers are waiting for the next round */
-            info("finished execution window [%"G_GUINT64_FORMAT"--%"G_GUINT64_FORMAT"] next event at %"G_GUINT64_FORMAT,
-                    windowStart, windowEnd, minNextEventTime);
+            scheduler_awaitNextRound(slave->scheduler, &round);
 
-            /* notify master that we finished this round, and the time of our next event
-             * in order to fast-forward our execute window if possible */
-            keepRunning = master_slaveFinishedCurrentRound(slave->master, minNextEventTime, &windowStart, &windowEnd);
+            keepRunning = _slave_finishRound(slave, &round, &windowStart, &windowEnd);
         }
 
         scheduler_finish(slave->scheduler);
     }
+
+    if(slave->numRounds > 0) {
+        message("workers ran %"G_GUINT64_FORMAT" events in %"G_GUINT64_FORMAT" rounds, "
+                "%.1f events per round on average", slave->numRoundEvents, slave->numRounds,
+                (gdouble)slave->numRoundEvents / (gdouble)slave->numRounds);
+    }
 }
 
 void slave_incrementPluginError(Slave* slave) {
@@ -130,6 +130,24 @@ typedef guint64 EmulatedTime;
 #define CONFIG_TCP_DELACK_MIN NET_TCP_HZ/25
 #define CONFIG_TCP_DELACK_MAX NET_TCP_HZ/5
 
+/**
+ * Number of ACKs a TCP connection sends quickly after it starts, unless it
+ * enters quick ACK mode like Linux does
+ */
+#define CONFIG_TCP_INITIAL_QUICKACKS 1000
+
+/**
+ * Maximum number of segments to ACK quickly when entering quick ACK mode,
+ * TCP_MAX_QUICKACKS from net/tcp.h
+ */
+#define CONFIG_TCP_MAX_QUICKACKS 16
+
+/**
+ * Number of packets a TCP connection must get acknowledged in congestion
+ * avoidance without a loss event before the fluid model may take it over
+ */
+#define CONFIG_TCP_FLUID_MIN_ACKED 1000
+
 /**
  * Minimum size of the send buffer per socket when TCP-autotuning is used.
  * This value was computed from "man tcp"
@@ -163,6 +181,54 @@ typedef guint64 EmulatedTime;
  */
 #define CONFIG_PIPE_BUFFER_SIZE 65536
 
+/**
+ * Number of background threads shared by all hosts to write out buffered
+ * plugin file writes
+ */
+#define CONFIG_FILE_WRITE_THREADS 2
+
+/**
+ * Maximum number of threads used to copy the files of the data template
+ * directory into the data directory at startup
+ */
+#define CONFIG_TEMPLATE_COPY_THREADS 8
+
+/**
+ * Size of the buffer each worker uses to collect the stdout and stderr output
+ * of the processes it runs before writing it out
+ */
+#define CONFIG_OUTPUT_SINK_BUFFER_SIZE 4194304
+
+/**
+ * Maximum number of process output files that are kept open at the same time
+ */
+#define CONFIG_OUTPUT_SINK_MAX_OPEN_FILES 256
+
+/**
+ * How often, in microseconds, buffered process output is written out even if
+ * the buffer of the worker is not full
+ */
+#define CONFIG_OUTPUT_SINK_FLUSH_INTERVAL 1000000
+
+/**
+ * How often, in microseconds, the main thread wakes up to log heartbeats and
+ * flush log records while the workers advance the rounds themselves
+ */
+#define CONFIG_HOUSEKEEPING_INTERVAL 100000
+
+/**
+ * How much the main thread lowers its scheduling priority (its nice value)
+ * while the workers advance the rounds themselves
+ */
+#define CONFIG_HOUSEKEEPING_NICE 10
+
+/**
+ * Hosts whose next event is at least this far past the end of the round are
+ * put to sleep by the host stealing scheduler, and are not looked at again
+ * until the round in which that event is due
+ */
+#define CONFIG_HOST_SLEEP_THRESHOLD (SIMTIME_ONE_SECOND)
+
 /**
  * Default batching time when the network interface receives packets
  */
@@ -187,11 +253,25 @@ typedef guint64 EmulatedTime;
  */
 #define CONFIG_MTU 1500
 
+/**
+ * Maximum number of payload bytes carried by one aggregated packet when TCP
+ * segmentation offload is enabled (mirrors the Linux GSO limit)
+ */
+#define CONFIG_TSO_MAX_SIZE 65536
+
 /**
  * Maximum size of a datagram we are allowed to send out over the network
  */
 #define CONFIG_DATAGRAM_MAX_SIZE 65507
 
+/**
+ * Maximum number of datagrams that may wait in the receive buffer of a UDP
+ * socket. Linux charges every datagram its full buffer overhead, so small
+ * datagrams fill the buffer long before their payload does; this plays that
+ * role, and also bounds empty datagrams.
+ */
+#define CONFIG_UDP_MAX_QUEUED_DATAGRAMS 1024
+
 /**
  * Delay in nanoseconds for a TCP close timer.
  */
@@ -29,6 +29,9 @@ struct _Options {
     gboolean debug;
     gchar* dataDirPath;
     gchar* dataTemplatePath;
+    gboolean decentralizedRounds;
+    gchar* workerAffinity;
+    gboolean reusePluginNamespaces;
 
     GOptionGroup* networkOptionGroup;
     gint cpuThreshold;
@@ -45,6 +48,10 @@ struct _Options {
     SimulationTime interfaceBatchTime;
     gchar* tcpCongestionControl;
     gint tcpSlowStartThreshold;
+    gboolean tcpSegmentationOffload;
+    gboolean tcpFluidModel;
+    gboolean tcpLinuxQuickACK;
+    gint fileWriteBufferSize;
 
     GOptionGroup* pluginsOptionGroup;
     gboolean runTGenExample;
@@ -87,16 +94,19 @@ Options* options_new(gint argc, gchar* argv[]) {
     const GOptionEntry mainEntries[] = {
       { "data-directory", 'd', 0, G_OPTION_ARG_STRING, &(options->dataDirPath), "PATH to store simulation output ['shadow.data']", "PATH" },
       { "data-template", 'e', 0, G_OPTION_ARG_STRING, &(options->dataTemplatePath), "PATH to recursively copy during startup and use as the data-directory ['shadow.data.template']", "PATH" },
+      { "decentralized-rounds", 0, 0, G_OPTION_ARG_NONE, &(options->decentralizedRounds), "Let the last worker to finish a round start the next one, so the main thread is not a round coordinator and only does housekeeping (use one more worker than usual)", NULL },
       { "gdb", 'g', 0, G_OPTION_ARG_NONE, &(options->debug), "Pause at startup for debugger attachment", NULL },
       { "heartbeat-frequency", 'h', 0, G_OPTION_ARG_INT, &(options->heartbeatInterval), "Log node statistics every N seconds [1]", "N" },
       { "heartbeat-log-info", 'i', 0, G_OPTION_ARG_STRING, &(options->heartbeatLogInfo), "Comma separated list of information contained in heartbeat ('node','socket','ram') ['node']", "LIST"},
       { "heartbeat-log-level", 'j', 0, G_OPTION_ARG_STRING, &(options->heartbeatLogLevelInput), "Log LEVEL at which to print node statistics ['message']", "LEVEL" },
       { "log-level", 'l', 0, G_OPTION_ARG_STRING, &(options->logLevelInput), "Log LEVEL above which to filter messages ('error' < 'critical' < 'warning' < 'message' < 'info' < 'debug') ['message']", "LEVEL" },
       { "preload", 'p', 0, G_OPTION_ARG_STRING, &(options->preloads), "LD_PRELOAD environment VALUE to use for function interposition (/path/to/lib:...) [None]", "VALUE" },
+      { "reuse-plugin-namespaces", 0, 0, G_OPTION_ARG_NONE, &(options->reusePluginNamespaces), "Reset the plugin namespace of an exited process and reuse it for the next process of the same plugin on the same host, instead of loading the plugin again. The writable data of the plugin and its libraries (including libc) is restored and constructors run again, but destructors are not run, heap memory is not freed, and only the TLS of the thread running the host is reset (experimental!)", NULL },
       { "runahead", 'r', 0, G_OPTION_ARG_INT, &(options->minRunAhead), "If set, overrides the automatically calculated minimum TIME workers may run ahead when sending events between nodes, in milliseconds [0]", "TIME" },
       { "seed", 's', 0, G_OPTION_ARG_INT, &(options->randomSeed), "Initialize randomness for each thread using seed N [1]", "N" },
       { "scheduler-policy", 't', 0, G_OPTION_ARG_STRING, &(options->eventSchedulingPolicy), "The event scheduler's policy for thread synchronization ('thread', 'host', 'steal', 'threadXthread', 'threadXhost') ['steal']", "SPOL" },
       { "workers", 'w', 0, G_OPTION_ARG_INT, &(options->nWorkerThreads), "Run concurrently with N worker threads [0]", "N" },
+      { "worker-affinity", 0, 0, G_OPTION_ARG_STRING, &(options->workerAffinity), "Pin each worker thread to one CPU ('core') or to the CPUs of one NUMA node ('node'), so host memory stays close to the thread running it ('none', 'core', 'node') ['none']", "AFF" },
       { "valgrind", 'x', 0, G_OPTION_ARG_NONE, &(options->runValgrind), "Run through valgrind for debugging", NULL },
       { "version", 'v', 0, G_OPTION_ARG_NONE, &(options->printSoftwareVersion), "Print software version and exit", NULL },
       { NULL },
@@ -128,12 +138,16 @@ Options* options_new(gint argc, gchar* argv[]) {
     {
       { "cpu-precision", 0, 0, G_OPTION_ARG_INT, &(options->cpuPrecision), "round measured CPU delays to the nearest TIME, in microseconds (negative value to disable fuzzy CPU delays) [200]", "TIME" },
       { "cpu-threshold", 0, 0, G_OPTION_ARG_INT, &(options->cpuThreshold), "TIME delay threshold after which the CPU becomes blocked, in microseconds (negative value to disable CPU delays) (experimental!) [-1]", "TIME" },
+      { "file-write-buffer", 0, 0, G_OPTION_ARG_INT, &(options->fileWriteBufferSize), "Buffer up to N bytes of plugin writes to regular files per host and write them out from background threads (0 to disable) [0]", "N" },
       { "interface-batch", 0, 0, G_OPTION_ARG_INT, &(options->interfaceBatchTime), "Batch TIME for network interface sends and receives, in microseconds [5000]", "TIME" },
       { "interface-buffer", 0, 0, G_OPTION_ARG_INT, &(options->interfaceBufferSize), "Size of the network interface receive buffer, in bytes [1024000]", "N" },
       { "interface-qdisc", 0, 0, G_OPTION_ARG_STRING, &(options->interfaceQueuingDiscipline), "The interface queuing discipline QDISC used to select the next sendable socket ('fifo' or 'rr') ['fifo']", "QDISC" },
       { "socket-recv-buffer", 0, 0, G_OPTION_ARG_INT, &(options->initialSocketReceiveBufferSize), sockrecv->str, "N" },
       { "socket-send-buffer", 0, 0, G_OPTION_ARG_INT, &(options->initialSocketSendBufferSize), socksend->str, "N" },
       { "tcp-congestion-control", 0, 0, G_OPTION_ARG_STRING, &(options->tcpCongestionControl), "Congestion control algorithm to use for TCP ('aimd', 'reno', 'cubic') ['reno']", "TCPCC" },
+      { "tcp-fluid-model", 0, 0, G_OPTION_ARG_NONE, &(options->tcpFluidModel), "Model the congestion window of long-lived TCP flows in steady state analytically from the path properties (experimental!)", NULL },
+      { "tcp-linux-quickack", 0, 0, G_OPTION_ARG_NONE, &(options->tcpLinuxQuickACK), "ACK quickly for up to 16 segments at the start of a transfer and after idle periods like Linux, instead of for the first 1000 ACKs of a connection", NULL },
+      { "tcp-segmentation-offload", 0, 0, G_OPTION_ARG_NONE, &(options->tcpSegmentationOffload), "Send runs of back-to-back TCP segments through the network as single aggregated packets (experimental!)", NULL },
       { "tcp-ssthresh", 0, 0, G_OPTION_ARG_INT, &(options->tcpSlowStartThreshold), "Set TCP ssthresh value instead of discovering it via packet loss or hystart [0]", "N" },
       { "tcp-windows", 0, 0, G_OPTION_ARG_INT, &(options->initialTCPWindow), "Initialize the TCP send, receive, and congestion windows to N packets [10]", "N" },
       { NULL },
@@ -198,6 +212,9 @@ Options* options_new(gint argc, gchar* argv[]) {
     if(options->eventSchedulingPolicy == NULL) {
         options->eventSchedulingPolicy = g_strdup("steal");
     }
+    if(options->workerAffinity == NULL) {
+        options->workerAffinity = g_strdup("none");
+    }
     if(!options->initialSocketReceiveBufferSize) {
         options->initialSocketReceiveBufferSize = CONFIG_RECV_BUFFER_SIZE;
         options->autotuneSocketReceiveBuffer = TRUE;
@@ -239,6 +256,7 @@ void options_free(Options* options) {
     g_free(options->heartbeatLogInfo);
     g_free(options->interfaceQueuingDiscipline);
     g_free(options->eventSchedulingPolicy);
+    g_free(options->workerAffinity);
     g_free(options->tcpCongestionControl);
     if(options->argstr) {
         g_free(options->argstr);
@@ -321,6 +339,11 @@ gchar* options_getEventSchedulerPolicy(Options* options) {
     return options->eventSchedulingPolicy;
 }
 
+const gchar* options_getWorkerAffinity(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->workerAffinity;
+}
+
 guint options_getNWorkerThreads(Options* options) {
     MAGIC_ASSERT(options);
     return options->nWorkerThreads > 0 ? (guint)options->nWorkerThreads : 0;
@@ -351,6 +374,16 @@ gboolean options_doRunDebug(Options* options) {
     return options->debug;
 }
 
+gboolean options_doRunDecentralizedRounds(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->decentralizedRounds;
+}
+
+gboolean options_doReusePluginNamespaces(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->reusePluginNamespaces;
+}
+
 gboolean options_doRunTGenExample(Options* options) {
     MAGIC_ASSERT(options);
     return options->runTGenExample;
@@ -396,6 +429,26 @@ gint options_getTCPSlowStartThreshold(Options* options) {
     return options->tcpSlowStartThreshold;
 }
 
+gboolean options_doTCPSegmentationOffload(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->tcpSegmentationOffload;
+}
+
+gboolean options_doTCPFluidModel(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->tcpFluidModel;
+}
+
+gboolean options_doTCPLinuxQuickACK(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->tcpLinuxQuickACK;
+}
+
+gint options_getFileWriteBufferSize(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->fileWriteBufferSize;
+}
+
 SimulationTime options_getInterfaceBatchTime(Options* options) {
     MAGIC_ASSERT(options);
     return options->interfaceBatchTime;
@@ -92,6 +92,7 @@ QDiscMode options_getQueuingDiscipline(Options* options);
 gchar* options_getEventSchedulerPolicy(Options* options);
 
 guint options_getNWorkerThreads(Options* options);
+const gchar* options_getWorkerAffinity(Options* options);
 
 const gchar* options_getArgumentString(Options* options);
 const gchar* options_getHeartbeatLogInfoString(Options* options);
@@ -101,6 +102,8 @@ guint options_getRandomSeed(Options* options);
 gboolean options_doRunPrintVersion(Options* options);
 gboolean options_doRunValgrind(Options* options);
 gboolean options_doRunDebug(Options* options);
+gboolean options_doRunDecentralizedRounds(Options* options);
+gboolean options_doReusePluginNamespaces(Options* options);
 gboolean options_doRunTGenExample(Options* options);
 gboolean options_doRunTestExample(Options* options);
 
@@ -111,6 +114,10 @@ gint options_getMinRunAhead(Options* options);
 gint options_getTCPWindow(Options* options);
 const gchar* options_getTCPCongestionControl(Options* options);
 gint options_getTCPSlowStartThreshold(Options* options);
+gboolean options_doTCPSegmentationOffload(Options* options);
+gboolean options_doTCPFluidModel(Options* options);
+gboolean options_doTCPLinuxQuickACK(Options* options);
+gint options_getFileWriteBufferSize(Options* options);
 SimulationTime options_getInterfaceBatchTime(Options* options);
 gint options_getInterfaceBufferSize(Options* options);
 gint options_getSocketReceiveBufferSize(Options* options);
@@ -85,6 +85,8 @@ void event_execute(Event* event) {
         /* cpu is not blocked, its ok to execute the event */
         host_continueExecutionTimer(event->dstHost);
         task_execute(event->task);
+        /* notify epolls about everything that changed while executing */
+        host_flushStatusChangedDescriptors(event->dstHost);
         host_stopExecutionTimer(event->dstHost);
     }
 
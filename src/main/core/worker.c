@@ -61,6 +61,9 @@ struct _Worker {
 
     ObjectCounter* objectCounts;
 
+    /* collects the stdout and stderr output of the processes we run */
+    OutputSink* outputSink;
+
     MAGIC_DECLARE;
 };
 
@@ -96,6 +99,7 @@ static Worker* _worker_new(Slave* slave, guint threadID) {
     worker->clock.last = SIMTIME_INVALID;
     worker->clock.barrier = SIMTIME_INVALID;
     worker->objectCounts = objectcounter_new();
+    worker->outputSink = outputsink_new(CONFIG_OUTPUT_SINK_BUFFER_SIZE);
 
     worker->bootstrapEndTime = slave_getBootstrapEndTime(worker->slave);
 
@@ -111,6 +115,10 @@ static void _worker_free(Worker* worker) {
         objectcounter_free(worker->objectCounts);
     }
 
+    if(worker->outputSink != NULL) {
+        outputsink_free(worker->outputSink);
+    }
+
     g_private_set(&workerKey, NULL);
 
     MAGIC_CLEAR(worker);
@@ -178,6 +186,9 @@ gpointer worker_run(WorkerRunData* data) {
     /* this will free the host data that we have been managing */
     scheduler_awaitFinish(worker->scheduler);
 
+    /* the worker is not freed in every mode, so make sure no output stays buffered */
+    outputsink_flush(worker->outputSink);
+
     scheduler_unref(worker->scheduler);
 
     /* tell that we are done running */
@@ -240,6 +251,17 @@ static void _worker_runDeliverPacketTask(Packet* packet, gpointer userData) {
     router_enqueue(router, packet);
 }
 
+static gboolean _worker_isDelivered(Packet* packet, gdouble reliability,
+        Random* random, gboolean bootstrapping) {
+    gdouble chance = random_nextDouble(random);
+
+    /* don't drop control packets with length 0, otherwise congestion
+     * control has problems responding to packet loss. empty UDP datagrams
+     * are not control packets, and are lost like any other. */
+    gboolean isControl = packet_getProtocol(packet) == PTCP && packet_getPayloadLength(packet) == 0;
+    return bootstrapping || chance <= reliability || isControl;
+}
+
 void worker_sendPacket(Packet* packet) {
     utility_assert(packet != NULL);
 
@@ -266,11 +288,49 @@ void worker_sendPacket(Packet* packet) {
     /* check if network reliability forces us to 'drop' the packet */
     gdouble reliability = topology_getReliability(worker_getTopology(), srcAddress, dstAddress);
     Random* random = host_getRandom(worker_getActiveHost());
-    gdouble chance = random_nextDouble(random);
 
-    /* don't drop control packets with length 0, otherwise congestion
-     * control has problems responding to packet loss */
-    if(bootstrapping || chance <= reliability || packet_getPayloadLength(packet) == 0) {
+    /* the packetCopy starts with 1 ref, which will be held by the packet task
+     * and unreffed after the task is finished executing. */
+    Packet* packetCopy = NULL;
+
+    GList* segments = packet_getSegments(packet);
+    if(segments) {
+        /* a TSO aggregate stands in for several packets on the wire, so each of
+         * its segments gets the same chance of being dropped as if it had been
+         * sent by itself. the aggregate is split around any dropped segment. */
+        GQueue* delivered = g_queue_new();
+        for(GList* item = segments; item; item = g_list_next(item)) {
+            Packet* segment = item->data;
+            if(_worker_isDelivered(segment, reliability, random, bootstrapping)) {
+                packet_addDeliveryStatus(segment, PDS_INET_SENT);
+                g_queue_push_tail(delivered, packet_copy(segment));
+            } else {
+                packet_addDeliveryStatus(segment, PDS_INET_DROPPED);
+            }
+        }
+
+        if(g_queue_get_length(delivered) == 1) {
+            packetCopy = g_queue_pop_head(delivered);
+        } else if(!g_queue_is_empty(delivered)) {
+            Packet* segmentCopy = g_queue_pop_head(delivered);
+            packetCopy = packet_newAggregate(segmentCopy);
+            packet_unref(segmentCopy);
+            while((segmentCopy = g_queue_pop_head(delivered)) != NULL) {
+                packet_addSegment(packetCopy, segmentCopy);
+                packet_unref(segmentCopy);
+            }
+        }
+        g_queue_free(delivered);
+
+        packet_addDeliveryStatus(packet, packetCopy ? PDS_INET_SENT : PDS_INET_DROPPED);
+    } else if(_worker_isDelivered(packet, reliability, random, bootstrapping)) {
+        packet_addDeliveryStatus(packet, PDS_INET_SENT);
+        packetCopy = packet_copy(packet);
+    } else {
+        packet_addDeliveryStatus(packet, PDS_INET_DROPPED);
+    }
+
+    if(packetCopy) {
         /* the sender's packet will make it through, find latency */
         gdouble latency = topology_getLatency(worker_getTopology(), srcAddress, dstAddress);
         SimulationTime delay = (SimulationTime) ceil(latency * SIMTIME_ONE_MILLISECOND);
@@ -286,20 +346,12 @@ void worker_sendPacket(Packet* packet) {
         Host* dstHost = scheduler_getHost(worker->scheduler, dstID);
         utility_assert(dstHost);
 
-        packet_addDeliveryStatus(packet, PDS_INET_SENT);
-
-        /* the packetCopy starts with 1 ref, which will be held by the packet task
-         * and unreffed after the task is finished executing. */
-        Packet* packetCopy = packet_copy(packet);
-
         Task* packetTask = task_new((TaskCallbackFunc)_worker_runDeliverPacketTask,
                 packetCopy, NULL, (TaskObjectFreeFunc)packet_unref, NULL);
         Event* packetEvent = event_new_(packetTask, deliverTime, srcHost, dstHost);
         task_unref(packetTask);
 
         scheduler_push(worker->scheduler, packetEvent, srcHost, dstHost);
-    } else {
-        packet_addDeliveryStatus(packet, PDS_INET_DROPPED);
     }
 }
 
@@ -344,6 +396,11 @@ Process* worker_getActiveProcess() {
     return worker->active.process;
 }
 
+OutputSink* worker_getOutputSink() {
+    Worker* worker = _worker_getPrivate();
+    return worker->outputSink;
+}
+
 void worker_setActiveProcess(Process* proc) {
     Worker* worker = _worker_getPrivate();
     if(worker->active.process) {
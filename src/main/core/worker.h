@@ -16,6 +16,7 @@
 #include "main/core/support/options.h"
 #include "main/core/work/task.h"
 #include "main/host/host.h"
+#include "main/host/output_sink.h"
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
 #include "main/routing/packet.h"
@@ -64,6 +65,7 @@ void worker_freeHosts(GQueue* hosts);
 Host* worker_getActiveHost();
 void worker_setActiveHost(Host* host);
 Process* worker_getActiveProcess();
+OutputSink* worker_getOutputSink();
 void worker_setActiveProcess(Process* proc);
 
 void worker_incrementPluginError();
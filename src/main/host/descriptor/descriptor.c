@@ -86,15 +86,27 @@ gint* descriptor_getHandleReference(Descriptor* descriptor) {
     return &(descriptor->handle);
 }
 
-static void _descriptor_notifyEpollListener(gpointer key, gpointer value, gpointer user_data) {
-    Descriptor* descriptor = user_data;
-    Epoll* epoll = value;
-    epoll_descriptorStatusChanged(epoll, descriptor);
+void descriptor_notifyStatusChanged(Descriptor* descriptor) {
+    MAGIC_ASSERT(descriptor);
+
+    DescriptorStatus changed = descriptor->changedStatus;
+    descriptor->changedStatus = DS_NONE;
+
+    /* tell our epoll listeners their was some activity on this descriptor */
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, descriptor->epollListeners);
+    while(g_hash_table_iter_next(&iter, &key, &value)) {
+        Epoll* epoll = value;
+        epoll_descriptorStatusChanged(epoll, descriptor, changed);
+    }
 }
 
 void descriptor_adjustStatus(Descriptor* descriptor, DescriptorStatus status, gboolean doSetBits){
     MAGIC_ASSERT(descriptor);
 
+    DescriptorStatus oldStatus = descriptor->status;
+
     /* adjust our status as requested */
     if(doSetBits) {
         if((status & DS_ACTIVE) && !(descriptor->status & DS_ACTIVE)) {
@@ -132,8 +144,23 @@ void descriptor_adjustStatus(Descriptor* descriptor, DescriptorStatus status, gb
         }
     }
 
-    /* tell our epoll listeners their was some activity on this descriptor */
-    g_hash_table_foreach(descriptor->epollListeners, _descriptor_notifyEpollListener, descriptor);
+    DescriptorStatus changed = oldStatus ^ descriptor->status;
+    if(changed == DS_NONE || g_hash_table_size(descriptor->epollListeners) == 0) {
+        /* nobody needs to hear about this */
+        return;
+    }
+
+    /* the host notifies our listeners once at the end of the current event, so
+     * that several flips while processing the event cost one notification */
+    Host* host = worker_getActiveHost();
+    gboolean isQueued = (descriptor->changedStatus != DS_NONE) ? TRUE : FALSE;
+    descriptor->changedStatus |= changed;
+
+    if(!host) {
+        descriptor_notifyStatusChanged(descriptor);
+    } else if(!isQueued) {
+        host_addStatusChangedDescriptor(host, descriptor);
+    }
 }
 
 DescriptorStatus descriptor_getStatus(Descriptor* descriptor) {
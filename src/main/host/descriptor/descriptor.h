@@ -51,6 +51,9 @@ struct _Descriptor {
     gint handle;
     DescriptorType type;
     DescriptorStatus status;
+    /* status bits that flipped since our epoll listeners were last notified;
+     * non-zero while we are queued on the host to notify them */
+    DescriptorStatus changedStatus;
     GHashTable* epollListeners;
     gint referenceCount;
     gint flags;
@@ -69,6 +72,7 @@ gint* descriptor_getHandleReference(Descriptor* descriptor);
 
 void descriptor_adjustStatus(Descriptor* descriptor, DescriptorStatus status, gboolean doSetBits);
 DescriptorStatus descriptor_getStatus(Descriptor* descriptor);
+void descriptor_notifyStatusChanged(Descriptor* descriptor);
 
 void descriptor_addEpollListener(Descriptor* descriptor, Descriptor* epoll);
 void descriptor_removeEpollListener(Descriptor* descriptor, Descriptor* epoll);
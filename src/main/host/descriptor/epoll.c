@@ -249,7 +249,7 @@ Epoll* epoll_new(gint handle) {
     return epoll;
 }
 
-static void _epollwatch_updateStatus(EpollWatch* watch) {
+static void _epollwatch_updateStatus(EpollWatch* watch, DescriptorStatus changed) {
     MAGIC_ASSERT(watch);
 
     /* store the old flags that are only lazily updated */
@@ -278,11 +278,12 @@ static void _epollwatch_updateStatus(EpollWatch* watch) {
     /* add back in our lazyFlags that we dont check separately */
     watch->flags |= lazyFlags;
 
-    /* update changed status for edgetrigger mode */
-    if((oldFlags & EWF_READABLE) != (watch->flags & EWF_READABLE)) {
+    /* update changed status for edgetrigger mode. notifications are batched,
+     * so a bit may have flipped and flipped back since we last looked. */
+    if((oldFlags & EWF_READABLE) != (watch->flags & EWF_READABLE) || (changed & DS_READABLE)) {
         watch->flags |= EWF_READCHANGED;
     }
-    if((oldFlags & EWF_WRITEABLE) != (watch->flags & EWF_WRITEABLE)) {
+    if((oldFlags & EWF_WRITEABLE) != (watch->flags & EWF_WRITEABLE) || (changed & DS_WRITABLE)) {
         watch->flags |= EWF_WRITECHANGED;
     }
 }
@@ -433,7 +434,7 @@ gint epoll_control(Epoll* epoll, gint operation, Descriptor* descriptor, struct
             descriptor_addEpollListener(watch->descriptor, (Descriptor*)epoll);
 
             /* initiate a callback if the new watched descriptor is ready */
-            epoll_descriptorStatusChanged(epoll, descriptor);
+            epoll_descriptorStatusChanged(epoll, descriptor, DS_NONE);
 
             break;
         }
@@ -454,7 +455,7 @@ gint epoll_control(Epoll* epoll, gint operation, Descriptor* descriptor, struct
             watch->flags &= ~EWF_ONESHOT_REPORTED;
 
             /* initiate a callback if the new event type on the watched descriptor is ready */
-            epoll_descriptorStatusChanged(epoll, descriptor);
+            epoll_descriptorStatusChanged(epoll, descriptor, DS_NONE);
 
             break;
         }
@@ -502,6 +503,9 @@ gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray, gint eventArr
     MAGIC_ASSERT(epoll);
     utility_assert(nEvents);
 
+    /* make sure status changes from earlier in this event are reflected */
+    host_flushStatusChangedDescriptors(worker_getActiveHost());
+
     /* return the available events in the eventArray, making sure not to
      * overflow. the number of actual events is returned in nEvents. */
     gint eventIndex = 0;
@@ -580,7 +584,7 @@ gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray, gint eventArr
     return 0;
 }
 
-void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor) {
+void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor, DescriptorStatus changed) {
     MAGIC_ASSERT(epoll);
 
     /* make sure we are actually watching the descriptor */
@@ -593,7 +597,7 @@ void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor) {
     debug("status changed in epoll %i for descriptor %i", epoll->super.handle, descriptor->handle);
 
     /* update the status for the child watch fd */
-    _epollwatch_updateStatus(watch);
+    _epollwatch_updateStatus(watch, changed);
 
     /* check if its ready (has an event to report) now */
     if(_epollwatch_isReady(watch)) {
@@ -23,7 +23,7 @@ gint epoll_controlOS(Epoll* epoll, gint operation, gint fileDescriptor,
 gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray,
         gint eventArrayLength, gint* nEvents);
 
-void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor);
+void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor, DescriptorStatus changed);
 void epoll_clearWatchListeners(Epoll* epoll);
 
 #endif /* SHD_EPOLL_H_ */
@@ -38,20 +38,9 @@ void socket_free(gpointer data) {
         g_free(socket->unixPath);
     }
 
-    while(g_queue_get_length(socket->inputBuffer) > 0) {
-        packet_unref(g_queue_pop_head(socket->inputBuffer));
-    }
-    g_queue_free(socket->inputBuffer);
-
-    while(g_queue_get_length(socket->outputBuffer) > 0) {
-        packet_unref(g_queue_pop_head(socket->outputBuffer));
-    }
-    g_queue_free(socket->outputBuffer);
-
-    while(g_queue_get_length(socket->outputControlBuffer) > 0) {
-        packet_unref(g_queue_pop_head(socket->outputControlBuffer));
-    }
-    g_queue_free(socket->outputControlBuffer);
+    packetqueue_clear(&(socket->inputBuffer));
+    packetqueue_clear(&(socket->outputBuffer));
+    packetqueue_clear(&(socket->outputControlBuffer));
 
     MAGIC_CLEAR(socket);
     socket->vtable->free((Descriptor*)socket);
@@ -102,10 +91,10 @@ void socket_init(Socket* socket, SocketFunctionTable* vtable, DescriptorType typ
     socket->vtable = vtable;
 
     socket->protocol = type == DT_TCPSOCKET ? PTCP : type == DT_UDPSOCKET ? PUDP : PLOCAL;
-    socket->inputBuffer = g_queue_new();
+    packetqueue_init(&(socket->inputBuffer));
     socket->inputBufferSize = receiveBufferSize;
-    socket->outputBuffer = g_queue_new();
-    socket->outputControlBuffer = g_queue_new();
+    packetqueue_init(&(socket->outputBuffer));
+    packetqueue_init(&(socket->outputControlBuffer));
     socket->outputBufferSize = sendBufferSize;
 
     Tracker* tracker = host_getTracker(worker_getActiveHost());
@@ -158,10 +147,10 @@ Packet* socket_pullOutPacket(Socket* socket) {
 
 Packet* socket_peekNextPacket(const Socket* socket) {
     MAGIC_ASSERT(socket);
-    if(!g_queue_is_empty(socket->outputControlBuffer)) {
-        return g_queue_peek_head(socket->outputControlBuffer);
+    if(!packetqueue_isEmpty(&(socket->outputControlBuffer))) {
+        return packetqueue_peek(&(socket->outputControlBuffer));
     } else {
-        return g_queue_peek_head(socket->outputBuffer);
+        return packetqueue_peek(&(socket->outputBuffer));
     }
 }
 
@@ -324,8 +313,8 @@ gboolean socket_addToInputBuffer(Socket* socket, Packet* packet) {
     }
 
     /* add to our queue */
-    g_queue_push_tail(socket->inputBuffer, packet);
     packet_ref(packet);
+    packetqueue_push(&(socket->inputBuffer), packet);
     socket->inputBufferLength += length;
     packet_addDeliveryStatus(packet, PDS_RCV_SOCKET_BUFFERED);
 
@@ -334,10 +323,9 @@ gboolean socket_addToInputBuffer(Socket* socket, Packet* packet) {
     Descriptor* descriptor = (Descriptor *)socket;
     tracker_updateSocketInputBuffer(tracker, descriptor->handle, socket->inputBufferLength, socket->inputBufferSize);
 
-    /* we just added a packet, so we are readable */
-    if(socket->inputBufferLength > 0) {
-        descriptor_adjustStatus((Descriptor*)socket, DS_READABLE, TRUE);
-    }
+    /* we just added a packet, so we are readable, even if it is an empty
+     * datagram */
+    descriptor_adjustStatus((Descriptor*)socket, DS_READABLE, TRUE);
 
     return TRUE;
 }
@@ -346,7 +334,7 @@ Packet* socket_removeFromInputBuffer(Socket* socket) {
     MAGIC_ASSERT(socket);
 
     /* see if we have any packets */
-    Packet* packet = g_queue_pop_head(socket->inputBuffer);
+    Packet* packet = packetqueue_pop(&(socket->inputBuffer));
     if(packet) {
         /* just removed a packet */
         guint length = packet_getPayloadLength(packet);
@@ -363,7 +351,7 @@ Packet* socket_removeFromInputBuffer(Socket* socket) {
         tracker_updateSocketInputBuffer(tracker, descriptor->handle, socket->inputBufferLength, socket->inputBufferSize);
 
         /* we are not readable if we are now empty */
-        if(socket->inputBufferLength <= 0) {
+        if(packetqueue_isEmpty(&(socket->inputBuffer))) {
             descriptor_adjustStatus((Descriptor*)socket, DS_READABLE, FALSE);
         }
     }
@@ -396,9 +384,9 @@ gboolean socket_addToOutputBuffer(Socket* socket, Packet* packet) {
     /* add to our queue */
     if(packet_getPriority(packet) == 0.0f) {
         /* control packets get sent first */
-        g_queue_push_tail(socket->outputControlBuffer, packet);
+        packetqueue_push(&(socket->outputControlBuffer), packet);
     } else {
-        g_queue_push_tail(socket->outputBuffer, packet);
+        packetqueue_push(&(socket->outputBuffer), packet);
     }
 
     socket->outputBufferLength += length;
@@ -417,17 +405,75 @@ gboolean socket_addToOutputBuffer(Socket* socket, Packet* packet) {
     /* tell the interface to include us when sending out to the network */
     in_addr_t ip = packet_getSourceIP(packet);
     NetworkInterface* interface = host_lookupInterface(worker_getActiveHost(), ip);
-    networkinterface_wantsSend(interface, socket);
+    if(interface != NULL) {
+        networkinterface_wantsSend(interface, socket);
+    }
 
     return TRUE;
 }
 
+guint socket_addBatchToOutputBuffer(Socket* socket, Packet** packets, guint numPackets) {
+    MAGIC_ASSERT(socket);
+    utility_assert(packets || numPackets == 0);
+
+    Host* host = worker_getActiveHost();
+    NetworkInterface* interface = NULL;
+    in_addr_t interfaceIP = 0;
+    guint numBuffered = 0;
+
+    /* buffer as many as fit, but only touch the tracker, our status, and the
+     * interfaces once for the whole batch instead of once per packet */
+    for(numBuffered = 0; numBuffered < numPackets; numBuffered++) {
+        Packet* packet = packets[numBuffered];
+
+        guint length = packet_getPayloadLength(packet);
+        if(length > socket_getOutputBufferSpace(socket)) {
+            break;
+        }
+
+        if(packet_getPriority(packet) == 0.0f) {
+            packetqueue_push(&(socket->outputControlBuffer), packet);
+        } else {
+            packetqueue_push(&(socket->outputBuffer), packet);
+        }
+
+        socket->outputBufferLength += length;
+        packet_addDeliveryStatus(packet, PDS_SND_SOCKET_BUFFERED);
+
+        /* a socket bound to INADDR_ANY may use more than one interface */
+        in_addr_t ip = packet_getSourceIP(packet);
+        if(interface == NULL || ip != interfaceIP) {
+            if(interface != NULL) {
+                networkinterface_wantsSend(interface, socket);
+            }
+            interface = host_lookupInterface(host, ip);
+            interfaceIP = ip;
+        }
+    }
+
+    if(numBuffered > 0) {
+        Tracker* tracker = host_getTracker(host);
+        Descriptor* descriptor = (Descriptor *)socket;
+        tracker_updateSocketOutputBuffer(tracker, descriptor->handle, socket->outputBufferLength, socket->outputBufferSize);
+
+        if(_socket_getOutputBufferSpaceIncludingTCP(socket) <= 0) {
+            descriptor_adjustStatus((Descriptor*)socket, DS_WRITABLE, FALSE);
+        }
+
+        if(interface != NULL) {
+            networkinterface_wantsSend(interface, socket);
+        }
+    }
+
+    return numBuffered;
+}
+
 Packet* socket_removeFromOutputBuffer(Socket* socket) {
     MAGIC_ASSERT(socket);
 
     /* see if we have any packets */
-    Packet* packet = !g_queue_is_empty(socket->outputControlBuffer) ?
-            g_queue_pop_head(socket->outputControlBuffer) : g_queue_pop_head(socket->outputBuffer);
+    Packet* packet = !packetqueue_isEmpty(&(socket->outputControlBuffer)) ?
+            packetqueue_pop(&(socket->outputControlBuffer)) : packetqueue_pop(&(socket->outputBuffer));
 
     if(packet) {
         /* just removed a packet */
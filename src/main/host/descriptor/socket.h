@@ -19,6 +19,7 @@
 
 typedef struct _Socket Socket;
 typedef struct _SocketFunctionTable SocketFunctionTable;
+typedef struct _SocketSendLink SocketSendLink;
 
 typedef gboolean (*SocketIsFamilySupportedFunc)(Socket* socket, sa_family_t family);
 typedef gint (*SocketConnectToPeerFunc)(Socket* socket, in_addr_t ip, in_port_t port, sa_family_t family);
@@ -37,6 +38,21 @@ struct _SocketFunctionTable {
     MAGIC_DECLARE;
 };
 
+/* links a socket into a network interface's queue of sockets that have
+ * packets to send, so that queueing the socket does not allocate. a socket
+ * bound to INADDR_ANY may be waiting on the loopback and on the ethernet
+ * interface at the same time, so it has one link for each. */
+struct _SocketSendLink {
+    /* the interface using this link, or NULL if the link is free */
+    gpointer interface;
+    Socket* prev;
+    Socket* next;
+    /* the priority we are filed under in the interface's fifo calendar */
+    gdouble priority;
+};
+
+#define SOCKET_NUM_SEND_LINKS 2
+
 enum SocketFlags {
     SF_NONE = 0,
     SF_BOUND = 1 << 0,
@@ -62,18 +78,21 @@ struct _Socket {
     gchar* unixPath;
 
     /* buffering packets readable by user */
-    GQueue* inputBuffer;
+    PacketQueue inputBuffer;
     gsize inputBufferSize;
     gsize inputBufferSizePending;
     gsize inputBufferLength;
 
     /* buffering packets ready to send */
-    GQueue* outputBuffer;
-    GQueue* outputControlBuffer;
+    PacketQueue outputBuffer;
+    PacketQueue outputControlBuffer;
     gsize outputBufferSize;
     gsize outputBufferSizePending;
     gsize outputBufferLength;
 
+    /* owned by the network interfaces we are waiting to send on */
+    SocketSendLink sendLinks[SOCKET_NUM_SEND_LINKS];
+
     MAGIC_DECLARE;
 };
 
@@ -97,6 +116,9 @@ void socket_setOutputBufferSize(Socket* socket, gsize newSize);
 gsize socket_getOutputBufferLength(Socket* socket);
 gsize socket_getOutputBufferSpace(Socket* socket);
 gboolean socket_addToOutputBuffer(Socket* socket, Packet* packet);
+/* returns the number of packets that fit; the socket owns those, the caller
+ * keeps the refs of the rest */
+guint socket_addBatchToOutputBuffer(Socket* socket, Packet** packets, guint numPackets);
 Packet* socket_removeFromOutputBuffer(Socket* socket);
 
 gboolean socket_isBound(Socket* socket);
@@ -28,13 +28,16 @@
 #include "main/host/descriptor/socket.h"
 #include "main/host/descriptor/tcp_cong.h"
 #include "main/host/descriptor/tcp_cong_reno.h"
+#include "main/host/descriptor/tcp_reassembly.h"
 #include "main/host/descriptor/tcp_retransmit_tally.h"
 #include "main/host/descriptor/transport.h"
 #include "main/host/host.h"
 #include "main/host/network_interface.h"
 #include "main/host/protocol.h"
+#include "main/host/timer_wheel.h"
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
+#include "main/routing/topology.h"
 #include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
@@ -164,12 +167,12 @@ struct _TCP {
         guint32 highestSequence;
         /* total number of packets sent */
         guint32 packetsSent;
-        /* total number of quick acknowledgments sent */
-        guint32 numQuickACKsSent;
-        gboolean delayedACKIsScheduled;
+        /* number of ACKs we will still send quickly before delaying them */
+        guint32 quickACKsRemaining;
+        /* if we enter quick ACK mode like Linux, instead of only ACKing
+         * quickly at the start of the connection */
+        gboolean linuxQuickACK;
         guint32 delayedACKCounter;
-        /* list of selective ACKs, packets received after a missing packet */
-        GList* selectiveACKs;
     } send;
 
     struct {
@@ -179,9 +182,7 @@ struct _TCP {
         gsize queueLength;
         /* retransmission timeout value (rto), in milliseconds */
         gint timeout;
-        /* when the scheduled timer events will expire; empty if no retransmit is scheduled */
-        PriorityQueue* scheduledTimerExpirations;
-        /* our updated expiration time, to determine if previous events are still valid */
+        /* when the retransmit timer should fire, 0 if it is stopped */
         SimulationTime desiredTimerExpiration;
         /* number of times we backed off due to congestion */
         guint backoffCount;
@@ -189,6 +190,17 @@ struct _TCP {
         void *tally;
     } retransmit;
 
+    /* the delayed ACK, retransmit, and close timers share one host timer wheel
+     * entry. each timer only records when it wants to fire (0 if it is not
+     * armed), and the entry is moved to the earliest of them whenever one
+     * changes. the retransmit timer uses retransmit.desiredTimerExpiration. */
+    struct {
+        SimulationTime delayedACKExpiration;
+        SimulationTime closeExpiration;
+        /* created on first use; refs us while it is armed */
+        TimerWheelEntry* entry;
+    } timer;
+
     /* tcp autotuning for the send and recv buffers */
     struct {
         gboolean isEnabled;
@@ -203,6 +215,17 @@ struct _TCP {
     /* congestion object for implementing different types of congestion control (aimd, reno, cubic) */
     TCPCong cong;
 
+    /* analytical model of the congestion window for long-lived bulk flows */
+    struct {
+        gboolean isEnabled;
+        /* if the model currently drives the congestion window */
+        gboolean isActive;
+        /* packets acked in congestion avoidance since the last retransmit timeout */
+        guint32 packetsAckedSteady;
+        /* the steady-state window computed for our path, in packets */
+        guint32 cwnd;
+    } fluid;
+
     struct {
       gint rttSmoothed;
       gint rttVariance;
@@ -224,8 +247,9 @@ struct _TCP {
     /* track amount of queued application data */
     gsize throttledOutputLength;
 
-    /* TCP ensures that the user receives data in-order */
-    PriorityQueue* unorderedInput;
+    /* TCP ensures that the user receives data in-order. the sequence ranges
+     * we hold here beyond receive.next are what we selectively acknowledge. */
+    TCPReassembly* unorderedInput;
     /* track amount of queued application data */
     gsize unorderedInputLength;
 
@@ -601,7 +625,7 @@ void tcp_disableReceiveBufferAutotuning(TCP* tcp) {
 }
 
 // XXX declaration
-static void _tcp_runCloseTimerExpiredTask(TCP* tcp, gpointer userData);
+static void _tcp_scheduleTimerIfNeeded(TCP* tcp);
 static void _tcp_clearRetransmit(TCP* tcp, guint sequence);
 
 static void _tcp_setState(TCP* tcp, enum TCPState state) {
@@ -672,10 +696,7 @@ static void _tcp_setState(TCP* tcp, enum TCPState state) {
             break;
         }
         case TCPS_TIMEWAIT: {
-            /* schedule a close timer self-event to finish out the closing process */
-            descriptor_ref(tcp);
-            Task* closeTask = task_new((TaskCallbackFunc)_tcp_runCloseTimerExpiredTask,
-                    tcp, NULL, descriptor_unref, NULL);
+            /* arm the close timer to finish out the closing process */
             SimulationTime delay = CONFIG_TCPCLOSETIMER_DELAY;
 
             /* if a child of a server initiated the close, close more quickly */
@@ -683,8 +704,9 @@ static void _tcp_setState(TCP* tcp, enum TCPState state) {
                 delay = SIMTIME_ONE_SECOND;
             }
 
-            worker_scheduleTask(closeTask, delay);
-            task_unref(closeTask);
+            SimulationTime now = worker_getCurrentTime();
+            tcp->timer.closeExpiration = now + delay;
+            _tcp_scheduleTimerIfNeeded(tcp);
             break;
         }
         default:
@@ -692,11 +714,6 @@ static void _tcp_setState(TCP* tcp, enum TCPState state) {
     }
 }
 
-static void _tcp_runCloseTimerExpiredTask(TCP* tcp, gpointer userData) {
-    MAGIC_ASSERT(tcp);
-    _tcp_setState(tcp, TCPS_CLOSED);
-}
-
 /* returns the total amount of buffered data in this TCP socket, including TCP-specific buffers */
 gsize tcp_getOutputBufferLength(TCP* tcp) {
     MAGIC_ASSERT(tcp);
@@ -747,11 +764,8 @@ static void _tcp_bufferPacketOut(TCP* tcp, Packet* packet) {
 static void _tcp_bufferPacketIn(TCP* tcp, Packet* packet) {
     MAGIC_ASSERT(tcp);
 
-    if(!priorityqueue_find(tcp->unorderedInput, packet)) {
-        /* TCP wants in-order data */
-        priorityqueue_push(tcp->unorderedInput, packet);
-        packet_ref(packet);
-
+    /* TCP wants in-order data */
+    if(tcpreassembly_insert(tcp->unorderedInput, packet)) {
         /* account for the packet length */
         tcp->unorderedInputLength += packet_getPayloadLength(packet);
 
@@ -788,6 +802,91 @@ static void _tcp_updateSendWindow(TCP* tcp) {
     tcp->send.window = (guint32)MIN(tcp->cong.cwnd, (gint)tcp->receive.lastWindow);
 }
 
+/* the steady-state window of a bulk flow over our path, bounded by the loss rate
+ * of the path (Mathis et al.) and by the bandwidth-delay product of the slower
+ * of our uplink and the peer's downlink. */
+static guint32 _tcp_fluidComputeWindow(TCP* tcp) {
+    MAGIC_ASSERT(tcp);
+
+    in_addr_t sourceIP = tcp_getIP(tcp);
+    in_addr_t destinationIP = tcp_getPeerIP(tcp);
+    if(sourceIP == htonl(INADDR_ANY)) {
+        sourceIP = host_getDefaultIP(worker_getActiveHost());
+    }
+
+    Address* srcAddress = worker_resolveIPToAddress(sourceIP);
+    Address* dstAddress = worker_resolveIPToAddress(destinationIP);
+    GQuark sourceID = (GQuark)address_getID(srcAddress);
+    GQuark destinationID = (GQuark)address_getID(dstAddress);
+
+    guint64 bwUpKiBps = worker_getNodeBandwidthUp(sourceID, sourceIP);
+    guint64 bwDownKiBps = worker_getNodeBandwidthDown(destinationID, destinationIP);
+    guint64 bottleneckBytesPerSecond = MIN(bwUpKiBps, bwDownKiBps) * 1024;
+
+    /* rtt is in milliseconds */
+    guint rtt = _tcp_calculateRTT(tcp);
+    gdouble window = ((gdouble)bottleneckBytesPerSecond) * rtt / 1000.0 / CONFIG_MTU;
+
+    gdouble loss = 1.0 - topology_getReliability(worker_getTopology(), srcAddress, dstAddress);
+    if(loss > 0.0) {
+        window = MIN(window, sqrt(3.0 / (2.0 * loss)));
+    }
+
+    return (guint32)MAX((gdouble)TCP_MIN_CWND, ceil(window));
+}
+
+static void _tcp_fluidEnter(TCP* tcp) {
+    MAGIC_ASSERT(tcp);
+
+    tcp->fluid.cwnd = _tcp_fluidComputeWindow(tcp);
+    tcp->fluid.isActive = TRUE;
+    tcp->cong.hooks->tcp_cong_fluid_enter_ev(tcp);
+    tcp->cong.cwnd = tcp->fluid.cwnd;
+
+    info("[CONG] fluid model took over %s <-> %s with cwnd=%"G_GUINT32_FORMAT,
+            tcp->super.boundString, tcp->super.peerString, tcp->fluid.cwnd);
+}
+
+static void _tcp_fluidExit(TCP* tcp) {
+    MAGIC_ASSERT(tcp);
+
+    if(!tcp->fluid.isActive) {
+        return;
+    }
+
+    tcp->fluid.isActive = FALSE;
+    tcp->fluid.packetsAckedSteady = 0;
+    tcp->cong.hooks->tcp_cong_fluid_exit_ev(tcp);
+
+    info("[CONG] fluid model released %s <-> %s with cwnd=%"G_GUINT32_FORMAT,
+            tcp->super.boundString, tcp->super.peerString, tcp->cong.cwnd);
+}
+
+/* hand the connection to the fluid model once it has been in congestion
+ * avoidance for long enough that its per-packet dynamics no longer matter */
+static void _tcp_fluidCheckEnter(TCP* tcp, guint32 nPacketsAcked) {
+    MAGIC_ASSERT(tcp);
+
+    if(!tcp->fluid.isEnabled || tcp->fluid.isActive || tcp->state != TCPS_ESTABLISHED) {
+        return;
+    }
+
+    gboolean isCongestionAvoidance = tcp->cong.cwnd >= tcp->cong.hooks->tcp_cong_ssthresh(tcp) &&
+            !tcp->cong.hooks->tcp_cong_fast_recovery(tcp);
+    if(!isCongestionAvoidance) {
+        return;
+    }
+
+    tcp->fluid.packetsAckedSteady += nPacketsAcked;
+
+    /* local connections don't cross a modeled path */
+    in_addr_t destinationIP = tcp_getPeerIP(tcp);
+    if(tcp->fluid.packetsAckedSteady >= CONFIG_TCP_FLUID_MIN_ACKED &&
+            destinationIP != htonl(INADDR_LOOPBACK) && destinationIP != tcp_getIP(tcp)) {
+        _tcp_fluidEnter(tcp);
+    }
+}
+
 static Packet* _tcp_createPacket(TCP* tcp, enum ProtocolTCPFlags flags, gconstpointer payload, gsize payloadLength) {
     MAGIC_ASSERT(tcp);
 
@@ -920,43 +1019,49 @@ static void _tcp_clearRetransmitRange(TCP* tcp, guint begin, guint end) {
 }
 
 // XXX forward declaration
-static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData);
+static void _tcp_runTimerExpiredTask(TCP* tcp, gpointer userData);
 
-static void _tcp_scheduleRetransmitTimer(TCP* tcp, SimulationTime now, SimulationTime delay) {
-    MAGIC_ASSERT(tcp);
-
-    SimulationTime* expireTimePtr = g_new0(SimulationTime, 1);
-    *expireTimePtr = now + delay;
-    gboolean success = priorityqueue_push(tcp->retransmit.scheduledTimerExpirations, expireTimePtr);
-
-    if(success) {
-        descriptor_ref(tcp);
-        Task* retexpTask = task_new((TaskCallbackFunc)_tcp_runRetransmitTimerExpiredTask,
-                tcp, NULL, descriptor_unref, NULL);
-        worker_scheduleTask(retexpTask, delay);
-        task_unref(retexpTask);
+static SimulationTime _tcp_getNextTimerExpiration(TCP* tcp) {
+    SimulationTime expirations[] = {
+        tcp->timer.delayedACKExpiration,
+        tcp->retransmit.desiredTimerExpiration,
+        tcp->timer.closeExpiration,
+    };
 
-        debug("%s retransmit timer scheduled for %"G_GUINT64_FORMAT" ns",
-                tcp->super.boundString, *expireTimePtr);
-    } else {
-        warning("%s could not schedule a retransmit timer for %"G_GUINT64_FORMAT" ns",
-                tcp->super.boundString, *expireTimePtr);
-        g_free(expireTimePtr);
+    SimulationTime next = 0;
+    for(gint i = 0; i < G_N_ELEMENTS(expirations); i++) {
+        if(expirations[i] != 0 && (next == 0 || expirations[i] < next)) {
+            next = expirations[i];
+        }
     }
+    return next;
 }
 
-static void _tcp_scheduleRetransmitTimerIfNeeded(TCP* tcp, SimulationTime now) {
-    /* logic for scheduling retransmission events. we only need to schedule one if
-     * we have no events that will allow us to schedule one later. */
-    SimulationTime* nextTimePtr = priorityqueue_peek(tcp->retransmit.scheduledTimerExpirations);
-    if(nextTimePtr && *nextTimePtr <= tcp->retransmit.desiredTimerExpiration) {
-        /* another event will fire before the RTO expires, check again then */
+static void _tcp_scheduleTimerIfNeeded(TCP* tcp) {
+    MAGIC_ASSERT(tcp);
+
+    SimulationTime desiredExpiration = _tcp_getNextTimerExpiration(tcp);
+    if(desiredExpiration == 0) {
+        /* no timer is armed, so don't leave a stale expiration in the wheel */
+        if(tcp->timer.entry) {
+            timerwheel_cancel(tcp->timer.entry);
+        }
         return;
     }
 
-    /* no existing timer will expire as early as desired */
-    SimulationTime delay = tcp->retransmit.desiredTimerExpiration - now;
-    _tcp_scheduleRetransmitTimer(tcp, now, delay);
+    if(!tcp->timer.entry) {
+        TimerWheel* wheel = host_getTimerWheel(worker_getActiveHost());
+        tcp->timer.entry = timerwheel_newEntry(wheel,
+                (TimerWheelCallbackFunc)_tcp_runTimerExpiredTask, tcp, NULL,
+                descriptor_ref, descriptor_unref);
+    }
+
+    /* moving an armed entry is cheap, so always track the earliest timer exactly */
+    if(timerwheel_getExpireTime(tcp->timer.entry) != desiredExpiration) {
+        timerwheel_arm(tcp->timer.entry, desiredExpiration);
+        debug("%s timer scheduled for %"G_GUINT64_FORMAT" ns",
+                tcp->super.boundString, desiredExpiration);
+    }
 }
 
 static void _tcp_setRetransmitTimer(TCP* tcp, SimulationTime now) {
@@ -967,14 +1072,15 @@ static void _tcp_setRetransmitTimer(TCP* tcp, SimulationTime now) {
     SimulationTime delay = tcp->retransmit.timeout * SIMTIME_ONE_MILLISECOND;
     tcp->retransmit.desiredTimerExpiration = now + delay;
 
-    _tcp_scheduleRetransmitTimerIfNeeded(tcp, now);
+    _tcp_scheduleTimerIfNeeded(tcp);
 }
 
 static void _tcp_stopRetransmitTimer(TCP* tcp) {
     MAGIC_ASSERT(tcp);
-    /* we want to stop the timer. since there may be an event already scheduled,
-     * lets mark our desired time as 0 so we know to cancel when the event fires. */
+    /* we want to stop the timer. the shared timer entry moves to whichever
+     * of the other timers is still armed, if any. */
     tcp->retransmit.desiredTimerExpiration = 0;
+    _tcp_scheduleTimerIfNeeded(tcp);
 
     debug("%s retransmit timer disabled", tcp->super.boundString);
 }
@@ -1093,7 +1199,8 @@ void tcp_networkInterfaceIsAboutToSendPacket(TCP* tcp, Packet* packet) {
     SimulationTime now = worker_getCurrentTime();
 
     /* update TCP header to our current advertised window and acknowledgment and timestamps */
-    packet_updateTCP(packet, tcp->receive.next, tcp->send.selectiveACKs, tcp->receive.window, now, tcp->receive.lastTimestamp);
+    GList* selectiveACKs = tcpreassembly_getSelectiveACKs(tcp->unorderedInput, tcp->receive.next);
+    packet_updateTCP(packet, tcp->receive.next, selectiveACKs, tcp->receive.window, now, tcp->receive.lastTimestamp);
 
     /* keep track of the last things we sent them */
     tcp->send.lastAcknowledgment = tcp->receive.next;
@@ -1207,29 +1314,26 @@ static void _tcp_flush(TCP* tcp) {
     }
 
     /* any packets now in order can be pushed to our user input buffer */
-    while(!priorityqueue_isEmpty(tcp->unorderedInput)) {
-        Packet* packet = priorityqueue_peek(tcp->unorderedInput);
+    while(!tcpreassembly_isEmpty(tcp->unorderedInput)) {
+        Packet* packet = tcpreassembly_peek(tcp->unorderedInput, tcp->receive.next);
 
-        PacketTCPHeader* header = packet_getTCPHeader(packet);
+        if(packet) {
+            _rswlog(tcp, "I just received packet %d\n", tcp->receive.next);
 
-        _rswlog(tcp, "I just received packet %d\n", header->sequence);
-        if(header->sequence == tcp->receive.next) {
             /* move from the unordered buffer to user input buffer */
             gboolean fitInBuffer = socket_addToInputBuffer(&(tcp->super), packet);
 
             if(fitInBuffer) {
-                // fprintf(stderr, "SND/RCV Recv %s %s %d @ %f\n", tcp->super.boundString, tcp->super.peerString, header.sequence, dtime);
-                tcp->receive.lastSequence = header->sequence;
-                priorityqueue_pop(tcp->unorderedInput);
-                packet_unref(packet);
+                tcp->receive.lastSequence = tcp->receive.next;
+                packet = tcpreassembly_take(tcp->unorderedInput, tcp->receive.next);
                 tcp->unorderedInputLength -= packet_getPayloadLength(packet);
+                packet_unref(packet);
                 (tcp->receive.next)++;
                 continue;
             }
         }
 
-        _rswlog(tcp, "Could not buffer %d, was expecting %d\n", header->sequence,
-                tcp->receive.next);
+        _rswlog(tcp, "Could not buffer, was expecting %d\n", tcp->receive.next);
 
         /* we could not buffer it because its out of order or we have no space */
         break;
@@ -1277,15 +1381,9 @@ static void _tcp_flush(TCP* tcp) {
     }
 }
 
-static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
+static void _tcp_runRetransmitTimer(TCP* tcp, SimulationTime now) {
     MAGIC_ASSERT(tcp);
 
-    /* a timer expired, update our timer tracking state */
-    SimulationTime now = worker_getCurrentTime();
-    SimulationTime* scheduledTimerExpirationPtr = priorityqueue_pop(tcp->retransmit.scheduledTimerExpirations);
-    utility_assert(scheduledTimerExpirationPtr);
-    g_free(scheduledTimerExpirationPtr);
-
     debug("%s a scheduled retransmit timer expired", tcp->super.boundString);
 
     /* if we are closed, we don't care */
@@ -1300,16 +1398,6 @@ static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
         return;
     }
 
-    /* if the timer should be off or was reset, ignore this event */
-    if(tcp->retransmit.desiredTimerExpiration == 0) {
-        return;
-    } else if(tcp->retransmit.desiredTimerExpiration > now) {
-        /* the timer was reset after this event was scheduled, check if we need to
-         * schedule another event, or if we can do it when the next event fires instead */
-        _tcp_scheduleRetransmitTimerIfNeeded(tcp, now);
-        return;
-    }
-
     /* rfc 6298, section 5.4-5.7 (http://tools.ietf.org/html/rfc6298)
      * if we get here, this is a valid timer expiration and we need to do a retransmission
      * do exponential backoff */
@@ -1317,6 +1405,10 @@ static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
     _tcp_setRetransmitTimeout(tcp, tcp->retransmit.timeout * 2);
     _tcp_setRetransmitTimer(tcp, now);
 
+    /* a timeout means the path is worse than the fluid model assumed */
+    _tcp_fluidExit(tcp);
+    tcp->fluid.packetsAckedSteady = 0;
+
     tcp->cong.hooks->tcp_cong_timeout_ev(tcp);
     info("[CONG] a congestion timeout has occurred on %s", tcp->super.boundString);
     _tcp_logCongestionInfo(tcp);
@@ -1332,6 +1424,39 @@ static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
     _tcp_flush(tcp);
 }
 
+static void _tcp_runDelayedACKTimer(TCP* tcp) {
+    MAGIC_ASSERT(tcp);
+    if(tcp->send.delayedACKCounter > 0 && tcp->state != TCPS_CLOSED) {
+        _tcp_sendControlPacket(tcp, PTCP_ACK);
+        tcp->send.delayedACKCounter = 0;
+    }
+}
+
+static void _tcp_runTimerExpiredTask(TCP* tcp, gpointer userData) {
+    MAGIC_ASSERT(tcp);
+
+    /* the wheel entry fires for the earliest timer, but others may be due too */
+    SimulationTime now = worker_getCurrentTime();
+
+    if(tcp->timer.delayedACKExpiration != 0 && tcp->timer.delayedACKExpiration <= now) {
+        tcp->timer.delayedACKExpiration = 0;
+        _tcp_runDelayedACKTimer(tcp);
+    }
+
+    if(tcp->retransmit.desiredTimerExpiration != 0 && tcp->retransmit.desiredTimerExpiration <= now) {
+        _tcp_runRetransmitTimer(tcp, now);
+    }
+
+    if(tcp->timer.closeExpiration != 0 && tcp->timer.closeExpiration <= now) {
+        tcp->timer.closeExpiration = 0;
+        _tcp_setState(tcp, TCPS_CLOSED);
+    }
+
+    if(tcp->state != TCPS_CLOSED) {
+        _tcp_scheduleTimerIfNeeded(tcp);
+    }
+}
+
 gboolean tcp_isFamilySupported(TCP* tcp, sa_family_t family) {
     MAGIC_ASSERT(tcp);
     return family == AF_INET || family == AF_UNIX ? TRUE : FALSE;
@@ -1576,22 +1701,31 @@ static TCP* _tcp_getSourceTCP(TCP* tcp, in_addr_t ip, in_port_t port) {
     return tcp;
 }
 
-static GList* _tcp_removeSacks(GList* selectiveACKs, gint sequence) {
-    GList *unacked = NULL;
-    if(selectiveACKs) {
-        GList *iter = selectiveACKs;
-        while(iter) {
-            gint sackSequence = GPOINTER_TO_INT(iter->data);
+/* with --tcp-linux-quickack, like Linux (see tcp_enter_quickack_mode() in
+ * net/ipv4/tcp_input.c), we ACK quickly for a bounded number of segments at the
+ * start of a transfer and after an idle period so the sender can open its
+ * window. otherwise ACKs are delayed so that more of them coalesce. */
+static void _tcp_enterQuickACKMode(TCP* tcp) {
+    MAGIC_ASSERT(tcp);
+    guint32 quickACKs = MIN(tcp->receive.window / 2, CONFIG_TCP_MAX_QUICKACKS);
+    tcp->send.quickACKsRemaining = MAX(quickACKs, 2);
+}
 
-            if(sackSequence > sequence) {
-                unacked = g_list_append(unacked, iter->data);
-            }
+static SimulationTime _tcp_getDelayedACKDelay(TCP* tcp) {
+    MAGIC_ASSERT(tcp);
 
-            iter = g_list_next(iter);
-        }
-        g_list_free(selectiveACKs);
+    SimulationTime delay = 0;
+    if(tcp->send.quickACKsRemaining > 0) {
+        /* we want the other side to get the ACKs sooner so we don't throttle its sending rate */
+        tcp->send.quickACKsRemaining--;
+        delay = 1*SIMTIME_ONE_MILLISECOND;
+    } else {
+        delay = 5*SIMTIME_ONE_MILLISECOND;
     }
-    return unacked;
+
+    debug("%s <-> %s: delaying ACK by %"G_GUINT64_FORMAT" ms", tcp->super.boundString,
+            tcp->super.peerString, (guint64)(delay / SIMTIME_ONE_MILLISECOND));
+    return delay;
 }
 
 TCPProcessFlags _tcp_dataProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *header) {
@@ -1617,30 +1751,8 @@ TCPProcessFlags _tcp_dataProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *h
         gboolean isNextPacket = (header->sequence == tcp->receive.next) ? TRUE : FALSE;
         gboolean packetFits = (packetLength <= _tcp_getBufferSpaceIn(tcp)) ? TRUE : FALSE;
 
-        /* SACK: if not next packet, one was dropped and we need to include this in the selective ACKs */
-        if(!isNextPacket && packetFits) {
-            tcp->send.selectiveACKs = g_list_append(tcp->send.selectiveACKs, GINT_TO_POINTER(header->sequence));
-        } else if(tcp->send.selectiveACKs && g_list_length(tcp->send.selectiveACKs) > 0) {
-            /* find the first gap in SACKs and remove everything before it */
-            GList *iter = g_list_first(tcp->send.selectiveACKs);
-            GList *next = g_list_next(iter);
-
-            gint firstSequence = GPOINTER_TO_INT(iter->data);
-            if(firstSequence <= header->sequence + 1) {
-                while(next) {
-                    gint currSequence = GPOINTER_TO_INT(iter->data);
-                    gint nextSequence = GPOINTER_TO_INT(next->data);
-                    /* check for a gap in sequences */
-                    if(currSequence + 1 < nextSequence && currSequence > header->sequence) {
-                        break;
-                    }
-                    iter = next;
-                    next = g_list_next(iter);
-                }
-
-                tcp->send.selectiveACKs = _tcp_removeSacks(tcp->send.selectiveACKs, GPOINTER_TO_INT(iter->data));
-            }
-        }
+        /* SACK: out-of-order packets we buffer are selectively acknowledged from
+         * the ranges held in the unordered input, so there is nothing to track here */
 
         DescriptorStatus s = descriptor_getStatus((Descriptor*) tcp);
         gboolean waitingUserRead = (s & DS_READABLE) ? TRUE : FALSE;
@@ -1648,6 +1760,13 @@ TCPProcessFlags _tcp_dataProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *h
         if((isNextPacket && !waitingUserRead) || (packetFits)) {
             /* make sure its in order */
             _tcp_bufferPacketIn(tcp, packet);
+
+            /* the sender may have been idle long enough to have collapsed its window */
+            SimulationTime idleTime = now - tcp->info.lastDataReceived;
+            if(tcp->send.linuxQuickACK && (tcp->info.lastDataReceived == 0 ||
+                    idleTime > (SimulationTime)tcp->retransmit.timeout * SIMTIME_ONE_MILLISECOND)) {
+                _tcp_enterQuickACKMode(tcp);
+            }
             tcp->info.lastDataReceived = now;
             flags |= TCP_PF_DATA_RECEIVED;
         } else {
@@ -1690,7 +1809,10 @@ TCPProcessFlags _tcp_ackProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *he
     if (is_dup) {
       info("[CONG-AVOID] duplicate ack");
       _tcp_logCongestionInfo(tcp);
-      tcp->cong.hooks->tcp_cong_duplicate_ack_ev(tcp);
+      /* random loss on the path is already part of the fluid model */
+      if(!tcp->fluid.isActive) {
+          tcp->cong.hooks->tcp_cong_duplicate_ack_ev(tcp);
+      }
     }
 
     gint nPacketsAcked = 0;
@@ -1712,7 +1834,12 @@ TCPProcessFlags _tcp_ackProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *he
             flags |= TCP_PF_DATA_ACKED;
 
             info("[CONG] %i packets were acked", nPacketsAcked);
-            tcp->cong.hooks->tcp_cong_new_ack_ev(tcp, nPacketsAcked);
+            if(tcp->fluid.isActive) {
+                tcp->cong.cwnd = tcp->fluid.cwnd;
+            } else {
+                tcp->cong.hooks->tcp_cong_new_ack_ev(tcp, nPacketsAcked);
+                _tcp_fluidCheckEnter(tcp, (guint32)nPacketsAcked);
+            }
 
             /* increase send buffer size with autotuning */
             if(tcp->autotune.isEnabled && !tcp->autotune.userDisabledSend &&
@@ -1739,6 +1866,12 @@ TCPProcessFlags _tcp_ackProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *he
     if(tcp->retransmit.queueLength == 0) {
         /* all outstanding data has been acked */
         _tcp_stopRetransmitTimer(tcp);
+
+        /* the application stopped keeping the pipe full, so this is no longer
+         * a bulk flow that the fluid model describes */
+        if(tcp->throttledOutputLength == 0) {
+            _tcp_fluidExit(tcp);
+        }
     } else if(nPacketsAcked > 0) {
         /* new data has been acked */
         _tcp_setRetransmitTimer(tcp, now);
@@ -1764,17 +1897,8 @@ static void _tcp_logCongestionInfo(TCP* tcp) {
             tcp->super.super.super.handle);
 }
 
-static void _tcp_sendACKTaskCallback(TCP* tcp, gpointer userData) {
-    MAGIC_ASSERT(tcp);
-    tcp->send.delayedACKIsScheduled = FALSE;
-    if(tcp->send.delayedACKCounter > 0) {
-        _tcp_sendControlPacket(tcp, PTCP_ACK);
-        tcp->send.delayedACKCounter = 0;
-    }
-}
-
 /* return TRUE if the packet should be retransmitted */
-void tcp_processPacket(TCP* tcp, Packet* packet) {
+static void _tcp_processSegment(TCP* tcp, Packet* packet) {
     MAGIC_ASSERT(tcp);
 
     /* fetch the TCP info from the packet */
@@ -2063,29 +2187,12 @@ void tcp_processPacket(TCP* tcp, Packet* packet) {
             /* just send the response now */
             _tcp_sendControlPacket(tcp, responseFlags);
         } else {
-            if(tcp->send.delayedACKIsScheduled == FALSE) {
-                /* we need to send an ACK, lets schedule a task so we don't send an ACK
+            if(tcp->timer.delayedACKExpiration == 0) {
+                /* we need to send an ACK, lets arm the delayed ACK timer so we don't send an ACK
                  * for all packets that are received during this same simtime receiving round. */
-                Task* sendACKTask = task_new((TaskCallbackFunc)_tcp_sendACKTaskCallback,
-                                tcp, NULL, descriptor_unref, NULL);
-                /* taks holds a ref to tcp */
-                descriptor_ref(tcp);
-
-                /* figure out what we should use as delay */
-                SimulationTime delay = 0;
-                /* "quick acknowledgments" happen at the beginning of a connection */
-                if(tcp->send.numQuickACKsSent < 1000) {
-                    /* we want the other side to get the ACKs sooner so we don't throttle its sending rate */
-                    delay = 1*SIMTIME_ONE_MILLISECOND;
-                    tcp->send.numQuickACKsSent++;
-                } else {
-                    delay = 5*SIMTIME_ONE_MILLISECOND;
-                }
-
-                worker_scheduleTask(sendACKTask, delay);
-                task_unref(sendACKTask);
-
-                tcp->send.delayedACKIsScheduled = TRUE;
+                SimulationTime now = worker_getCurrentTime();
+                tcp->timer.delayedACKExpiration = now + _tcp_getDelayedACKDelay(tcp);
+                _tcp_scheduleTimerIfNeeded(tcp);
             }
             tcp->send.delayedACKCounter++;
         }
@@ -2098,6 +2205,27 @@ void tcp_processPacket(TCP* tcp, Packet* packet) {
     tcp->receive.lastTimestamp = 0;
 }
 
+void tcp_processPacket(TCP* tcp, Packet* packet) {
+    MAGIC_ASSERT(tcp);
+
+    GList* segments = packet_getSegments(packet);
+    if(!segments) {
+        _tcp_processSegment(tcp, packet);
+        return;
+    }
+
+    /* a TSO aggregate is processed as the in-order run of segments it carries,
+     * all within this one receive event. the delayed ACK logic then coalesces
+     * the ACKs for the whole run. hold a ref in case a segment closes us. */
+    descriptor_ref(tcp);
+    for(GList* item = segments; item; item = g_list_next(item)) {
+        Packet* segment = item->data;
+        packet_addDeliveryStatus(segment, PDS_RCV_SOCKET_PROCESSED);
+        _tcp_processSegment(tcp, segment);
+    }
+    descriptor_unref(tcp);
+}
+
 void tcp_dropPacket(TCP* tcp, Packet* packet) {
     MAGIC_ASSERT(tcp);
 
@@ -2123,9 +2251,7 @@ static void _tcp_endOfFileSignalled(TCP* tcp, enum TCPFlags flags) {
     }
 }
 
-gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t ip, in_port_t port) {
-    MAGIC_ASSERT(tcp);
-
+static gint _tcp_checkSendEndOfFile(TCP* tcp) {
     /* return 0 to signal close, if necessary */
     if(tcp->error & TCPE_SEND_EOF)
     {
@@ -2138,7 +2264,10 @@ gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t
             return -3;
         }
     }
+    return 0;
+}
 
+static gsize _tcp_bufferUserData(TCP* tcp, gconstpointer buffer, gsize nBytes) {
     /* maximum data we can send network, o/w tcp truncates and only sends 65536*/
     gsize acceptable = MIN(nBytes, 65535);
     gsize space = _tcp_getBufferSpaceOut(tcp);
@@ -2169,6 +2298,19 @@ gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t
         bytesCopied += copyLength;
     }
 
+    return bytesCopied;
+}
+
+gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t ip, in_port_t port) {
+    MAGIC_ASSERT(tcp);
+
+    gint eofResult = _tcp_checkSendEndOfFile(tcp);
+    if(eofResult != 0) {
+        return eofResult;
+    }
+
+    gsize bytesCopied = _tcp_bufferUserData(tcp, buffer, nBytes);
+
     debug("%s <-> %s: sending %"G_GSIZE_FORMAT" user bytes", tcp->super.boundString, tcp->super.peerString, bytesCopied);
 
     /* now flush as much as possible out to socket */
@@ -2177,6 +2319,44 @@ gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t
     return (gssize) (bytesCopied == 0 ? -1 : bytesCopied);
 }
 
+gssize tcp_sendUserMessages(TCP* tcp, TransportMessage* messages, guint numMessages) {
+    MAGIC_ASSERT(tcp);
+    utility_assert(messages || numMessages == 0);
+
+    gint eofResult = _tcp_checkSendEndOfFile(tcp);
+    if(eofResult != 0) {
+        return eofResult;
+    }
+
+    /* segment every message into the stream first and flush once at the end,
+     * instead of running the flush logic for each message */
+    guint numSent = 0;
+    gsize totalBytesCopied = 0;
+    for(numSent = 0; numSent < numMessages; numSent++) {
+        TransportMessage* message = &messages[numSent];
+        if(message->nBytes > 0 && _tcp_getBufferSpaceOut(tcp) == 0) {
+            break;
+        }
+
+        message->bytesCopied = _tcp_bufferUserData(tcp, message->buffer, message->nBytes);
+        totalBytesCopied += message->bytesCopied;
+
+        if(message->bytesCopied < message->nBytes) {
+            /* a partial message still counts, but ends the batch */
+            numSent++;
+            break;
+        }
+    }
+
+    debug("%s <-> %s: sending %"G_GSIZE_FORMAT" user bytes from %u messages",
+            tcp->super.boundString, tcp->super.peerString, totalBytesCopied, numSent);
+
+    _tcp_flush(tcp);
+
+    /* zero-length messages count as sent, so only fail if none was */
+    return (gssize) (numSent == 0 ? -1 : numSent);
+}
+
 static void _tcp_sendWindowUpdate(TCP* tcp, gpointer data) {
     MAGIC_ASSERT(tcp);
     debug("%s <-> %s: receive window opened, advertising the new "
@@ -2330,9 +2510,11 @@ void tcp_free(TCP* tcp) {
     MAGIC_ASSERT(tcp);
 
     priorityqueue_free(tcp->throttledOutput);
-    priorityqueue_free(tcp->unorderedInput);
+    tcpreassembly_free(tcp->unorderedInput);
     g_hash_table_destroy(tcp->retransmit.queue);
-    priorityqueue_free(tcp->retransmit.scheduledTimerExpirations);
+    if(tcp->timer.entry) {
+        timerwheel_freeEntry(tcp->timer.entry);
+    }
 
     if(tcp->child) {
         MAGIC_ASSERT(tcp->child);
@@ -2491,19 +2673,22 @@ TCP* tcp_new(gint handle, guint receiveBufferSize, guint sendBufferSize) {
     tcp->receive.lastAcknowledgment = initialSequenceNumber;
 
     tcp->autotune.isEnabled = TRUE;
+    tcp->fluid.isEnabled = options_doTCPFluidModel(options);
+
+    tcp->send.linuxQuickACK = options_doTCPLinuxQuickACK(options);
+    if(!tcp->send.linuxQuickACK) {
+        /* "quick acknowledgments" happen at the beginning of a connection */
+        tcp->send.quickACKsRemaining = CONFIG_TCP_INITIAL_QUICKACKS;
+    }
 
     tcp->throttledOutput =
             priorityqueue_new((GCompareDataFunc)packet_compareTCPSequence, NULL, (GDestroyNotify)packet_unref);
-    tcp->unorderedInput =
-            priorityqueue_new((GCompareDataFunc)packet_compareTCPSequence, NULL, (GDestroyNotify)packet_unref);
+    tcp->unorderedInput = tcpreassembly_new();
     tcp->retransmit.queue =
             g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)packet_unref);
 
     retransmit_tally_init(&tcp->retransmit.tally);
 
-    tcp->retransmit.scheduledTimerExpirations =
-            priorityqueue_new((GCompareDataFunc)utility_simulationTimeCompare, NULL, g_free);
-
     /* initialize tcp retransmission timeout */
     _tcp_setRetransmitTimeout(tcp, CONFIG_TCP_RTO_INIT);
 
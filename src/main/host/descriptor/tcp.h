@@ -12,6 +12,7 @@
 #include <netinet/tcp.h>
 #include <sys/un.h>
 
+#include "main/host/descriptor/transport.h"
 #include "main/routing/packet.h"
 
 #define TCP_MIN_CWND 10
@@ -43,6 +44,9 @@ gint tcp_getConnectError(TCP* tcp);
 void tcp_getInfo(TCP* tcp, struct tcp_info *tcpinfo);
 void tcp_enterServerMode(TCP* tcp, gint backlog);
 gint tcp_acceptServerPeer(TCP* tcp, in_addr_t* ip, in_port_t* port, gint* acceptedHandle);
+/* sends the messages back to back on the stream and returns the number of
+ * messages sent, or the same negative codes as the transport send function */
+gssize tcp_sendUserMessages(TCP* tcp, TransportMessage* messages, guint numMessages);
 
 struct TCPCong_ *tcp_cong(TCP *tcp);
 
@@ -13,6 +13,8 @@ typedef bool (*TCPCongFastRecovery)(TCP *tcp);
 typedef void (*TCPCongNewAckEv)(TCP *tcp, guint32 n);
 typedef void (*TCPCongTimeoutEv)(TCP *tcp);
 typedef guint32 (*TCPCongSSThresh)(TCP *tcp);
+typedef void (*TCPCongFluidEnterEv)(TCP *tcp);
+typedef void (*TCPCongFluidExitEv)(TCP *tcp);
 
 typedef struct TCPCongHooks_ {
     TCPCongDelete tcp_cong_delete;
@@ -21,6 +23,9 @@ typedef struct TCPCongHooks_ {
     TCPCongNewAckEv tcp_cong_new_ack_ev;
     TCPCongTimeoutEv tcp_cong_timeout_ev;
     TCPCongSSThresh tcp_cong_ssthresh;
+    // the fluid model takes over cwnd between enter and exit
+    TCPCongFluidEnterEv tcp_cong_fluid_enter_ev;
+    TCPCongFluidExitEv tcp_cong_fluid_exit_ev;
 } TCPCongHooks;
 
 typedef struct TCPCong_ {
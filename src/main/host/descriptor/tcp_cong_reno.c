@@ -165,13 +165,32 @@ static guint32 tcp_cong_reno_ssthresh_(TCP *tcp) {
     return reno->ssthresh;
 }
 
+static void tcp_cong_reno_fluid_enter_ev_(TCP *tcp) {
+    CAReno *reno = tcp_cong(tcp)->ca;
+    reno->duplicate_ack_n = 0;
+    reno->cong_avoid_nacked = 0;
+    info("[CONG] fd %i transition_to_fluid", ((Descriptor*)tcp)->handle);
+}
+
+/* Resume congestion avoidance from the window the fluid model left us with. */
+static void tcp_cong_reno_fluid_exit_ev_(TCP *tcp) {
+    CAReno *reno = tcp_cong(tcp)->ca;
+    reno->duplicate_ack_n = 0;
+    reno->ssthresh = tcp_cong(tcp)->cwnd;
+    reno->cong_avoid_nacked = 0;
+    reno->state_hooks = cong_avoid_hooks_();
+    info("[CONG] fd %i transition_to_cong_avoid from fluid", ((Descriptor*)tcp)->handle);
+}
+
 static const struct TCPCongHooks_ reno_hooks_ = {
     .tcp_cong_delete = tcp_cong_reno_delete_,
     .tcp_cong_duplicate_ack_ev = tcp_cong_reno_duplicate_ack_ev_,
     .tcp_cong_fast_recovery = tcp_cong_reno_fast_recovery_,
     .tcp_cong_new_ack_ev = tcp_cong_reno_new_ack_ev_,
     .tcp_cong_timeout_ev = tcp_cong_reno_timeout_ev_,
-    .tcp_cong_ssthresh = tcp_cong_reno_ssthresh_
+    .tcp_cong_ssthresh = tcp_cong_reno_ssthresh_,
+    .tcp_cong_fluid_enter_ev = tcp_cong_reno_fluid_enter_ev_,
+    .tcp_cong_fluid_exit_ev = tcp_cong_reno_fluid_exit_ev_
 };
 
 void tcp_cong_reno_init(TCP *tcp) {
@@ -189,7 +208,9 @@ static const struct TCPCongHooks_ slow_start_hooks__ = {
     .tcp_cong_fast_recovery = NULL,
     .tcp_cong_new_ack_ev = ca_reno_slow_start_new_ack_ev_,
     .tcp_cong_timeout_ev = NULL,
-    .tcp_cong_ssthresh = NULL
+    .tcp_cong_ssthresh = NULL,
+    .tcp_cong_fluid_enter_ev = NULL,
+    .tcp_cong_fluid_exit_ev = NULL
 };
 
 static const struct TCPCongHooks_ fast_recovery_hooks__ = {
@@ -198,7 +219,9 @@ static const struct TCPCongHooks_ fast_recovery_hooks__ = {
     .tcp_cong_fast_recovery = NULL,
     .tcp_cong_new_ack_ev = ca_reno_fast_recovery_new_ack_ev_,
     .tcp_cong_timeout_ev = NULL,
-    .tcp_cong_ssthresh = NULL
+    .tcp_cong_ssthresh = NULL,
+    .tcp_cong_fluid_enter_ev = NULL,
+    .tcp_cong_fluid_exit_ev = NULL
 };
 
 /* slow start and cong avoidance have the same dupl act behavior */
@@ -208,7 +231,9 @@ static const struct TCPCongHooks_ cong_avoid_hooks__ = {
     .tcp_cong_fast_recovery = NULL,
     .tcp_cong_new_ack_ev = ca_reno_cong_avoid_new_ack_ev_,
     .tcp_cong_timeout_ev = NULL,
-    .tcp_cong_ssthresh = NULL
+    .tcp_cong_ssthresh = NULL,
+    .tcp_cong_fluid_enter_ev = NULL,
+    .tcp_cong_fluid_exit_ev = NULL
 };
 
 static inline const struct TCPCongHooks_ *slow_start_hooks_() {
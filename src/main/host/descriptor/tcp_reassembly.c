@@ -0,0 +1,190 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/host/descriptor/tcp_reassembly.h"
+
+#include <glib.h>
+
+#include "main/routing/packet.h"
+#include "main/utility/utility.h"
+
+typedef struct _TCPReassemblyRange TCPReassemblyRange;
+struct _TCPReassemblyRange {
+    /* first sequence in the range */
+    guint32 begin;
+    /* one past the last sequence in the range */
+    guint32 end;
+};
+
+struct _TCPReassembly {
+    /* sequence number to held packet */
+    GHashTable* packets;
+    /* sorted, non-overlapping, non-adjacent TCPReassemblyRange entries */
+    GArray* ranges;
+
+    /* selective ACKs generated from the ranges, rebuilt when they change */
+    GList* selectiveACKs;
+    guint32 selectiveACKsNext;
+    gboolean selectiveACKsAreValid;
+};
+
+TCPReassembly* tcpreassembly_new() {
+    TCPReassembly* reassembly = g_slice_new0(TCPReassembly);
+    reassembly->packets = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify)packet_unref);
+    reassembly->ranges = g_array_new(FALSE, FALSE, sizeof(TCPReassemblyRange));
+    return reassembly;
+}
+
+void tcpreassembly_free(TCPReassembly* reassembly) {
+    utility_assert(reassembly);
+    g_hash_table_destroy(reassembly->packets);
+    g_array_free(reassembly->ranges, TRUE);
+    if(reassembly->selectiveACKs) {
+        g_list_free(reassembly->selectiveACKs);
+    }
+    g_slice_free(TCPReassembly, reassembly);
+}
+
+gboolean tcpreassembly_isEmpty(TCPReassembly* reassembly) {
+    utility_assert(reassembly);
+    return reassembly->ranges->len == 0;
+}
+
+static inline TCPReassemblyRange* _tcpreassembly_getRange(TCPReassembly* reassembly, guint index) {
+    return &g_array_index(reassembly->ranges, TCPReassemblyRange, index);
+}
+
+/* index of the first range whose end is not below sequence, i.e., the range that
+ * contains or could be extended to sequence, or the insert position for it */
+static guint _tcpreassembly_search(TCPReassembly* reassembly, guint32 sequence) {
+    guint low = 0;
+    guint high = reassembly->ranges->len;
+    while(low < high) {
+        guint mid = low + (high - low) / 2;
+        if(_tcpreassembly_getRange(reassembly, mid)->end < sequence) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void _tcpreassembly_addSequence(TCPReassembly* reassembly, guint32 sequence) {
+    guint index = _tcpreassembly_search(reassembly, sequence);
+
+    if(index < reassembly->ranges->len) {
+        TCPReassemblyRange* range = _tcpreassembly_getRange(reassembly, index);
+
+        if(range->end == sequence) {
+            /* extends the range upward, which may close the gap to the next one */
+            range->end++;
+            if(index + 1 < reassembly->ranges->len) {
+                TCPReassemblyRange* next = _tcpreassembly_getRange(reassembly, index + 1);
+                if(next->begin == range->end) {
+                    range->end = next->end;
+                    g_array_remove_index(reassembly->ranges, index + 1);
+                }
+            }
+            return;
+        } else if(range->begin == sequence + 1) {
+            /* extends the range downward; the previous range ends below sequence */
+            range->begin = sequence;
+            return;
+        }
+    }
+
+    TCPReassemblyRange range = {.begin = sequence, .end = sequence + 1};
+    g_array_insert_val(reassembly->ranges, index, range);
+}
+
+static void _tcpreassembly_removeSequence(TCPReassembly* reassembly, guint32 sequence) {
+    guint index = _tcpreassembly_search(reassembly, sequence + 1);
+    utility_assert(index < reassembly->ranges->len);
+
+    TCPReassemblyRange* range = _tcpreassembly_getRange(reassembly, index);
+    utility_assert(range->begin <= sequence && sequence < range->end);
+
+    if(range->begin + 1 == range->end) {
+        g_array_remove_index(reassembly->ranges, index);
+    } else if(range->begin == sequence) {
+        range->begin++;
+    } else if(range->end == sequence + 1) {
+        range->end--;
+    } else {
+        TCPReassemblyRange upper = {.begin = sequence + 1, .end = range->end};
+        range->end = sequence;
+        g_array_insert_val(reassembly->ranges, index + 1, upper);
+    }
+}
+
+gboolean tcpreassembly_insert(TCPReassembly* reassembly, Packet* packet) {
+    utility_assert(reassembly);
+
+    guint32 sequence = (guint32)packet_getTCPHeader(packet)->sequence;
+    gpointer key = GUINT_TO_POINTER(sequence);
+
+    if(g_hash_table_contains(reassembly->packets, key)) {
+        return FALSE;
+    }
+
+    packet_ref(packet);
+    g_hash_table_insert(reassembly->packets, key, packet);
+    _tcpreassembly_addSequence(reassembly, sequence);
+    reassembly->selectiveACKsAreValid = FALSE;
+
+    return TRUE;
+}
+
+Packet* tcpreassembly_peek(TCPReassembly* reassembly, guint32 sequence) {
+    utility_assert(reassembly);
+    return g_hash_table_lookup(reassembly->packets, GUINT_TO_POINTER(sequence));
+}
+
+Packet* tcpreassembly_take(TCPReassembly* reassembly, guint32 sequence) {
+    utility_assert(reassembly);
+
+    gpointer key = GUINT_TO_POINTER(sequence);
+    Packet* packet = g_hash_table_lookup(reassembly->packets, key);
+
+    if(packet) {
+        g_hash_table_steal(reassembly->packets, key);
+        _tcpreassembly_removeSequence(reassembly, sequence);
+        reassembly->selectiveACKsAreValid = FALSE;
+    }
+
+    return packet;
+}
+
+GList* tcpreassembly_getSelectiveACKs(TCPReassembly* reassembly, guint32 nextSequence) {
+    utility_assert(reassembly);
+
+    if(reassembly->selectiveACKsAreValid && reassembly->selectiveACKsNext == nextSequence) {
+        return reassembly->selectiveACKs;
+    }
+
+    if(reassembly->selectiveACKs) {
+        g_list_free(reassembly->selectiveACKs);
+        reassembly->selectiveACKs = NULL;
+    }
+
+    /* walk backward so that prepending builds an ascending list */
+    for(guint i = reassembly->ranges->len; i > 0; i--) {
+        TCPReassemblyRange* range = _tcpreassembly_getRange(reassembly, i - 1);
+        if(range->end <= nextSequence) {
+            break;
+        }
+        guint32 begin = MAX(range->begin, nextSequence + 1);
+        for(guint32 sequence = range->end; sequence > begin; sequence--) {
+            reassembly->selectiveACKs = g_list_prepend(reassembly->selectiveACKs,
+                    GINT_TO_POINTER(sequence - 1));
+        }
+    }
+
+    reassembly->selectiveACKsNext = nextSequence;
+    reassembly->selectiveACKsAreValid = TRUE;
+    return reassembly->selectiveACKs;
+}
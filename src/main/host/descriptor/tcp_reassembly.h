@@ -0,0 +1,34 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_TCP_REASSEMBLY_H_
+#define SHD_TCP_REASSEMBLY_H_
+
+#include <glib.h>
+
+#include "main/routing/packet.h"
+
+/* Holds received TCP segments that can not yet be delivered to the user in
+ * order. Segments are indexed by sequence number, and the sequences we hold are
+ * kept as a sorted array of coalesced ranges from which we generate SACKs. */
+typedef struct _TCPReassembly TCPReassembly;
+
+TCPReassembly* tcpreassembly_new();
+void tcpreassembly_free(TCPReassembly* reassembly);
+
+gboolean tcpreassembly_isEmpty(TCPReassembly* reassembly);
+
+/* takes a ref to the packet. returns FALSE if we already hold its sequence. */
+gboolean tcpreassembly_insert(TCPReassembly* reassembly, Packet* packet);
+Packet* tcpreassembly_peek(TCPReassembly* reassembly, guint32 sequence);
+/* the caller owns the returned reference */
+Packet* tcpreassembly_take(TCPReassembly* reassembly, guint32 sequence);
+
+/* the sequences we hold beyond the next in-order sequence, in the packet header
+ * selective ACK format. the list is owned by the reassembly buffer and is valid
+ * until it is modified. */
+GList* tcpreassembly_getSelectiveACKs(TCPReassembly* reassembly, guint32 nextSequence);
+
+#endif /* SHD_TCP_REASSEMBLY_H_ */
@@ -44,35 +44,49 @@ static bool range_adj(const SeqRange &lhs, const SeqRange &rhs) {
    return (lhs.second == rhs.first || rhs.second == lhs.first);
 }
 
-static bool ranges_contains(const Ranges &ranges, SeqNum value) {
-  for (const auto &range : ranges) {
-    if (range_contains(range, value)) {
-      return true;
-    }
-  }
+/* The ranges are sorted and disjoint, so both their starts and their ends are
+ * strictly increasing and we can binary search on either. */
+static Ranges::const_iterator ranges_first_ending_after(const Ranges &ranges,
+                                                        SeqNum value) {
+   return std::upper_bound(ranges.cbegin(), ranges.cend(), value,
+                           [](SeqNum v, const SeqRange &range) {
+                              return v < range.second;
+                           });
+}
 
-  return false;
+static Ranges::iterator ranges_first_starting_after(Ranges &ranges,
+                                                    SeqNum value) {
+   return std::upper_bound(ranges.begin(), ranges.end(), value,
+                           [](SeqNum v, const SeqRange &range) {
+                              return v < range.first;
+                           });
 }
 
+static bool ranges_contains(const Ranges &ranges, SeqNum value) {
+   auto itr = ranges_first_ending_after(ranges, value);
+   return itr != ranges.cend() && range_contains(*itr, value);
+}
+
+/* Returns the ranges that overlap or are adjacent to value as [first, second),
+ * or first == end() if there are none, in which case value belongs before
+ * second. */
 static std::pair<Ranges::iterator, Ranges::iterator>
 ranges_mergable(Ranges &ranges, const SeqRange &value) {
    assert(still_sorted_(ranges));
    std::pair<Ranges::iterator, Ranges::iterator> mergable;
 
-   mergable.first = ranges.end();
+   // the first range that ends at or after value starts
+   auto first = std::lower_bound(ranges.begin(), ranges.end(), value.first,
+                                 [](const SeqRange &range, SeqNum v) {
+                                    return range.second < v;
+                                 });
+   // the first range that starts after value ends
+   mergable.second = ranges_first_starting_after(ranges, value.second);
+   mergable.first = (first < mergable.second) ? first : ranges.end();
 
-   auto itr = ranges.begin();
-   for (; itr != ranges.end() && value.second >= itr->first; ++itr) {
-      if (mergable.first == ranges.cend()
-          && (range_overlap(*itr, value) || range_adj(*itr, value)))
-      {
-         mergable.first = itr;
-      }
-   }
-
-   mergable.second = itr;
-
-   assert(still_sorted_(ranges));
+   assert(mergable.first == ranges.end()
+          || range_overlap(*mergable.first, value)
+          || range_adj(*mergable.first, value));
 
    return mergable;
 }
@@ -84,17 +98,15 @@ static void range_merge(SeqRange *x, const SeqRange &y) {
 
 static void ranges_insert(Ranges *ranges, const SeqRange &value) {
    assert(still_sorted_(*ranges));
-   auto original = *ranges;
    auto mergable = ranges_mergable(*ranges, value);
 
    if (mergable.first == ranges->end()) {
       ranges->insert(mergable.second, value);
    } else {
+      // only the last mergable range can end after value does
       auto itr = mergable.first;
       range_merge(&(*itr), value);
-      for (auto jtr = itr + 1; jtr != mergable.second; ++jtr) {
-         range_merge(&(*itr), *jtr);
-      }
+      range_merge(&(*itr), *(mergable.second - 1));
       ranges->erase(mergable.first + 1, mergable.second);
    }
 
@@ -315,11 +327,6 @@ void RetransmitTally::compute_lost() {
 
 void RetransmitTally::tidy_ranges(Ranges *ranges) {
    assert(still_sorted_(*ranges));
-   auto original = *ranges;
-
-   auto pred = [=] (const SeqRange range) -> bool {
-      return last_ack_ >= range.second;
-   };
 
    if (ranges->size() > 0 && last_ack_ >= ranges->front().first
        && last_ack_ < ranges->front().second - 1)
@@ -327,8 +334,9 @@ void RetransmitTally::tidy_ranges(Ranges *ranges) {
       ranges->front().first = last_ack_;
    }
    else if (ranges->size() > 0 && last_ack_ >= ranges->front().second - 1) {
-      auto new_end = std::remove_if(ranges->begin(), ranges->end(), pred);
-      ranges->erase(new_end, ranges->end());
+      // the acked ranges are a prefix, drop them all at once
+      ranges->erase(ranges->cbegin(),
+                    ranges_first_ending_after(*ranges, last_ack_));
    }
 
    assert(still_sorted_(*ranges));
@@ -13,10 +13,10 @@
 
 #include "main/core/support/definitions.h"
 #include "main/core/support/object_counter.h"
-#include "main/core/work/task.h"
 #include "main/core/worker.h"
 #include "main/host/descriptor/descriptor.h"
 #include "main/host/host.h"
+#include "main/host/timer_wheel.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
@@ -30,12 +30,10 @@ struct _Timer {
     /* number of expires that happened since the timer was last set */
     guint64 expireCountSinceLastSet;
 
-    /* expire ids are used internally to cancel events that fire after
-     * they have become invalid because the user reset the timer */
-    guint nextExpireID;
-    guint minValidExpireID;
+    /* our slot in the host timer wheel; cancelling it when the user resets
+     * the timer removes the pending expiration instead of leaving it queued */
+    TimerWheelEntry* expireEntry;
 
-    guint numEventsScheduled;
     gboolean isClosed;
 
     MAGIC_DECLARE;
@@ -44,12 +42,18 @@ struct _Timer {
 static void _timer_close(Timer* timer) {
     MAGIC_ASSERT(timer);
     timer->isClosed = TRUE;
+    if(timer->expireEntry) {
+        timerwheel_cancel(timer->expireEntry);
+    }
     descriptor_adjustStatus(&(timer->super), DS_ACTIVE, FALSE);
     host_closeDescriptor(worker_getActiveHost(), timer->super.handle);
 }
 
 static void _timer_free(Timer* timer) {
     MAGIC_ASSERT(timer);
+    if(timer->expireEntry) {
+        timerwheel_freeEntry(timer->expireEntry);
+    }
     MAGIC_CLEAR(timer);
     g_free(timer);
     worker_countObject(OBJECT_TYPE_TIMER, COUNTER_TYPE_FREE);
@@ -141,7 +145,9 @@ static void _timer_disarm(Timer* timer) {
     MAGIC_ASSERT(timer);
     timer->nextExpireTime = 0;
     timer->expireInterval = 0;
-    timer->minValidExpireID = timer->nextExpireID;
+    if(timer->expireEntry) {
+        timerwheel_cancel(timer->expireEntry);
+    }
     debug("timer fd %i disarmed", timer->super.handle);
 }
 
@@ -201,39 +207,27 @@ static void _timer_expire(Timer* timer, gpointer data);
 static void _timer_scheduleNewExpireEvent(Timer* timer) {
     MAGIC_ASSERT(timer);
 
-    /* callback to our own node */
-    gpointer next = GUINT_TO_POINTER(timer->nextExpireID);
-
-    /* ref the timer storage in the callback event */
-    descriptor_ref(timer);
-    Task* task = task_new((TaskCallbackFunc)_timer_expire,
-            timer, next, descriptor_unref, NULL);
-
-    SimulationTime delay = timer->nextExpireTime - worker_getCurrentTime();
-
-    /* if the user set a super long delay, let's call back sooner to check if they closed
-     * or disarmed the timer in the meantime. This prevents queueing the task indefinitely. */
-    delay = MIN(delay, SIMTIME_ONE_SECOND);
-
-    worker_scheduleTask(task, delay);
-    task_unref(task);
+    if(!timer->expireEntry) {
+        /* the wheel refs the timer storage while the expiration is armed */
+        TimerWheel* wheel = host_getTimerWheel(worker_getActiveHost());
+        timer->expireEntry = timerwheel_newEntry(wheel,
+                (TimerWheelCallbackFunc)_timer_expire, timer, NULL,
+                descriptor_ref, descriptor_unref);
+    }
 
-    timer->nextExpireID++;
-    timer->numEventsScheduled++;
+    timerwheel_arm(timer->expireEntry, timer->nextExpireTime);
 }
 
 static void _timer_expire(Timer* timer, gpointer data) {
     MAGIC_ASSERT(timer);
 
-    /* this is a task callback event */
-
-    guint expireID = GPOINTER_TO_UINT(data);
-    debug("timer fd %i expired; isClosed=%i expireID=%u minValidExpireID=%u", timer->super.handle, timer->isClosed, expireID, timer->minValidExpireID);
+    /* this is a timer wheel callback */
 
-    timer->numEventsScheduled--;
+    debug("timer fd %i expired; isClosed=%i", timer->super.handle, timer->isClosed);
 
-    /* make sure the timer has not been reset since we scheduled this expiration event */
-    if(!timer->isClosed && expireID >= timer->minValidExpireID) {
+    /* resetting or closing the timer cancels the wheel entry, so we only
+     * get here for the expiration that is currently set */
+    if(!timer->isClosed) {
         /* check if it actually expired on this callback check */
         if(timer->nextExpireTime <= worker_getCurrentTime()) {
             /* if a one-time (non-periodic) timer already expired before they
@@ -257,7 +251,7 @@ static void _timer_expire(Timer* timer, gpointer data) {
                 _timer_disarm(timer);
             }
         } else {
-            /* it didn't expire yet, check again in another second */
+            /* it didn't expire yet, check again when it should */
             _timer_scheduleNewExpireEvent(timer);
         }
     }
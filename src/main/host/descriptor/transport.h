@@ -15,6 +15,17 @@
 
 typedef struct _Transport Transport;
 typedef struct _TransportFunctionTable TransportFunctionTable;
+typedef struct _TransportMessage TransportMessage;
+
+/* one message of a batched send or receive (sendmmsg/recvmmsg) */
+struct _TransportMessage {
+    gpointer buffer;
+    gsize nBytes;
+    in_addr_t ip;
+    in_port_t port;
+    /* filled in with the number of bytes actually transferred */
+    gsize bytesCopied;
+};
 
 typedef gssize (*TransportSendFunc)(Transport* transport, gconstpointer buffer, gsize nBytes, in_addr_t ip, in_port_t port);
 typedef gssize (*TransportReceiveFunc)(Transport* transport, gpointer buffer, gsize nBytes, in_addr_t* ip, in_port_t* port);
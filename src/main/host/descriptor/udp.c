@@ -17,6 +17,7 @@
 #include "main/host/descriptor/socket.h"
 #include "main/host/descriptor/transport.h"
 #include "main/host/host.h"
+#include "main/host/network_interface.h"
 #include "main/host/protocol.h"
 #include "main/host/tracker.h"
 #include "main/routing/packet.h"
@@ -53,11 +54,11 @@ gint udp_connectToPeer(UDP* udp, in_addr_t ip, in_port_t port, sa_family_t famil
 void udp_processPacket(UDP* udp, Packet* packet) {
     MAGIC_ASSERT(udp);
 
-    /* UDP packet contains data for user and can be buffered immediately */
-    if(packet_getPayloadLength(packet) > 0) {
-        if(!socket_addToInputBuffer((Socket*)udp, packet)) {
-            packet_addDeliveryStatus(packet, PDS_RCV_SOCKET_DROPPED);
-        }
+    /* UDP packet contains data for user and can be buffered immediately.
+     * empty datagrams are valid too, and are read as zero bytes. */
+    if(packetqueue_getLength(&(udp->super.inputBuffer)) >= CONFIG_UDP_MAX_QUEUED_DATAGRAMS ||
+            !socket_addToInputBuffer((Socket*)udp, packet)) {
+        packet_addDeliveryStatus(packet, PDS_RCV_SOCKET_DROPPED);
     }
 }
 
@@ -67,6 +68,21 @@ void udp_dropPacket(UDP* udp, Packet* packet) {
     /* do nothing */
 }
 
+/* datagrams to one of our own addresses are delivered right away instead of
+ * waiting in our output buffer for the interface. returns FALSE if the packet
+ * must go out through the output buffer instead; otherwise the packet ref we
+ * held was consumed. */
+static gboolean _udp_sendLocally(UDP* udp, Host* host, Packet* packet) {
+    NetworkInterface* interface = host_lookupInterface(host, packet_getDestinationIP(packet));
+    if(!interface) {
+        return FALSE;
+    }
+
+    networkinterface_sendLocalDatagram(interface, &(udp->super), packet);
+    packet_unref(packet);
+    return TRUE;
+}
+
 /*
  * this function builds a UDP packet and sends to the virtual node given by the
  * ip and port parameters. this function assumes that the socket is already
@@ -86,8 +102,8 @@ gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t
     gsize remaining = nBytes;
     gsize offset = 0;
 
-    /* create as many packets as needed */
-    while(remaining > 0) {
+    /* create as many packets as needed, and one even for an empty datagram */
+    do {
         gsize copyLength = MIN(maxPacketLength, remaining);
 
         /* use default destination if none was specified */
@@ -113,10 +129,16 @@ gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t
         Host* host = worker_getActiveHost();
         Packet* packet = packet_new(buffer + offset, copyLength, (guint)host_getID(host), host_getNewPacketID(host));
         packet_setUDP(packet, PUDP_NONE, sourceIP, sourcePort, destinationIP, destinationPort);
+        if(copyLength == 0) {
+            /* keep it in order with our other datagrams instead of sending it
+             * ahead of them like a control packet */
+            packet_setPriority(packet, host_getNextPacketPriority(host));
+        }
         packet_addDeliveryStatus(packet, PDS_SND_CREATED);
 
         /* buffer it in the transport layer, to be sent out when possible */
-        gboolean success = socket_addToOutputBuffer((Socket*) udp, packet);
+        gboolean success = _udp_sendLocally(udp, host, packet) ||
+                socket_addToOutputBuffer((Socket*) udp, packet);
 
         /* counter maintenance */
         if(success) {
@@ -126,7 +148,7 @@ gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t
             warning("unable to send UDP packet");
             break;
         }
-    }
+    } while(remaining > 0);
 
     /* update the tracker output buffer stats */
     Tracker* tracker = host_getTracker(worker_getActiveHost());
@@ -141,6 +163,106 @@ gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t
     return (gssize) offset;
 }
 
+guint udp_sendUserDatagrams(UDP* udp, TransportMessage* messages, guint numMessages) {
+    MAGIC_ASSERT(udp);
+    utility_assert(messages || numMessages == 0);
+
+    Host* host = worker_getActiveHost();
+
+    in_addr_t boundIP = 0;
+    in_port_t boundPort = 0;
+    socket_getSocketName(&(udp->super), &boundIP, &boundPort);
+
+    gsize space = socket_getOutputBufferSpace(&(udp->super));
+    Packet** packets = g_new(Packet*, MAX(numMessages, 1));
+    guint numPackets = 0;
+    guint numSent = 0;
+
+    /* build every datagram that fits first, so the whole batch is buffered in
+     * one pass. datagrams are never split here; anything larger than a single
+     * packet ends the batch and is left for the regular send path. */
+    for(numSent = 0; numSent < numMessages; numSent++) {
+        TransportMessage* message = &messages[numSent];
+
+        if(message->nBytes > CONFIG_DATAGRAM_MAX_SIZE || message->nBytes > space) {
+            break;
+        }
+
+        message->bytesCopied = 0;
+
+        /* use default destination if none was specified */
+        in_addr_t destinationIP = (message->ip != 0) ? message->ip : udp->super.peerIP;
+        in_port_t destinationPort = (message->port != 0) ? message->port : udp->super.peerPort;
+
+        in_addr_t sourceIP = boundIP;
+        if(sourceIP == htonl(INADDR_ANY)) {
+            /* source interface depends on destination */
+            sourceIP = (destinationIP == htonl(INADDR_LOOPBACK)) ?
+                    htonl(INADDR_LOOPBACK) : host_getDefaultIP(host);
+        }
+
+        utility_assert(sourceIP && boundPort && destinationIP && destinationPort);
+
+        Packet* packet = packet_new(message->buffer, message->nBytes, (guint)host_getID(host), host_getNewPacketID(host));
+        packet_setUDP(packet, PUDP_NONE, sourceIP, boundPort, destinationIP, destinationPort);
+        if(message->nBytes == 0) {
+            /* empty datagrams are sent too, in order with the others */
+            packet_setPriority(packet, host_getNextPacketPriority(host));
+        }
+        packet_addDeliveryStatus(packet, PDS_SND_CREATED);
+
+        message->bytesCopied = message->nBytes;
+        if(_udp_sendLocally(udp, host, packet)) {
+            continue;
+        }
+
+        packets[numPackets++] = packet;
+        space -= message->nBytes;
+    }
+
+    /* we checked the space above, so all of them fit */
+    guint numBuffered = socket_addBatchToOutputBuffer(&(udp->super), packets, numPackets);
+    utility_assert(numBuffered == numPackets);
+
+    g_free(packets);
+
+    debug("buffered %u outbound UDP datagrams from user", numSent);
+
+    return numSent;
+}
+
+guint udp_receiveUserDatagrams(UDP* udp, TransportMessage* messages, guint numMessages) {
+    MAGIC_ASSERT(udp);
+    utility_assert(messages || numMessages == 0);
+
+    guint numReceived = 0;
+
+    for(numReceived = 0; numReceived < numMessages; numReceived++) {
+        TransportMessage* message = &messages[numReceived];
+
+        Packet* packet = socket_removeFromInputBuffer((Socket*)udp);
+        if(!packet) {
+            break;
+        }
+
+        /* copy lesser of requested and available amount to application buffer */
+        guint packetLength = packet_getPayloadLength(packet);
+        gsize copyLength = MIN(message->nBytes, packetLength);
+        message->bytesCopied = packet_copyPayload(packet, 0, message->buffer, copyLength);
+        utility_assert(message->bytesCopied == copyLength);
+
+        message->ip = packet_getSourceIP(packet);
+        message->port = packet_getSourcePort(packet);
+
+        packet_addDeliveryStatus(packet, PDS_RCV_SOCKET_DELIVERED);
+        packet_unref(packet);
+    }
+
+    debug("user read %u inbound UDP datagrams", numReceived);
+
+    return numReceived;
+}
+
 gssize udp_receiveUserData(UDP* udp, gpointer buffer, gsize nBytes, in_addr_t* ip, in_port_t* port) {
     MAGIC_ASSERT(udp);
 
@@ -9,8 +9,16 @@
 
 #include <glib.h>
 
+#include "main/host/descriptor/transport.h"
+
 typedef struct _UDP UDP;
 
 UDP* udp_new(gint handle, guint receiveBufferSize, guint sendBufferSize);
 
+/* batched versions of the transport send and receive functions; both return
+ * the number of messages that were handled, stopping at the first one that
+ * could not be */
+guint udp_sendUserDatagrams(UDP* udp, TransportMessage* messages, guint numMessages);
+guint udp_receiveUserDatagrams(UDP* udp, TransportMessage* messages, guint numMessages);
+
 #endif /* SHD_UDP_H_ */
@@ -0,0 +1,344 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/host/file_write_buffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "main/core/support/definitions.h"
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+typedef enum _FileWriteMode FileWriteMode;
+enum _FileWriteMode {
+    FWM_UNKNOWN, FWM_BUFFERED, FWM_DIRECT,
+};
+
+/* several OS handles may refer to the same file, so files are told apart by
+ * their device and inode */
+typedef struct _FileWriteFileID FileWriteFileID;
+struct _FileWriteFileID {
+    dev_t device;
+    ino_t inode;
+};
+
+/* what we learned about an OS handle the first time it was written to */
+typedef struct _FileWriteHandle FileWriteHandle;
+struct _FileWriteHandle {
+    FileWriteMode mode;
+    FileWriteFileID file;
+};
+
+/* a run of consecutive bytes in the batch data that go to the same file */
+typedef struct _FileWriteSegment FileWriteSegment;
+struct _FileWriteSegment {
+    gint osHandle;
+    gsize length;
+};
+
+typedef struct _FileWriteBatch FileWriteBatch;
+struct _FileWriteBatch {
+    FileWriteBuffer* owner;
+    GByteArray* data;
+    GArray* segments;
+};
+
+struct _FileWriteBuffer {
+    /* we hand the batch to the I/O threads once it holds this many bytes */
+    gsize capacity;
+
+    /* the batch currently being filled by the host, or NULL */
+    FileWriteBatch* batch;
+
+    /* the FileWriteHandle of each OS handle we checked */
+    GHashTable* handles;
+    /* the FileWriteFileIDs of the files written to since the last flush */
+    GHashTable* dirtyFiles;
+
+    /* protects the fields below, which are also updated by the I/O threads */
+    GMutex lock;
+    GCond writeDone;
+    /* only one batch is written at a time, so the writes reach the OS in the
+     * same order the plugins made them */
+    gboolean isWriting;
+    /* the first error from a background write, reported by the host */
+    gint writeError;
+    gint writeErrorHandle;
+
+    MAGIC_DECLARE;
+};
+
+static guint _filewritefileid_hash(const FileWriteFileID* id) {
+    guint64 inode = (guint64)id->inode;
+    return (guint)(inode ^ (inode >> 32) ^ (guint64)id->device);
+}
+
+static gboolean _filewritefileid_equal(const FileWriteFileID* a, const FileWriteFileID* b) {
+    return a->device == b->device && a->inode == b->inode;
+}
+
+static void _filewritefileid_fromStat(FileWriteFileID* id, const struct stat* fileStat) {
+    id->device = fileStat->st_dev;
+    id->inode = fileStat->st_ino;
+}
+
+static FileWriteBatch* _filewritebatch_new(FileWriteBuffer* owner) {
+    FileWriteBatch* batch = g_new0(FileWriteBatch, 1);
+    batch->owner = owner;
+    batch->data = g_byte_array_sized_new((guint)owner->capacity);
+    batch->segments = g_array_new(FALSE, FALSE, sizeof(FileWriteSegment));
+    return batch;
+}
+
+static void _filewritebatch_free(FileWriteBatch* batch) {
+    g_byte_array_free(batch->data, TRUE);
+    g_array_free(batch->segments, TRUE);
+    g_free(batch);
+}
+
+/* runs in an I/O thread, so it must not log or touch any host state */
+static void _filewritebuffer_writeBatch(FileWriteBatch* batch, gpointer userData) {
+    FileWriteBuffer* buffer = batch->owner;
+    gint error = 0;
+    gint errorHandle = -1;
+    gsize offset = 0;
+
+    for(guint i = 0; i < batch->segments->len; i++) {
+        FileWriteSegment* segment = &g_array_index(batch->segments, FileWriteSegment, i);
+        gsize written = 0;
+
+        while(written < segment->length) {
+            ssize_t n = write(segment->osHandle, batch->data->data + offset + written,
+                    segment->length - written);
+            if(n < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                if(!error) {
+                    error = errno;
+                    errorHandle = segment->osHandle;
+                }
+                break;
+            }
+            written += (gsize)n;
+        }
+
+        offset += segment->length;
+    }
+
+    _filewritebatch_free(batch);
+
+    g_mutex_lock(&buffer->lock);
+    if(error && !buffer->writeError) {
+        buffer->writeError = error;
+        buffer->writeErrorHandle = errorHandle;
+    }
+    buffer->isWriting = FALSE;
+    g_cond_broadcast(&buffer->writeDone);
+    g_mutex_unlock(&buffer->lock);
+}
+
+static GThreadPool* _filewritebuffer_getThreadPool() {
+    static gsize isInitialized = 0;
+    static GThreadPool* pool = NULL;
+
+    if(g_once_init_enter(&isInitialized)) {
+        pool = g_thread_pool_new((GFunc)_filewritebuffer_writeBatch, NULL,
+                CONFIG_FILE_WRITE_THREADS, FALSE, NULL);
+        utility_assert(pool);
+        g_once_init_leave(&isInitialized, 1);
+    }
+
+    return pool;
+}
+
+/* must be called with the lock held */
+static void _filewritebuffer_waitForWrite(FileWriteBuffer* buffer) {
+    while(buffer->isWriting) {
+        g_cond_wait(&buffer->writeDone, &buffer->lock);
+    }
+
+    if(buffer->writeError) {
+        /* the plugin was already told that the write succeeded */
+        warning("buffered write to file descriptor %i failed: %s",
+                buffer->writeErrorHandle, g_strerror(buffer->writeError));
+        buffer->writeError = 0;
+        buffer->writeErrorHandle = -1;
+    }
+}
+
+static void _filewritebuffer_submit(FileWriteBuffer* buffer) {
+    if(!buffer->batch) {
+        return;
+    }
+
+    g_mutex_lock(&buffer->lock);
+    _filewritebuffer_waitForWrite(buffer);
+    buffer->isWriting = TRUE;
+    g_mutex_unlock(&buffer->lock);
+
+    g_thread_pool_push(_filewritebuffer_getThreadPool(), buffer->batch, NULL);
+    buffer->batch = NULL;
+}
+
+FileWriteBuffer* filewritebuffer_new(gsize capacity) {
+    FileWriteBuffer* buffer = g_new0(FileWriteBuffer, 1);
+    MAGIC_INIT(buffer);
+
+    buffer->capacity = MAX(capacity, 1);
+    buffer->handles = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    buffer->dirtyFiles = g_hash_table_new_full((GHashFunc)_filewritefileid_hash,
+            (GEqualFunc)_filewritefileid_equal, g_free, NULL);
+    buffer->writeErrorHandle = -1;
+
+    g_mutex_init(&buffer->lock);
+    g_cond_init(&buffer->writeDone);
+
+    return buffer;
+}
+
+void filewritebuffer_free(FileWriteBuffer* buffer) {
+    MAGIC_ASSERT(buffer);
+
+    filewritebuffer_flush(buffer);
+
+    g_hash_table_destroy(buffer->handles);
+    g_hash_table_destroy(buffer->dirtyFiles);
+    g_mutex_clear(&buffer->lock);
+    g_cond_clear(&buffer->writeDone);
+
+    MAGIC_CLEAR(buffer);
+    g_free(buffer);
+}
+
+gboolean filewritebuffer_isBufferable(FileWriteBuffer* buffer, gint osHandle) {
+    MAGIC_ASSERT(buffer);
+
+    FileWriteHandle* handle = g_hash_table_lookup(buffer->handles, GINT_TO_POINTER(osHandle));
+
+    if(!handle) {
+        handle = g_new0(FileWriteHandle, 1);
+
+        /* only regular files that did not ask for synchronous writes; pipes,
+         * terminals, and devices may be watched by someone else */
+        struct stat fileStat;
+        gint flags = fcntl(osHandle, F_GETFL);
+        if(fstat(osHandle, &fileStat) == 0 && S_ISREG(fileStat.st_mode) &&
+                flags != -1 && !(flags & (O_SYNC|O_DSYNC|O_DIRECT))) {
+            handle->mode = FWM_BUFFERED;
+            _filewritefileid_fromStat(&handle->file, &fileStat);
+        } else {
+            handle->mode = FWM_DIRECT;
+        }
+        g_hash_table_insert(buffer->handles, GINT_TO_POINTER(osHandle), handle);
+    }
+
+    return handle->mode == FWM_BUFFERED ? TRUE : FALSE;
+}
+
+void filewritebuffer_removeHandle(FileWriteBuffer* buffer, gint osHandle) {
+    MAGIC_ASSERT(buffer);
+    g_hash_table_remove(buffer->handles, GINT_TO_POINTER(osHandle));
+}
+
+void filewritebuffer_write(FileWriteBuffer* buffer, gint osHandle, gconstpointer data, gsize nBytes) {
+    MAGIC_ASSERT(buffer);
+
+    if(nBytes == 0) {
+        return;
+    }
+
+    if(!buffer->batch) {
+        buffer->batch = _filewritebatch_new(buffer);
+    }
+
+    FileWriteHandle* handle = g_hash_table_lookup(buffer->handles, GINT_TO_POINTER(osHandle));
+    utility_assert(handle && handle->mode == FWM_BUFFERED);
+    if(!g_hash_table_contains(buffer->dirtyFiles, &handle->file)) {
+        g_hash_table_add(buffer->dirtyFiles, g_memdup(&handle->file, sizeof(FileWriteFileID)));
+    }
+
+    FileWriteBatch* batch = buffer->batch;
+    g_byte_array_append(batch->data, data, (guint)nBytes);
+
+    /* back to back writes to the same file are written out together */
+    FileWriteSegment* last = batch->segments->len > 0 ?
+            &g_array_index(batch->segments, FileWriteSegment, batch->segments->len - 1) : NULL;
+    if(last && last->osHandle == osHandle) {
+        last->length += nBytes;
+    } else {
+        FileWriteSegment segment = {.osHandle = osHandle, .length = nBytes};
+        g_array_append_val(batch->segments, segment);
+    }
+
+    if(batch->data->len >= buffer->capacity) {
+        _filewritebuffer_submit(buffer);
+    }
+}
+
+void filewritebuffer_flush(FileWriteBuffer* buffer) {
+    MAGIC_ASSERT(buffer);
+
+    _filewritebuffer_submit(buffer);
+
+    g_mutex_lock(&buffer->lock);
+    _filewritebuffer_waitForWrite(buffer);
+    g_mutex_unlock(&buffer->lock);
+
+    g_hash_table_remove_all(buffer->dirtyFiles);
+}
+
+void filewritebuffer_flushHandle(FileWriteBuffer* buffer, gint osHandle) {
+    MAGIC_ASSERT(buffer);
+
+    if(g_hash_table_size(buffer->dirtyFiles) == 0) {
+        return;
+    }
+
+    /* the handle may be another one to a file we wrote to, so we look at the
+     * file itself. everything goes out in order anyway, so we flush all of it,
+     * and also if we can not tell which file it is. */
+    FileWriteFileID id;
+    FileWriteHandle* handle = g_hash_table_lookup(buffer->handles, GINT_TO_POINTER(osHandle));
+    struct stat fileStat;
+
+    if(handle && handle->mode == FWM_BUFFERED) {
+        id = handle->file;
+    } else if(fstat(osHandle, &fileStat) == 0) {
+        _filewritefileid_fromStat(&id, &fileStat);
+    } else {
+        filewritebuffer_flush(buffer);
+        return;
+    }
+
+    if(g_hash_table_contains(buffer->dirtyFiles, &id)) {
+        filewritebuffer_flush(buffer);
+    }
+}
+
+void filewritebuffer_flushPath(FileWriteBuffer* buffer, const gchar* path, gboolean followLinks) {
+    MAGIC_ASSERT(buffer);
+
+    if(g_hash_table_size(buffer->dirtyFiles) == 0) {
+        return;
+    }
+
+    /* if the path does not exist, it can not be one of our files */
+    struct stat fileStat;
+    gint result = followLinks ? stat(path, &fileStat) : lstat(path, &fileStat);
+    if(result != 0) {
+        return;
+    }
+
+    FileWriteFileID id;
+    _filewritefileid_fromStat(&id, &fileStat);
+    if(g_hash_table_contains(buffer->dirtyFiles, &id)) {
+        filewritebuffer_flush(buffer);
+    }
+}
@@ -0,0 +1,36 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_FILE_WRITE_BUFFER_H_
+#define SHD_FILE_WRITE_BUFFER_H_
+
+#include <glib.h>
+
+/* A per-host write-behind buffer for plugin writes to regular files. Writes
+ * are copied into memory and handed in order to a shared pool of I/O threads
+ * once enough data accumulated, so the worker does not wait on the disk.
+ * Any other access to a buffered file must be preceded by a flush, which
+ * waits until everything written so far reached the OS. */
+typedef struct _FileWriteBuffer FileWriteBuffer;
+
+FileWriteBuffer* filewritebuffer_new(gsize capacity);
+/* flushes everything that is still buffered */
+void filewritebuffer_free(FileWriteBuffer* buffer);
+
+/* returns TRUE if writes to the given OS handle may be buffered */
+gboolean filewritebuffer_isBufferable(FileWriteBuffer* buffer, gint osHandle);
+/* must be called when the OS handle is closed, since the number may be reused,
+ * and when its flags change, since they decide whether it may be buffered */
+void filewritebuffer_removeHandle(FileWriteBuffer* buffer, gint osHandle);
+
+void filewritebuffer_write(FileWriteBuffer* buffer, gint osHandle, gconstpointer data, gsize nBytes);
+void filewritebuffer_flush(FileWriteBuffer* buffer);
+/* flushes only if writes to the file behind the given OS handle were buffered
+ * since the last flush, through this or any other handle */
+void filewritebuffer_flushHandle(FileWriteBuffer* buffer, gint osHandle);
+/* as above, for the file at the given path */
+void filewritebuffer_flushPath(FileWriteBuffer* buffer, const gchar* path, gboolean followLinks);
+
+#endif /* SHD_FILE_WRITE_BUFFER_H_ */
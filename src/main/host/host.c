@@ -16,6 +16,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/un.h>
+#include <unistd.h>
 
 #include "main/core/support/definitions.h"
 #include "main/core/support/object_counter.h"
@@ -33,6 +34,7 @@
 #include "main/host/network_interface.h"
 #include "main/host/process.h"
 #include "main/host/protocol.h"
+#include "main/host/timer_wheel.h"
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
@@ -60,10 +62,16 @@ struct _Host {
 
     /* the virtual processes this host is running */
     GQueue* processes;
+    /* for each interned plugin key, a queue of namespace handles left behind
+     * by exited processes that a new process of the same plugin may reset */
+    GHashTable* pluginNamespacePool;
 
     /* a statistics tracker for in/out bytes, CPU, memory, etc. */
     Tracker* tracker;
 
+    /* owns the host-local timers so only the earliest one sits in the event queue */
+    TimerWheel* timerWheel;
+
     /* virtual descriptor numbers */
     GQueue* availableDescriptors;
     gint descriptorHandleCounter;
@@ -76,6 +84,10 @@ struct _Host {
     /* all file, socket, and epoll descriptors we know about and track */
     GHashTable* descriptors;
 
+    /* descriptors whose status changed during the current event. their epoll
+     * listeners are notified once when the event is done executing. */
+    GQueue* statusChangedDescriptors;
+
     /* map from the descriptor handle we returned to the plug-in, and
      * descriptor handle that the OS gave us for files, etc.
      * We do this so that we can give out low descriptor numbers even though the OS
@@ -83,6 +95,9 @@ struct _Host {
     GHashTable* shadowToOSHandleMap;
     GHashTable* osToShadowHandleMap;
 
+    /* write-behind buffer for plugin writes to regular files, if enabled */
+    FileWriteBuffer* fileWriteBuffer;
+
     /* list of all /dev/random shadow handles that have been created */
     GHashTable* randomShadowHandleMap;
 
@@ -92,6 +107,9 @@ struct _Host {
     /* track the order in which the application sent us application data */
     gdouble packetPriorityCounter;
 
+    /* the smallest delay of any packet we may send to another host */
+    SimulationTime lookahead;
+
     /* random stream */
     Random* random;
 
@@ -118,14 +136,15 @@ Host* host_new(HostParameters* params) {
     /* first copy the entire struct of params */
     host->params = *params;
 
-    /* now dup the strings so we own them */
+    /* now dup the name so we own it. the other strings are the same for every
+     * instance of a configured host, so they are interned and shared instead. */
     if(params->hostname) host->params.hostname = g_strdup(params->hostname);
-    if(params->ipHint) host->params.ipHint = g_strdup(params->ipHint);
-    if(params->citycodeHint) host->params.citycodeHint = g_strdup(params->citycodeHint);
-    if(params->countrycodeHint) host->params.countrycodeHint = g_strdup(params->countrycodeHint);
-    if(params->geocodeHint) host->params.geocodeHint = g_strdup(params->geocodeHint);
-    if(params->typeHint) host->params.typeHint = g_strdup(params->typeHint);
-    if(params->pcapDir) host->params.pcapDir = g_strdup(params->pcapDir);
+    if(params->ipHint) host->params.ipHint = g_intern_string(params->ipHint);
+    if(params->citycodeHint) host->params.citycodeHint = g_intern_string(params->citycodeHint);
+    if(params->countrycodeHint) host->params.countrycodeHint = g_intern_string(params->countrycodeHint);
+    if(params->geocodeHint) host->params.geocodeHint = g_intern_string(params->geocodeHint);
+    if(params->typeHint) host->params.typeHint = g_intern_string(params->typeHint);
+    if(params->pcapDir) host->params.pcapDir = g_intern_string(params->pcapDir);
 
     /* thread-level event communication with other nodes */
     g_mutex_init(&(host->lock));
@@ -137,13 +156,22 @@ Host* host_new(HostParameters* params) {
 
     /* virtual descriptor management */
     host->descriptors = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, descriptor_unref);
+    host->statusChangedDescriptors = g_queue_new();
     host->shadowToOSHandleMap = g_hash_table_new(g_direct_hash, g_direct_equal);
     host->osToShadowHandleMap = g_hash_table_new(g_direct_hash, g_direct_equal);
     host->randomShadowHandleMap = g_hash_table_new(g_direct_hash, g_direct_equal);
     host->unixPathToPortMap = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
+    host->timerWheel = timerwheel_new();
+
+    if(host->params.fileWriteBufferSize > 0) {
+        host->fileWriteBuffer = filewritebuffer_new(host->params.fileWriteBufferSize);
+    }
+
     /* applications this node will run */
     host->processes = g_queue_new();
+    host->pluginNamespacePool = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify)g_queue_free);
 
     message("Created host id '%u' name '%s'", (guint)host->params.id, g_quark_to_string(host->params.id));
 
@@ -182,6 +210,10 @@ void host_setup(Host* host, DNS* dns, Topology* topology, guint rawCPUFreq, cons
             host->params.ipHint, host->params.citycodeHint, host->params.countrycodeHint, host->params.geocodeHint,
             host->params.typeHint, &bwDownKiBps, &bwUpKiBps);
 
+    /* packets are delivered after the path latency rounded up, so rounding down is safe */
+    gdouble minLatency = topology_getMinimumLatency(topology, ethernetAddress);
+    host->lookahead = (minLatency > 0) ? (SimulationTime) floor(minLatency * SIMTIME_ONE_MILLISECOND) : 0;
+
     /* prefer assigned bandwidth if available */
     if(host->params.requestedBWDownKiBps) {
         bwDownKiBps = host->params.requestedBWDownKiBps;
@@ -192,9 +224,11 @@ void host_setup(Host* host, DNS* dns, Topology* topology, guint rawCPUFreq, cons
 
     /* virtual addresses and interfaces for managing network I/O */
     NetworkInterface* loopback = networkinterface_new(loopbackAddress, G_MAXUINT32, G_MAXUINT32,
-            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize);
+            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize,
+            host->params.tcpSegmentationOffload);
     NetworkInterface* ethernet = networkinterface_new(ethernetAddress, bwDownKiBps, bwUpKiBps,
-            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize);
+            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize,
+            host->params.tcpSegmentationOffload);
 
     g_hash_table_replace(host->interfaces, GUINT_TO_POINTER((guint)address_toNetworkIP(ethernetAddress)), ethernet);
     g_hash_table_replace(host->interfaces, GUINT_TO_POINTER((guint)htonl(INADDR_LOOPBACK)), loopback);
@@ -271,6 +305,24 @@ void host_shutdown(Host* host) {
         g_hash_table_destroy(host->descriptors);
     }
 
+    /* nobody is left to be notified about these */
+    if(host->statusChangedDescriptors) {
+        GQueue* statusChangedDescriptors = host->statusChangedDescriptors;
+        host->statusChangedDescriptors = NULL;
+        g_queue_free_full(statusChangedDescriptors, descriptor_unref);
+    }
+
+    /* descriptors with armed timers are only released here */
+    if(host->timerWheel) {
+        timerwheel_free(host->timerWheel);
+    }
+
+    /* get everything the plugins wrote to disk before we forget their files */
+    if(host->fileWriteBuffer) {
+        filewritebuffer_free(host->fileWriteBuffer);
+        host->fileWriteBuffer = NULL;
+    }
+
     if(host->shadowToOSHandleMap) {
         g_hash_table_destroy(host->shadowToOSHandleMap);
     }
@@ -283,6 +335,11 @@ void host_shutdown(Host* host) {
     if(host->unixPathToPortMap) {
         g_hash_table_destroy(host->unixPathToPortMap);
     }
+    /* elf-loader can not unload namespaces, so the pooled ones are forgotten
+     * just like the ones of processes that are still running */
+    if(host->pluginNamespacePool) {
+        g_hash_table_destroy(host->pluginNamespacePool);
+    }
 
     if(host->cpu) {
         cpu_free(host->cpu);
@@ -298,13 +355,6 @@ void host_shutdown(Host* host) {
         random_free(host->random);
     }
 
-    if(host->params.ipHint) g_free(host->params.ipHint);
-    if(host->params.citycodeHint) g_free(host->params.citycodeHint);
-    if(host->params.countrycodeHint) g_free(host->params.countrycodeHint);
-    if(host->params.geocodeHint) g_free(host->params.geocodeHint);
-    if(host->params.typeHint) g_free(host->params.typeHint);
-    if(host->params.pcapDir) g_free(host->params.pcapDir);
-
     g_mutex_clear(&(host->lock));
 
     if(host->dataDirPath) {
@@ -413,6 +463,23 @@ void host_addApplication(Host* host, SimulationTime startTime, SimulationTime st
     g_queue_push_tail(host->processes, proc);
 }
 
+gpointer host_takePluginNamespace(Host* host, const gchar* pluginKey) {
+    MAGIC_ASSERT(host);
+    GQueue* handles = g_hash_table_lookup(host->pluginNamespacePool, pluginKey);
+    return handles ? g_queue_pop_head(handles) : NULL;
+}
+
+void host_poolPluginNamespace(Host* host, const gchar* pluginKey, gpointer handle) {
+    MAGIC_ASSERT(host);
+    utility_assert(handle);
+    GQueue* handles = g_hash_table_lookup(host->pluginNamespacePool, pluginKey);
+    if(!handles) {
+        handles = g_queue_new();
+        g_hash_table_insert(host->pluginNamespacePool, (gpointer)pluginKey, handles);
+    }
+    g_queue_push_tail(handles, handle);
+}
+
 void host_freeAllApplications(Host* host) {
     MAGIC_ASSERT(host);
     debug("start freeing applications for host '%s'", host->params.hostname);
@@ -464,6 +531,11 @@ gchar* host_getName(Host* host) {
     return host->params.hostname;
 }
 
+SimulationTime host_getLookahead(Host* host) {
+    MAGIC_ASSERT(host);
+    return host->lookahead;
+}
+
 Address* host_getDefaultAddress(Host* host) {
     MAGIC_ASSERT(host);
     return host->defaultAddress;
@@ -489,6 +561,31 @@ gboolean host_autotuneSendBuffer(Host* host) {
     return host->params.autotuneSendBuf;
 }
 
+void host_addStatusChangedDescriptor(Host* host, Descriptor* descriptor) {
+    MAGIC_ASSERT(host);
+
+    if(!host->statusChangedDescriptors) {
+        /* we are shutting down, don't hold on to anything */
+        descriptor_notifyStatusChanged(descriptor);
+        return;
+    }
+
+    descriptor_ref(descriptor);
+    g_queue_push_tail(host->statusChangedDescriptors, descriptor);
+}
+
+void host_flushStatusChangedDescriptors(Host* host) {
+    MAGIC_ASSERT(host);
+
+    /* notifying a listener may change the status of an epoll that is
+     * itself being watched, which queues it behind us */
+    while(!g_queue_is_empty(host->statusChangedDescriptors)) {
+        Descriptor* descriptor = g_queue_pop_head(host->statusChangedDescriptors);
+        descriptor_notifyStatusChanged(descriptor);
+        descriptor_unref(descriptor);
+    }
+}
+
 Descriptor* host_lookupDescriptor(Host* host, gint handle) {
     MAGIC_ASSERT(host);
     return g_hash_table_lookup(host->descriptors, (gconstpointer) &handle);
@@ -658,12 +755,67 @@ gint host_getOSHandle(Host* host, gint shadowHandle) {
         return shadowHandle;
     }
 
-    /* find os handle that we mapped, if one exists */
     gpointer osHandleP = g_hash_table_lookup(host->shadowToOSHandleMap, GINT_TO_POINTER(shadowHandle));
-
     return osHandleP ? GPOINTER_TO_INT(osHandleP) : -1;
 }
 
+void host_flushFileWrites(Host* host) {
+    MAGIC_ASSERT(host);
+    if(host->fileWriteBuffer) {
+        filewritebuffer_flush(host->fileWriteBuffer);
+    }
+}
+
+void host_flushFileWritesTo(Host* host, gint osHandle) {
+    MAGIC_ASSERT(host);
+    if(host->fileWriteBuffer && osHandle > 2) {
+        filewritebuffer_flushHandle(host->fileWriteBuffer, osHandle);
+    }
+}
+
+void host_flushFileWritesToPath(Host* host, const gchar* path, gboolean followLinks) {
+    MAGIC_ASSERT(host);
+    if(host->fileWriteBuffer && path) {
+        filewritebuffer_flushPath(host->fileWriteBuffer, path, followLinks);
+    }
+}
+
+void host_fileFlagsChanged(Host* host, gint osHandle) {
+    MAGIC_ASSERT(host);
+    if(host->fileWriteBuffer && osHandle > 2) {
+        filewritebuffer_flushHandle(host->fileWriteBuffer, osHandle);
+        filewritebuffer_removeHandle(host->fileWriteBuffer, osHandle);
+    }
+}
+
+gint host_writeFile(Host* host, gint shadowHandle, gconstpointer buffer, gsize nBytes, gsize* bytesWritten) {
+    MAGIC_ASSERT(host);
+    utility_assert(bytesWritten);
+
+    gint osHandle = host_getOSHandle(host, shadowHandle);
+    if(osHandle < 0) {
+        return EBADF;
+    }
+
+    if(host->fileWriteBuffer && osHandle > 2 &&
+            filewritebuffer_isBufferable(host->fileWriteBuffer, osHandle)) {
+        /* errors from the background write can only be logged */
+        filewritebuffer_write(host->fileWriteBuffer, osHandle, buffer, nBytes);
+        *bytesWritten = nBytes;
+        return 0;
+    }
+
+    /* another handle may still have buffered writes to the same file */
+    host_flushFileWritesTo(host, osHandle);
+    gssize n = write(osHandle, buffer, nBytes);
+    if(n < 0) {
+        return errno;
+    }
+
+    *bytesWritten = (gsize)n;
+    return 0;
+}
+
 void host_setRandomHandle(Host* host, gint handle) {
     MAGIC_ASSERT(host);
     g_hash_table_insert(host->randomShadowHandleMap, GINT_TO_POINTER(handle), GINT_TO_POINTER(handle));
@@ -687,6 +839,9 @@ void host_destroyShadowHandle(Host* host, gint shadowHandle) {
     gboolean didExist = g_hash_table_remove(host->shadowToOSHandleMap, GINT_TO_POINTER(shadowHandle));
     if(didExist) {
         g_hash_table_remove(host->osToShadowHandleMap, GINT_TO_POINTER(osHandle));
+        if(host->fileWriteBuffer) {
+            filewritebuffer_removeHandle(host->fileWriteBuffer, osHandle);
+        }
         _host_returnPreviousDescriptorHandle(host, shadowHandle);
     }
 
@@ -1463,11 +1618,8 @@ gint host_getSocketName(Host* host, gint handle, const struct sockaddr* address,
     }
 }
 
-gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nBytes,
-        in_addr_t ip, in_addr_t port, gsize* bytesCopied) {
-    MAGIC_ASSERT(host);
-    utility_assert(bytesCopied);
-
+static gint _host_prepareUserSend(Host* host, gint handle, gsize nBytes,
+        in_addr_t ip, in_port_t port, Transport** transportOut) {
     Descriptor* descriptor = host_lookupDescriptor(host, handle);
     if(descriptor == NULL) {
         warning("descriptor handle '%i' not found", handle);
@@ -1486,6 +1638,7 @@ gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nByt
     }
 
     Transport* transport = (Transport*) descriptor;
+    *transportOut = transport;
 
     /* we should block if our cpu has been too busy lately */
     if(cpu_isBlocked(host->cpu)) {
@@ -1539,26 +1692,111 @@ gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nByt
         }
     }
 
+    return 0;
+}
+
+static gint _host_getSendError(gssize result) {
+    if(result == -2) {
+        return ENOTCONN;
+    } else if(result == -3) {
+        return EPIPE;
+    } else {
+        return EWOULDBLOCK;
+    }
+}
+
+gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nBytes,
+        in_addr_t ip, in_addr_t port, gsize* bytesCopied) {
+    MAGIC_ASSERT(host);
+    utility_assert(bytesCopied);
+
+    Transport* transport = NULL;
+    gint error = _host_prepareUserSend(host, handle, nBytes, ip, port, &transport);
+    if(error != 0) {
+        return error;
+    }
+
     gssize n = transport_sendUserData(transport, buffer, nBytes, ip, port);
     if(n > 0) {
         /* user is writing some bytes. */
         *bytesCopied = (gsize)n;
-    } else if(n == -2) {
-        return ENOTCONN;
-    } else if(n == -3) {
-        return EPIPE;
     } else if(n < 0) {
-        return EWOULDBLOCK;
+        return _host_getSendError(n);
     }
 
     return 0;
 }
 
-gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes,
-        in_addr_t* ip, in_port_t* port, gsize* bytesCopied) {
+gint host_sendUserMessages(Host* host, gint handle, TransportMessage* messages,
+        guint numMessages, guint* numSent) {
     MAGIC_ASSERT(host);
-    utility_assert(ip && port && bytesCopied);
+    utility_assert(messages && numMessages > 0 && numSent);
+
+    *numSent = 0;
+
+    /* the checks, implicit bind, and connection state are handled once for
+     * the batch, using the first message */
+    Transport* transport = NULL;
+    gint error = _host_prepareUserSend(host, handle, messages[0].nBytes,
+            messages[0].ip, messages[0].port, &transport);
+    if(error != 0) {
+        return error;
+    }
+
+    DescriptorType dtype = descriptor_getType((Descriptor*)transport);
+
+    if(dtype == DT_TCPSOCKET) {
+        gssize n = tcp_sendUserMessages((TCP*)transport, messages, numMessages);
+        if(n < 0) {
+            return _host_getSendError(n);
+        }
+        *numSent = (guint)n;
+        return 0;
+    }
+
+    if(dtype == DT_UDPSOCKET) {
+        /* stop the batch before the first datagram that has nowhere to go */
+        Socket* socket = (Socket*)transport;
+        gboolean hasPeer = (socket->peerIP != 0 && socket->peerPort != 0);
+        guint numDeliverable = 1;
+        while(numDeliverable < numMessages && (hasPeer ||
+                (messages[numDeliverable].ip != 0 && messages[numDeliverable].port != 0))) {
+            numDeliverable++;
+        }
+
+        *numSent = udp_sendUserDatagrams((UDP*)transport, messages, numDeliverable);
+        if(*numSent > 0) {
+            return 0;
+        }
+
+        /* only send the first one below, the regular way */
+        numMessages = 1;
+    }
+
+    /* pipes, and datagrams the batch path could not take, go one at a time */
+    while(*numSent < numMessages) {
+        TransportMessage* message = &messages[*numSent];
+        gssize n = transport_sendUserData(transport, message->buffer, message->nBytes,
+                message->ip, message->port);
+        if(n < 0) {
+            if(*numSent == 0) {
+                return _host_getSendError(n);
+            }
+            break;
+        }
 
+        message->bytesCopied = (gsize)n;
+        (*numSent)++;
+
+        if(message->bytesCopied < message->nBytes) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static gint _host_prepareUserReceive(Host* host, gint handle, gsize nBytes, Transport** transportOut) {
     Descriptor* descriptor = host_lookupDescriptor(host, handle);
     if(descriptor == NULL) {
         warning("descriptor handle '%i' not found", handle);
@@ -1576,6 +1814,7 @@ gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes
     }
 
     Transport* transport = (Transport*) descriptor;
+    *transportOut = transport;
 
     /* we should block if our cpu has been too busy lately */
     if(cpu_isBlocked(host->cpu)) {
@@ -1590,6 +1829,20 @@ gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes
         return EAGAIN;
     }
 
+    return 0;
+}
+
+gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes,
+        in_addr_t* ip, in_port_t* port, gsize* bytesCopied) {
+    MAGIC_ASSERT(host);
+    utility_assert(ip && port && bytesCopied);
+
+    Transport* transport = NULL;
+    gint error = _host_prepareUserReceive(host, handle, nBytes, &transport);
+    if(error != 0) {
+        return error;
+    }
+
     gssize n = transport_receiveUserData(transport, buffer, nBytes, ip, port);
     if(n > 0) {
         /* user is reading some bytes. */
@@ -1603,6 +1856,48 @@ gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes
     return 0;
 }
 
+gint host_receiveUserMessages(Host* host, gint handle, TransportMessage* messages,
+        guint numMessages, guint* numReceived) {
+    MAGIC_ASSERT(host);
+    utility_assert(messages && numMessages > 0 && numReceived);
+
+    *numReceived = 0;
+
+    Transport* transport = NULL;
+    gint error = _host_prepareUserReceive(host, handle, messages[0].nBytes, &transport);
+    if(error != 0) {
+        return error;
+    }
+
+    if(descriptor_getType((Descriptor*)transport) == DT_UDPSOCKET) {
+        *numReceived = udp_receiveUserDatagrams((UDP*)transport, messages, numMessages);
+        return (*numReceived > 0) ? 0 : EWOULDBLOCK;
+    }
+
+    /* streams are read one message at a time until they run dry */
+    while(*numReceived < numMessages) {
+        TransportMessage* message = &messages[*numReceived];
+        gssize n = transport_receiveUserData(transport, message->buffer, message->nBytes,
+                &message->ip, &message->port);
+        if(n < 0) {
+            if(*numReceived == 0) {
+                return (n == -2) ? ENOTCONN : EWOULDBLOCK;
+            }
+            break;
+        }
+
+        message->bytesCopied = (gsize)n;
+        (*numReceived)++;
+
+        if(n == 0) {
+            /* end of file */
+            break;
+        }
+    }
+
+    return 0;
+}
+
 gint host_closeUser(Host* host, gint handle) {
     MAGIC_ASSERT(host);
 
@@ -1650,6 +1945,11 @@ gint host_shutdownSocket(Host* host, gint handle, gint how) {
     }
 }
 
+TimerWheel* host_getTimerWheel(Host* host) {
+    MAGIC_ASSERT(host);
+    return host->timerWheel;
+}
+
 Tracker* host_getTracker(Host* host) {
     MAGIC_ASSERT(host);
     return host->tracker;
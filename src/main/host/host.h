@@ -19,7 +19,10 @@
 #include "main/core/support/options.h"
 #include "main/host/cpu.h"
 #include "main/host/descriptor/descriptor.h"
+#include "main/host/descriptor/transport.h"
+#include "main/host/file_write_buffer.h"
 #include "main/host/network_interface.h"
+#include "main/host/timer_wheel.h"
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
@@ -35,11 +38,12 @@ struct _HostParameters {
     GQuark id;
     guint nodeSeed;
     gchar* hostname;
-    gchar* ipHint;
-    gchar* citycodeHint;
-    gchar* countrycodeHint;
-    gchar* geocodeHint;
-    gchar* typeHint;
+    /* the hints are interned, so hosts with the same configuration share them */
+    const gchar* ipHint;
+    const gchar* citycodeHint;
+    const gchar* countrycodeHint;
+    const gchar* geocodeHint;
+    const gchar* typeHint;
     guint64 requestedBWDownKiBps;
     guint64 requestedBWUpKiBps;
     guint64 cpuFrequency;
@@ -50,13 +54,15 @@ struct _HostParameters {
     LogInfoFlags heartbeatLogInfo;
     LogLevel logLevel;
     gboolean logPcap;
-    gchar* pcapDir;
+    const gchar* pcapDir;
     QDiscMode qdisc;
+    gboolean tcpSegmentationOffload;
     guint64 recvBufSize;
     gboolean autotuneRecvBuf;
     guint64 sendBufSize;
     gboolean autotuneSendBuf;
     guint64 interfaceBufSize;
+    guint64 fileWriteBufferSize;
 };
 
 Host* host_new(HostParameters* params);
@@ -81,6 +87,10 @@ void host_addApplication(Host* host, SimulationTime startTime, SimulationTime st
         const gchar* pluginName, const gchar* pluginPath, const gchar* pluginSymbol,
         const gchar* preloadName, const gchar* preloadPath, gchar* arguments);
 void host_freeAllApplications(Host* host);
+/* plugin namespaces of exited processes, kept for the next process of the same
+ * plugin. the key must be an interned string. returns NULL if none is pooled. */
+gpointer host_takePluginNamespace(Host* host, const gchar* pluginKey);
+void host_poolPluginNamespace(Host* host, const gchar* pluginKey, gpointer handle);
 
 gint host_compare(gconstpointer a, gconstpointer b, gpointer user_data);
 GQuark host_getID(Host* host);
@@ -88,6 +98,8 @@ gboolean host_isEqual(Host* a, Host* b);
 CPU* host_getCPU(Host* host);
 gchar* host_getName(Host* host);
 Address* host_getDefaultAddress(Host* host);
+/* events this host sends to other hosts are delayed by at least this much */
+SimulationTime host_getLookahead(Host* host);
 in_addr_t host_getDefaultIP(Host* host);
 Random* host_getRandom(Host* host);
 gdouble host_getNextPacketPriority(Host* host);
@@ -100,6 +112,8 @@ void host_closeDescriptor(Host* host, gint handle);
 gint host_closeUser(Host* host, gint handle);
 gint host_shutdownSocket(Host* host, gint handle, gint how);
 Descriptor* host_lookupDescriptor(Host* host, gint handle);
+void host_addStatusChangedDescriptor(Host* host, Descriptor* descriptor);
+void host_flushStatusChangedDescriptors(Host* host);
 NetworkInterface* host_lookupInterface(Host* host, in_addr_t handle);
 Router* host_getUpstreamRouter(Host* host, in_addr_t handle);
 
@@ -107,6 +121,18 @@ void host_returnHandleHack(gint handle);
 gboolean host_isShadowDescriptor(Host* host, gint handle);
 gint host_createShadowHandle(Host* host, gint osHandle);
 gint host_getOSHandle(Host* host, gint shadowHandle);
+/* writes through the file write buffer if enabled; returns 0 or an errno */
+gint host_writeFile(Host* host, gint shadowHandle, gconstpointer buffer, gsize nBytes, gsize* bytesWritten);
+/* waits until all buffered file writes reached the OS */
+void host_flushFileWrites(Host* host);
+/* as above, but only if some of them go to the given OS handle; must be called
+ * before anything else reads, writes, or inspects the file behind the handle */
+void host_flushFileWritesTo(Host* host, gint osHandle);
+/* as above, for the file at the given path */
+void host_flushFileWritesToPath(Host* host, const gchar* path, gboolean followLinks);
+/* flushes the file and checks again whether writes to it may be buffered; must
+ * be called around changing the flags of the OS handle */
+void host_fileFlagsChanged(Host* host, gint osHandle);
 gint host_getShadowHandle(Host* host, gint osHandle);
 void host_setRandomHandle(Host* host, gint handle);
 gboolean host_isRandomHandle(Host* host, gint handle);
@@ -125,10 +151,15 @@ gint host_listenForPeer(Host* host, gint handle, gint backlog);
 gint host_acceptNewPeer(Host* host, gint handle, in_addr_t* ip, in_port_t* port, gint* acceptedHandle);
 gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nBytes, in_addr_t ip, in_addr_t port, gsize* bytesCopied);
 gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes, in_addr_t* ip, in_port_t* port, gsize* bytesCopied);
+/* batched send and receive; an error is only returned if not even the first
+ * message could be handled, otherwise the count says how far we got */
+gint host_sendUserMessages(Host* host, gint handle, TransportMessage* messages, guint numMessages, guint* numSent);
+gint host_receiveUserMessages(Host* host, gint handle, TransportMessage* messages, guint numMessages, guint* numReceived);
 gint host_getPeerName(Host* host, gint handle, const struct sockaddr* address, socklen_t* len);
 gint host_getSocketName(Host* host, gint handle, const struct sockaddr* address, socklen_t* len);
 
 Tracker* host_getTracker(Host* host);
+TimerWheel* host_getTimerWheel(Host* host);
 LogLevel host_getLogLevel(Host* host);
 
 const gchar* host_getDataPath(Host* host);
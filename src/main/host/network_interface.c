@@ -5,13 +5,14 @@
  */
 
 #include <glib.h>
+#include <math.h>
 #include <netinet/in.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "main/core/support/definitions.h"
 #include "main/core/support/object_counter.h"
 #include "main/core/support/options.h"
-#include "main/core/work/task.h"
 #include "main/core/worker.h"
 #include "main/host/descriptor/descriptor.h"
 #include "main/host/descriptor/socket.h"
@@ -19,16 +20,20 @@
 #include "main/host/host.h"
 #include "main/host/network_interface.h"
 #include "main/host/protocol.h"
+#include "main/host/timer_wheel.h"
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
 #include "main/routing/packet.h"
 #include "main/routing/router.h"
 #include "main/utility/pcap_writer.h"
-#include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
+/* packet priorities are whole numbers from a per-host counter, so each
+ * bucket of the FIFO calendar covers one priority value per round */
+#define NETWORKINTERFACE_FIFO_NUM_BUCKETS 256
+
 typedef struct _NetworkInterfaceTokenBucket NetworkInterfaceTokenBucket;
 struct _NetworkInterfaceTokenBucket {
     /* The maximum number of bytes the bucket can hold */
@@ -37,6 +42,9 @@ struct _NetworkInterfaceTokenBucket {
     guint64 bytesRemaining;
     /* The number of bytes that get added to the bucket every millisecond */
     guint64 bytesRefill;
+    /* The number of bytes consumed by TSO aggregates beyond what the bucket
+     * held; these are paid back out of future refills */
+    guint64 bytesOverdrawn;
 };
 
 struct _NetworkInterface {
@@ -54,9 +62,15 @@ struct _NetworkInterface {
     /* (protocol,port)-to-socket bindings */
     GHashTable* boundSockets;
 
-    /* Transports wanting to send data out */
-    GQueue* rrQueue;
-    PriorityQueue* fifoQueue;
+    /* Transports wanting to send data out. Sockets are linked in through
+     * their SocketSendLinks, so queueing them never allocates. The round
+     * robin discipline uses a ring, FIFO uses a calendar of buckets keyed by
+     * the priority of each socket's next packet. */
+    Socket* rrHead;
+    Socket* fifoBuckets[NETWORKINTERFACE_FIFO_NUM_BUCKETS];
+    guint fifoLength;
+    /* no socket in the calendar has a smaller priority than this */
+    gdouble fifoMinPriority;
 
     /* the outgoing token bucket implements traffic shaping, i.e.,
      * packets are delayed until they conform with outgoing rate limits.*/
@@ -70,12 +84,24 @@ struct _NetworkInterface {
      * help us compute when refills should occur following an idle period. */
     SimulationTime timeStartedRefillingBuckets;
 
-    /* If we have scheduled a refill task but it has not yet executed. */
-    gboolean isRefillPending;
+    /* Our refill timer in the host timer wheel; it is armed while a refill
+     * is pending, and created the first time we need one. */
+    TimerWheelEntry* refillEntry;
+
+    /* Packets addressed to ourselves, waiting to be received back on this
+     * interface. They do not cross a router; one timer hands over everything
+     * sent within the same nanosecond instead of a task per packet. The
+     * sending socket shares these packets, and may queue them for
+     * retransmission again while they still wait here. */
+    PacketQueue localQueue;
+    TimerWheelEntry* localDeliveryEntry;
 
     /* To support capturing incoming and outgoing packets */
     PCapWriter* pcap;
 
+    /* If we send runs of back-to-back TCP segments as single aggregates */
+    gboolean useSegmentationOffload;
+
     MAGIC_DECLARE;
 };
 
@@ -84,10 +110,159 @@ static void _networkinterface_sendPackets(NetworkInterface* interface);
 static void _networkinterface_refillTokenBucketsCB(NetworkInterface* interface,
                                                    gpointer userData);
 
-static gint _networkinterface_compareSocket(const Socket* sa, const Socket* sb, gpointer userData) {
-    Packet* pa = socket_peekNextPacket(sa);
-    Packet* pb = socket_peekNextPacket(sb);
-    return packet_getPriority(pa) > packet_getPriority(pb) ? +1 : -1;
+static SocketSendLink* _networkinterface_findSendLink(NetworkInterface* interface, Socket* socket) {
+    for(gint i = 0; i < SOCKET_NUM_SEND_LINKS; i++) {
+        if(socket->sendLinks[i].interface == interface) {
+            return &(socket->sendLinks[i]);
+        }
+    }
+    return NULL;
+}
+
+static SocketSendLink* _networkinterface_claimSendLink(NetworkInterface* interface, Socket* socket) {
+    SocketSendLink* link = _networkinterface_findSendLink(interface, socket);
+    utility_assert(!link);
+    link = _networkinterface_findSendLink(NULL, socket);
+    utility_assert(link);
+    link->interface = interface;
+    return link;
+}
+
+static void _networkinterface_releaseSendLink(SocketSendLink* link) {
+    memset(link, 0, sizeof(SocketSendLink));
+}
+
+static void _networkinterface_pushRoundRobin(NetworkInterface* interface, Socket* socket) {
+    SocketSendLink* link = _networkinterface_claimSendLink(interface, socket);
+
+    if(!interface->rrHead) {
+        link->prev = link->next = socket;
+        interface->rrHead = socket;
+    } else {
+        /* the tail of the ring is right before the head */
+        Socket* head = interface->rrHead;
+        SocketSendLink* headLink = _networkinterface_findSendLink(interface, head);
+        Socket* tail = headLink->prev;
+        SocketSendLink* tailLink = _networkinterface_findSendLink(interface, tail);
+
+        link->prev = tail;
+        link->next = head;
+        tailLink->next = socket;
+        headLink->prev = socket;
+    }
+}
+
+static Socket* _networkinterface_popRoundRobin(NetworkInterface* interface) {
+    Socket* socket = interface->rrHead;
+    if(!socket) {
+        return NULL;
+    }
+
+    SocketSendLink* link = _networkinterface_findSendLink(interface, socket);
+    if(link->next == socket) {
+        interface->rrHead = NULL;
+    } else {
+        _networkinterface_findSendLink(interface, link->prev)->next = link->next;
+        _networkinterface_findSendLink(interface, link->next)->prev = link->prev;
+        interface->rrHead = link->next;
+    }
+
+    _networkinterface_releaseSendLink(link);
+    return socket;
+}
+
+static inline guint _networkinterface_getFifoBucket(gdouble priority) {
+    return (guint)((guint64)priority % NETWORKINTERFACE_FIFO_NUM_BUCKETS);
+}
+
+static void _networkinterface_pushFirstInFirstOut(NetworkInterface* interface,
+        Socket* socket, gdouble priority) {
+    SocketSendLink* link = _networkinterface_claimSendLink(interface, socket);
+    link->priority = priority;
+
+    guint bucket = _networkinterface_getFifoBucket(priority);
+    Socket* next = interface->fifoBuckets[bucket];
+    link->prev = NULL;
+    link->next = next;
+    if(next) {
+        _networkinterface_findSendLink(interface, next)->prev = socket;
+    }
+    interface->fifoBuckets[bucket] = socket;
+
+    if(interface->fifoLength == 0 || priority < interface->fifoMinPriority) {
+        interface->fifoMinPriority = priority;
+    }
+    interface->fifoLength++;
+}
+
+static void _networkinterface_unlinkFirstInFirstOut(NetworkInterface* interface,
+        Socket* socket, SocketSendLink* link) {
+    if(link->prev) {
+        _networkinterface_findSendLink(interface, link->prev)->next = link->next;
+    } else {
+        interface->fifoBuckets[_networkinterface_getFifoBucket(link->priority)] = link->next;
+    }
+    if(link->next) {
+        _networkinterface_findSendLink(interface, link->next)->prev = link->prev;
+    }
+
+    _networkinterface_releaseSendLink(link);
+    interface->fifoLength--;
+}
+
+/* returns the socket with the lowest priority in the bucket, ignoring those
+ * that belong to a later round of the calendar. ties go to the socket that
+ * was filed first, which is the one closest to the end of the bucket. */
+static Socket* _networkinterface_findFirstInBucket(NetworkInterface* interface,
+        guint bucket, gdouble priorityLimit) {
+    Socket* first = NULL;
+    gdouble firstPriority = 0;
+
+    Socket* socket = interface->fifoBuckets[bucket];
+    while(socket) {
+        SocketSendLink* link = _networkinterface_findSendLink(interface, socket);
+        if(link->priority < priorityLimit && (!first || link->priority <= firstPriority)) {
+            first = socket;
+            firstPriority = link->priority;
+        }
+        socket = link->next;
+    }
+
+    return first;
+}
+
+static Socket* _networkinterface_popFirstInFirstOut(NetworkInterface* interface) {
+    if(interface->fifoLength == 0) {
+        return NULL;
+    }
+
+    /* walk the buckets starting at the smallest possible priority. packet
+     * priorities come from a per-host counter, so the next socket is almost
+     * always found within a few buckets. */
+    Socket* first = NULL;
+    gdouble start = floor(interface->fifoMinPriority);
+    for(guint i = 0; !first && i < NETWORKINTERFACE_FIFO_NUM_BUCKETS; i++) {
+        gdouble bucketStart = start + i;
+        first = _networkinterface_findFirstInBucket(interface,
+                _networkinterface_getFifoBucket(bucketStart), bucketStart + 1);
+    }
+
+    /* the calendar is sparse, search every bucket */
+    for(guint i = 0; !first && i < NETWORKINTERFACE_FIFO_NUM_BUCKETS; i++) {
+        Socket* candidate = _networkinterface_findFirstInBucket(interface, i, INFINITY);
+        if(candidate && (!first ||
+                _networkinterface_findSendLink(interface, candidate)->priority <
+                _networkinterface_findSendLink(interface, first)->priority)) {
+            first = candidate;
+        }
+    }
+
+    utility_assert(first);
+    SocketSendLink* link = _networkinterface_findSendLink(interface, first);
+    interface->fifoMinPriority = link->priority;
+    _networkinterface_unlinkFirstInFirstOut(interface, first, link);
+
+    return first;
 }
 
 static inline SimulationTime _networkinterface_getRefillInterval() {
@@ -100,8 +275,15 @@ static inline guint64 _networkinterface_getCapacityFactor() {
 }
 
 static void _networkinterface_refillTokenBucket(NetworkInterfaceTokenBucket* bucket) {
+    /* Pay back what aggregates took before we can use new tokens. */
+    guint64 bytesRefill = bucket->bytesRefill;
+    if(bucket->bytesOverdrawn > 0) {
+        guint64 payback = MIN(bucket->bytesOverdrawn, bytesRefill);
+        bucket->bytesOverdrawn -= payback;
+        bytesRefill -= payback;
+    }
     /* We have room to add more tokens. */
-    bucket->bytesRemaining += bucket->bytesRefill;
+    bucket->bytesRemaining += bytesRefill;
     /* Make sure we stay within capacity. */
     if(bucket->bytesRemaining > bucket->bytesCapacity) {
         bucket->bytesRemaining = bucket->bytesCapacity;
@@ -118,13 +300,29 @@ _networkinterface_consumeTokenBucket(NetworkInterfaceTokenBucket* bucket,
     }
 }
 
-static void _networkinterface_scheduleRefillTask(NetworkInterface* interface,
-                                                 TaskCallbackFunc func,
+/* An aggregate arrives as a unit but stands in for several MTU-sized packets,
+ * so it may consume more than the bucket holds. The difference is carried
+ * over so that the long-term rate still matches the configured bandwidth. */
+static void
+_networkinterface_overdrawTokenBucket(NetworkInterfaceTokenBucket* bucket,
+                                      guint64 bytesConsumed) {
+    if (bytesConsumed > bucket->bytesRemaining) {
+        bucket->bytesOverdrawn += bytesConsumed - bucket->bytesRemaining;
+        bucket->bytesRemaining = 0;
+    } else {
+        bucket->bytesRemaining -= bytesConsumed;
+    }
+}
+
+static void _networkinterface_armRefillTimer(NetworkInterface* interface,
+                                                 TimerWheelCallbackFunc func,
                                                  SimulationTime delay) {
-    Task* refillTask = task_new(func, interface, NULL, NULL, NULL);
-    worker_scheduleTask(refillTask, delay);
-    task_unref(refillTask);
-    interface->isRefillPending = TRUE;
+    if (!interface->refillEntry) {
+        TimerWheel* wheel = host_getTimerWheel(worker_getActiveHost());
+        interface->refillEntry =
+            timerwheel_newEntry(wheel, func, interface, NULL, NULL, NULL);
+    }
+    timerwheel_arm(interface->refillEntry, worker_getCurrentTime() + delay);
 }
 
 static void _networkinterface_scheduleNextRefill(NetworkInterface* interface) {
@@ -139,8 +337,8 @@ static void _networkinterface_scheduleNextRefill(NetworkInterface* interface) {
     SimulationTime relTimeUntilNextRefill = interval - relTimeSincelastRefill;
 
     /* call back when we need the next refill */
-    _networkinterface_scheduleRefillTask(
-        interface, (TaskCallbackFunc)_networkinterface_refillTokenBucketsCB,
+    _networkinterface_armRefillTimer(
+        interface, (TimerWheelCallbackFunc)_networkinterface_refillTokenBucketsCB,
         relTimeUntilNextRefill);
 }
 
@@ -149,8 +347,9 @@ static gboolean _networkinterface_isRefillNeeded(NetworkInterface* interface) {
                                interface->sendBucket.bytesCapacity;
     gboolean receiveNeedsRefill = interface->receiveBucket.bytesRemaining <
                                   interface->receiveBucket.bytesCapacity;
-    return (sendNeedsRefill || receiveNeedsRefill) &&
-           !interface->isRefillPending;
+    gboolean isRefillPending = interface->refillEntry &&
+                               timerwheel_isArmed(interface->refillEntry);
+    return (sendNeedsRefill || receiveNeedsRefill) && !isRefillPending;
 }
 
 static void
@@ -164,9 +363,6 @@ static void _networkinterface_refillTokenBucketsCB(NetworkInterface* interface,
                                                    gpointer userData) {
     MAGIC_ASSERT(interface);
 
-    /* We no longer have an outstanding event in the event queue. */
-    interface->isRefillPending = FALSE;
-
     /* Refill the token buckets. */
     _networkinterface_refillTokenBucket(&interface->receiveBucket);
     _networkinterface_refillTokenBucket(&interface->sendBucket);
@@ -372,6 +568,30 @@ static void _networkinterface_capturePacket(NetworkInterface* interface, Packet*
     g_free(pcapPacket);
 }
 
+/* TSO aggregates are tracked and captured as the individual segments they carry,
+ * so the logs look the same as if each segment had crossed the wire by itself. */
+static void _networkinterface_trackPacket(NetworkInterface* interface, Packet* packet,
+        gint socketHandle, gboolean isIncoming) {
+    GList* segments = packet_getSegments(packet);
+    if(segments) {
+        for(GList* item = segments; item; item = g_list_next(item)) {
+            _networkinterface_trackPacket(interface, (Packet*)item->data, socketHandle, isIncoming);
+        }
+        return;
+    }
+
+    Tracker* tracker = host_getTracker(worker_getActiveHost());
+    if(isIncoming) {
+        tracker_addInputBytes(tracker, packet, socketHandle);
+    } else {
+        tracker_addOutputBytes(tracker, packet, socketHandle);
+    }
+
+    if(interface->pcap) {
+        _networkinterface_capturePacket(interface, packet);
+    }
+}
+
 static void _networkinterface_receivePacket(NetworkInterface* interface, Packet* packet) {
     MAGIC_ASSERT(interface);
 
@@ -412,12 +632,54 @@ static void _networkinterface_receivePacket(NetworkInterface* interface, Packet*
     }
 
     /* count our bandwidth usage by interface, and by socket handle if possible */
-    tracker_addInputBytes(host_getTracker(worker_getActiveHost()), packet, socketHandle);
-    if(interface->pcap) {
-        _networkinterface_capturePacket(interface, packet);
+    _networkinterface_trackPacket(interface, packet, socketHandle, TRUE);
+}
+
+static void _networkinterface_deliverLocalPacketsCB(NetworkInterface* interface, gpointer userData) {
+    MAGIC_ASSERT(interface);
+
+    /* packets that we send while delivering these (e.g., replies) are queued
+     * behind them and will arm the timer for the next round */
+    guint numPackets = packetqueue_getLength(&interface->localQueue);
+    for(guint i = 0; i < numPackets; i++) {
+        Packet* packet = packetqueue_pop(&interface->localQueue);
+        _networkinterface_receivePacket(interface, packet);
+        packet_unref(packet);
+    }
+}
+
+static void _networkinterface_queueLocalPacket(NetworkInterface* interface, Packet* packet) {
+    /* the queue holds its own ref until the packet is delivered */
+    packet_ref(packet);
+    packetqueue_push(&interface->localQueue, packet);
+
+    if(!interface->localDeliveryEntry) {
+        TimerWheel* wheel = host_getTimerWheel(worker_getActiveHost());
+        interface->localDeliveryEntry = timerwheel_newEntry(wheel,
+                (TimerWheelCallbackFunc)_networkinterface_deliverLocalPacketsCB,
+                interface, NULL, NULL, NULL);
+    }
+    if(!timerwheel_isArmed(interface->localDeliveryEntry)) {
+        timerwheel_arm(interface->localDeliveryEntry, worker_getCurrentTime() + 1);
     }
 }
 
+/* a datagram to our own address is handed to the socket bound to it right
+ * away, like on a Linux loopback device. it skips the queuing discipline and
+ * the local delivery queue, and the receiving socket's input buffer bounds how
+ * many can wait there. */
+void networkinterface_sendLocalDatagram(NetworkInterface* interface, Socket* transport, Packet* packet) {
+    MAGIC_ASSERT(interface);
+    utility_assert(packet_getProtocol(packet) == PUDP);
+    utility_assert(address_toNetworkIP(interface->address) == packet_getDestinationIP(packet));
+
+    packet_addDeliveryStatus(packet, PDS_SND_INTERFACE_SENT);
+    _networkinterface_trackPacket(interface, packet,
+            *descriptor_getHandleReference((Descriptor*)transport), FALSE);
+
+    _networkinterface_receivePacket(interface, packet);
+}
+
 void networkinterface_receivePackets(NetworkInterface* interface) {
     MAGIC_ASSERT(interface);
 
@@ -439,6 +701,7 @@ void networkinterface_receivePackets(NetworkInterface* interface) {
         }
 
         guint64 length = (guint64)(packet_getPayloadLength(packet) + packet_getHeaderSize(packet));
+        gboolean isAggregate = packet_getSegments(packet) != NULL;
 
         _networkinterface_receivePacket(interface, packet);
 
@@ -447,8 +710,13 @@ void networkinterface_receivePackets(NetworkInterface* interface) {
 
         /* update bandwidth accounting when not in infinite bandwidth mode */
         if(!bootstrapping) {
-            _networkinterface_consumeTokenBucket(&interface->receiveBucket,
-                                                 length);
+            if(isAggregate) {
+                _networkinterface_overdrawTokenBucket(&interface->receiveBucket,
+                                                      length);
+            } else {
+                _networkinterface_consumeTokenBucket(&interface->receiveBucket,
+                                                     length);
+            }
             _networkinterface_scheduleNextRefillIfNeeded(interface);
         }
     }
@@ -462,23 +730,90 @@ static void _networkinterface_updatePacketHeader(Descriptor* descriptor, Packet*
     }
 }
 
+static gboolean _networkinterface_isAggregatable(Packet* previous, Packet* next) {
+    if(!next || packet_getProtocol(next) != PTCP || packet_getPayloadLength(next) == 0) {
+        return FALSE;
+    }
+    PacketTCPHeader* previousHeader = packet_getTCPHeader(previous);
+    PacketTCPHeader* nextHeader = packet_getTCPHeader(next);
+    return nextHeader->sequence == previousHeader->sequence + 1 &&
+            !(nextHeader->flags & (PTCP_SYN|PTCP_FIN|PTCP_RST));
+}
+
+/* TCP segmentation offload: keep pulling in-sequence data segments from the
+ * socket that gave us the packet, as long as the send bucket would have let us
+ * send them one by one anyway. Each segment still passes through TCP so that
+ * retransmission state is kept per segment. */
+static Packet* _networkinterface_aggregateSegments(NetworkInterface* interface,
+        Socket* socket, Packet* packet) {
+    if(!interface->useSegmentationOffload ||
+            descriptor_getType((Descriptor*)socket) != DT_TCPSOCKET ||
+            packet_getPayloadLength(packet) == 0) {
+        return packet;
+    }
+
+    gboolean bootstrapping = worker_isBootstrapActive();
+    guint64 bytesRemaining = interface->sendBucket.bytesRemaining;
+    guint64 length = packet_getPayloadLength(packet) + packet_getHeaderSize(packet);
+    guint payloadLength = packet_getPayloadLength(packet);
+
+    Packet* aggregate = NULL;
+    Packet* previous = packet;
+
+    while(TRUE) {
+        Packet* next = socket_peekNextPacket(socket);
+        if(!_networkinterface_isAggregatable(previous, next)) {
+            break;
+        }
+
+        guint nextPayloadLength = packet_getPayloadLength(next);
+        guint64 nextLength = nextPayloadLength + packet_getHeaderSize(next);
+        if(payloadLength + nextPayloadLength > CONFIG_TSO_MAX_SIZE ||
+                (!bootstrapping && length + CONFIG_MTU > bytesRemaining)) {
+            break;
+        }
+
+        next = socket_pullOutPacket(socket);
+        _networkinterface_updatePacketHeader((Descriptor*)socket, next);
+
+        if(!aggregate) {
+            aggregate = packet_newAggregate(packet);
+            packet_unref(packet);
+        }
+        packet_addSegment(aggregate, next);
+        packet_unref(next);
+
+        length += nextLength;
+        payloadLength += nextPayloadLength;
+        previous = next;
+    }
+
+    if(aggregate) {
+        debug("sending TSO aggregate of %u segments with %u payload bytes",
+                packet_getSegmentCount(aggregate), payloadLength);
+    }
+
+    return aggregate ? aggregate : packet;
+}
+
 /* round robin queuing discipline ($ man tc)*/
 static Packet* _networkinterface_selectRoundRobin(NetworkInterface* interface, gint* socketHandle) {
     Packet* packet = NULL;
 
-    while(!packet && !g_queue_is_empty(interface->rrQueue)) {
+    while(!packet && interface->rrHead) {
         /* do round robin to get the next packet from the next socket */
-        Socket* socket = g_queue_pop_head(interface->rrQueue);
+        Socket* socket = _networkinterface_popRoundRobin(interface);
         packet = socket_pullOutPacket(socket);
         *socketHandle = *descriptor_getHandleReference((Descriptor*)socket);
 
         if(socket && packet) {
             _networkinterface_updatePacketHeader((Descriptor*)socket, packet);
+            packet = _networkinterface_aggregateSegments(interface, socket, packet);
         }
 
         if(socket_peekNextPacket(socket)) {
             /* socket has more packets, and is still reffed from before */
-            g_queue_push_tail(interface->rrQueue, socket);
+            _networkinterface_pushRoundRobin(interface, socket);
         } else {
             /* socket has no more packets, unref it from the sendable queue */
             descriptor_unref((Descriptor*) socket);
@@ -494,19 +829,21 @@ static Packet* _networkinterface_selectFirstInFirstOut(NetworkInterface* interfa
      * this is really a simplification of prioritizing on timestamps. */
     Packet* packet = NULL;
 
-    while(!packet && !priorityqueue_isEmpty(interface->fifoQueue)) {
+    while(!packet && interface->fifoLength > 0) {
         /* do fifo to get the next packet from the next socket */
-        Socket* socket = priorityqueue_pop(interface->fifoQueue);
+        Socket* socket = _networkinterface_popFirstInFirstOut(interface);
         packet = socket_pullOutPacket(socket);
         *socketHandle = *descriptor_getHandleReference((Descriptor*)socket);
 
         if(socket && packet) {
             _networkinterface_updatePacketHeader((Descriptor*)socket, packet);
+            packet = _networkinterface_aggregateSegments(interface, socket, packet);
         }
 
-        if(socket_peekNextPacket(socket)) {
+        Packet* next = socket_peekNextPacket(socket);
+        if(next) {
             /* socket has more packets, and is still reffed from before */
-            priorityqueue_push(interface->fifoQueue, socket);
+            _networkinterface_pushFirstInFirstOut(interface, socket, packet_getPriority(next));
         } else {
             /* socket has no more packets, unref it from the sendable queue */
             descriptor_unref((Descriptor*) socket);
@@ -548,11 +885,7 @@ static void _networkinterface_sendPackets(NetworkInterface* interface) {
         if(address_toNetworkIP(interface->address) == packet_getDestinationIP(packet)) {
             /* packet will arrive on our own interface, so it doesn't need to
              * go through the upstream router and does not consume bandwidth. */
-            packet_ref(packet);
-            Task* packetTask = task_new((TaskCallbackFunc)_networkinterface_receivePacket,
-                    interface, packet, NULL, (TaskArgumentFreeFunc)packet_unref);
-            worker_scheduleTask(packetTask, 1);
-            task_unref(packetTask);
+            _networkinterface_queueLocalPacket(interface, packet);
         } else {
             /* let the upstream router send to remote with appropriate delays.
              * if we get here we are not loopback and should have been assigned a router. */
@@ -568,10 +901,7 @@ static void _networkinterface_sendPackets(NetworkInterface* interface) {
             _networkinterface_scheduleNextRefillIfNeeded(interface);
         }
 
-        tracker_addOutputBytes(host_getTracker(worker_getActiveHost()), packet, socketHandle);
-        if(interface->pcap) {
-            _networkinterface_capturePacket(interface, packet);
-        }
+        _networkinterface_trackPacket(interface, packet, socketHandle, FALSE);
 
         /* sending side is done with its ref */
         packet_unref(packet);
@@ -584,17 +914,23 @@ void networkinterface_wantsSend(NetworkInterface* interface, Socket* socket) {
     /* track the new socket for sending if not already tracking */
     switch(interface->qdisc) {
         case QDISC_MODE_RR: {
-            if(!g_queue_find(interface->rrQueue, socket)) {
+            if(!_networkinterface_findSendLink(interface, socket)) {
                 descriptor_ref(socket);
-                g_queue_push_tail(interface->rrQueue, socket);
+                _networkinterface_pushRoundRobin(interface, socket);
             }
             break;
         }
         case QDISC_MODE_FIFO:
         default: {
-            if(!priorityqueue_find(interface->fifoQueue, socket)) {
+            gdouble priority = packet_getPriority(socket_peekNextPacket(socket));
+            SocketSendLink* link = _networkinterface_findSendLink(interface, socket);
+            if(!link) {
                 descriptor_ref(socket);
-                priorityqueue_push(interface->fifoQueue, socket);
+                _networkinterface_pushFirstInFirstOut(interface, socket, priority);
+            } else if(link->priority != priority) {
+                /* a control packet jumped the queue, refile under its priority */
+                _networkinterface_unlinkFirstInFirstOut(interface, socket, link);
+                _networkinterface_pushFirstInFirstOut(interface, socket, priority);
             }
             break;
         }
@@ -621,7 +957,8 @@ Router* networkinterface_getRouter(NetworkInterface* interface) {
 }
 
 NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, guint64 bwUpKiBps,
-        gboolean logPcap, gchar* pcapDir, QDiscMode qdisc, guint64 interfaceReceiveLength) {
+        gboolean logPcap, const gchar* pcapDir, QDiscMode qdisc, guint64 interfaceReceiveLength,
+        gboolean useSegmentationOffload) {
     NetworkInterface* interface = g_new0(NetworkInterface, 1);
     MAGIC_INIT(interface);
 
@@ -630,14 +967,13 @@ NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, gu
 
     /* incoming packets get passed along to sockets */
     interface->boundSockets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, descriptor_unref);
-
-    /* sockets tell us when they want to start sending */
-    interface->rrQueue = g_queue_new();
-    interface->fifoQueue = priorityqueue_new((GCompareDataFunc)_networkinterface_compareSocket, NULL, descriptor_unref);
+    packetqueue_init(&interface->localQueue);
 
     /* parse queuing discipline */
     interface->qdisc = (qdisc == QDISC_MODE_NONE) ? QDISC_MODE_FIFO : qdisc;
 
+    interface->useSegmentationOffload = useSegmentationOffload;
+
     if(logPcap) {
         GString* filename = g_string_new(NULL);
         g_string_printf(filename, "%s-%s",
@@ -662,16 +998,25 @@ void networkinterface_free(NetworkInterface* interface) {
     MAGIC_ASSERT(interface);
 
     /* unref all sockets wanting to send */
-    while(interface->rrQueue && !g_queue_is_empty(interface->rrQueue)) {
-        Socket* socket = g_queue_pop_head(interface->rrQueue);
+    Socket* socket = NULL;
+    while((socket = _networkinterface_popRoundRobin(interface)) != NULL) {
+        descriptor_unref(socket);
+    }
+    while((socket = _networkinterface_popFirstInFirstOut(interface)) != NULL) {
         descriptor_unref(socket);
     }
-    g_queue_free(interface->rrQueue);
-
-    priorityqueue_free(interface->fifoQueue);
 
     g_hash_table_destroy(interface->boundSockets);
 
+    if(interface->refillEntry) {
+        timerwheel_freeEntry(interface->refillEntry);
+    }
+
+    if(interface->localDeliveryEntry) {
+        timerwheel_freeEntry(interface->localDeliveryEntry);
+    }
+    packetqueue_clear(&interface->localQueue);
+
     if(interface->router) {
         router_unref(interface->router);
     }
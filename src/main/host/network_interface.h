@@ -19,7 +19,8 @@
 typedef struct _NetworkInterface NetworkInterface;
 
 NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, guint64 bwUpKiBps,
-        gboolean logPcap, gchar* pcapDir, QDiscMode qdisc, guint64 interfaceReceiveLength);
+        gboolean logPcap, const gchar* pcapDir, QDiscMode qdisc, guint64 interfaceReceiveLength,
+        gboolean useSegmentationOffload);
 void networkinterface_free(NetworkInterface* interface);
 
 Address* networkinterface_getAddress(NetworkInterface* interface);
@@ -32,6 +33,7 @@ void networkinterface_associate(NetworkInterface* interface, Socket* transport);
 void networkinterface_disassociate(NetworkInterface* interface, Socket* transport);
 
 void networkinterface_wantsSend(NetworkInterface* interface, Socket* transport);
+void networkinterface_sendLocalDatagram(NetworkInterface* interface, Socket* transport, Packet* packet);
 void networkinterface_sent(NetworkInterface* interface);
 
 void networkinterface_startRefillingTokenBuckets(NetworkInterface* interface);
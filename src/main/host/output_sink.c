@@ -0,0 +1,348 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/host/output_sink.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "main/core/support/definitions.h"
+#include "main/core/worker.h"
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+/* a run of consecutive bytes in the sink data that belong to the same stream */
+typedef struct _OutputRecord OutputRecord;
+struct _OutputRecord {
+    OutputStream* stream;
+    gsize length;
+};
+
+struct _OutputSink {
+    /* we write everything out once we buffered this many bytes */
+    gsize capacity;
+
+    /* the worker owns the sink, but another worker flushes it when one of our
+     * streams starts writing there, so the output stays in order */
+    GMutex lock;
+    GByteArray* data;
+    GArray* records;
+    /* monotonic time of the last flush, so that output trickles out even if
+     * the buffer never fills */
+    gint64 lastFlushTime;
+
+    MAGIC_DECLARE;
+};
+
+struct _OutputStream {
+    gchar* path;
+    gint fallbackFD;
+
+    /* the sink holding our buffered output, or NULL */
+    OutputSink* sink;
+    /* the errno from opening the file, if that failed */
+    gint openError;
+
+    MAGIC_DECLARE;
+};
+
+/* the open file of a stream */
+typedef struct _OutputFileEntry OutputFileEntry;
+struct _OutputFileEntry {
+    OutputStream* stream;
+    gint fd;
+    /* our link in the LRU queue */
+    GList* link;
+};
+
+/* all output files that are open, shared by all workers */
+typedef struct _OutputFileCache OutputFileCache;
+struct _OutputFileCache {
+    GMutex lock;
+    /* OutputStream* to OutputFileEntry* */
+    GHashTable* entries;
+    /* the most recently written entry is at the head */
+    GQueue* lru;
+};
+
+static OutputFileCache* _outputfilecache_get() {
+    static gsize isInitialized = 0;
+    static OutputFileCache cache;
+
+    if(g_once_init_enter(&isInitialized)) {
+        g_mutex_init(&cache.lock);
+        cache.entries = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+        cache.lru = g_queue_new();
+        g_once_init_leave(&isInitialized, 1);
+    }
+
+    return &cache;
+}
+
+/* must be called with the cache lock held */
+static void _outputfilecache_close(OutputFileCache* cache, OutputFileEntry* entry) {
+    g_queue_delete_link(cache->lru, entry->link);
+    close(entry->fd);
+    g_hash_table_remove(cache->entries, entry->stream);
+}
+
+/* must be called with the cache lock held, which must also be held while
+ * using the returned descriptor since other threads may close it */
+static gint _outputfilecache_getFD(OutputFileCache* cache, OutputStream* stream) {
+    OutputFileEntry* entry = g_hash_table_lookup(cache->entries, stream);
+    if(entry) {
+        if(entry->link != cache->lru->head) {
+            g_queue_unlink(cache->lru, entry->link);
+            g_queue_push_head_link(cache->lru, entry->link);
+        }
+        return entry->fd;
+    }
+
+    if(stream->openError) {
+        return stream->fallbackFD;
+    }
+
+    while(g_queue_get_length(cache->lru) >= CONFIG_OUTPUT_SINK_MAX_OPEN_FILES) {
+        _outputfilecache_close(cache, g_queue_peek_tail(cache->lru));
+    }
+
+    gint fd = open(stream->path, O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0666);
+    if(fd < 0) {
+        /* logging now could recurse if the plugin is logging through glib,
+         * so the error is reported when the stream is freed */
+        stream->openError = errno;
+        return stream->fallbackFD;
+    }
+
+    entry = g_new0(OutputFileEntry, 1);
+    entry->stream = stream;
+    entry->fd = fd;
+    g_queue_push_head(cache->lru, entry);
+    entry->link = cache->lru->head;
+    g_hash_table_insert(cache->entries, stream, entry);
+
+    return fd;
+}
+
+static void _outputsink_writeAll(gint fd, const guint8* data, gsize length) {
+    while(length > 0) {
+        gssize result = write(fd, data, length);
+        if(result < 0 && errno == EINTR) {
+            continue;
+        } else if(result <= 0) {
+            /* nowhere else to put it */
+            return;
+        }
+        data += result;
+        length -= (gsize)result;
+    }
+}
+
+/* must be called with the sink lock held */
+static gboolean _outputsink_isFlushDue(OutputSink* sink) {
+    return sink->data->len >= sink->capacity ||
+            g_get_monotonic_time() - sink->lastFlushTime >= CONFIG_OUTPUT_SINK_FLUSH_INTERVAL;
+}
+
+/* must be called with the sink lock held */
+static void _outputsink_flushLocked(OutputSink* sink) {
+    sink->lastFlushTime = g_get_monotonic_time();
+
+    if(sink->records->len == 0) {
+        return;
+    }
+
+    OutputFileCache* cache = _outputfilecache_get();
+    g_mutex_lock(&cache->lock);
+
+    gsize offset = 0;
+    for(guint i = 0; i < sink->records->len; i++) {
+        OutputRecord* record = &g_array_index(sink->records, OutputRecord, i);
+        gint fd = _outputfilecache_getFD(cache, record->stream);
+        _outputsink_writeAll(fd, &sink->data->data[offset], record->length);
+        offset += record->length;
+
+        /* the stream may be on another worker by now, only forget our own sink */
+        g_atomic_pointer_compare_and_exchange(&record->stream->sink, sink, NULL);
+    }
+
+    g_mutex_unlock(&cache->lock);
+
+    g_byte_array_set_size(sink->data, 0);
+    g_array_set_size(sink->records, 0);
+}
+
+OutputSink* outputsink_new(gsize capacity) {
+    OutputSink* sink = g_new0(OutputSink, 1);
+    MAGIC_INIT(sink);
+
+    sink->capacity = capacity;
+    g_mutex_init(&sink->lock);
+    sink->data = g_byte_array_sized_new((guint)capacity);
+    sink->records = g_array_new(FALSE, FALSE, sizeof(OutputRecord));
+    sink->lastFlushTime = g_get_monotonic_time();
+
+    return sink;
+}
+
+void outputsink_free(OutputSink* sink) {
+    MAGIC_ASSERT(sink);
+
+    outputsink_flush(sink);
+
+    g_byte_array_free(sink->data, TRUE);
+    g_array_free(sink->records, TRUE);
+    g_mutex_clear(&sink->lock);
+
+    MAGIC_CLEAR(sink);
+    g_free(sink);
+}
+
+void outputsink_flush(OutputSink* sink) {
+    MAGIC_ASSERT(sink);
+    g_mutex_lock(&sink->lock);
+    _outputsink_flushLocked(sink);
+    g_mutex_unlock(&sink->lock);
+}
+
+void outputsink_flushIfDue(OutputSink* sink) {
+    MAGIC_ASSERT(sink);
+    g_mutex_lock(&sink->lock);
+    if(sink->records->len > 0 && _outputsink_isFlushDue(sink)) {
+        _outputsink_flushLocked(sink);
+    }
+    g_mutex_unlock(&sink->lock);
+}
+
+OutputStream* outputstream_new(const gchar* path, gint fallbackFD) {
+    utility_assert(path);
+
+    OutputStream* stream = g_new0(OutputStream, 1);
+    MAGIC_INIT(stream);
+
+    stream->path = g_strdup(path);
+    stream->fallbackFD = fallbackFD;
+
+    return stream;
+}
+
+/* the output we buffered in another sink must be written before anything we
+ * buffer in the given one, e.g. when our host moved to another worker */
+static void _outputstream_flushOtherSink(OutputStream* stream, OutputSink* sink) {
+    OutputSink* previousSink = g_atomic_pointer_get(&stream->sink);
+    if(previousSink && previousSink != sink) {
+        outputsink_flush(previousSink);
+    }
+}
+
+void outputstream_free(OutputStream* stream) {
+    MAGIC_ASSERT(stream);
+
+    _outputstream_flushOtherSink(stream, NULL);
+
+    OutputFileCache* cache = _outputfilecache_get();
+    g_mutex_lock(&cache->lock);
+    OutputFileEntry* entry = g_hash_table_lookup(cache->entries, stream);
+    if(entry) {
+        _outputfilecache_close(cache, entry);
+    }
+    g_mutex_unlock(&cache->lock);
+
+    if(stream->openError) {
+        warning("unable to open file '%s' for process output, error was: %s; the output was "
+                "written to shadow's %s instead", stream->path, g_strerror(stream->openError),
+                stream->fallbackFD == STDERR_FILENO ? "stderr" : "stdout");
+    }
+
+    g_free(stream->path);
+
+    MAGIC_CLEAR(stream);
+    g_free(stream);
+}
+
+void outputstream_write(OutputStream* stream, gconstpointer data, gsize nBytes) {
+    MAGIC_ASSERT(stream);
+
+    if(nBytes == 0) {
+        return;
+    }
+
+    OutputSink* sink = worker_isAlive() ? worker_getOutputSink() : NULL;
+    _outputstream_flushOtherSink(stream, sink);
+
+    if(!sink) {
+        /* we are not on a worker thread, so there is nothing to buffer in */
+        OutputFileCache* cache = _outputfilecache_get();
+        g_mutex_lock(&cache->lock);
+        _outputsink_writeAll(_outputfilecache_getFD(cache, stream), data, nBytes);
+        g_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    g_mutex_lock(&sink->lock);
+
+    OutputRecord* last = NULL;
+    if(sink->records->len > 0) {
+        last = &g_array_index(sink->records, OutputRecord, sink->records->len - 1);
+    }
+
+    if(last && last->stream == stream) {
+        last->length += nBytes;
+    } else {
+        OutputRecord record = {.stream = stream, .length = nBytes};
+        g_array_append_val(sink->records, record);
+    }
+    g_byte_array_append(sink->data, data, (guint)nBytes);
+    g_atomic_pointer_set(&stream->sink, sink);
+
+    if(_outputsink_isFlushDue(sink)) {
+        _outputsink_flushLocked(sink);
+    }
+
+    g_mutex_unlock(&sink->lock);
+}
+
+gint outputstream_sync(OutputStream* stream) {
+    MAGIC_ASSERT(stream);
+
+    _outputstream_flushOtherSink(stream, NULL);
+
+    OutputFileCache* cache = _outputfilecache_get();
+    g_mutex_lock(&cache->lock);
+    gint result = fsync(_outputfilecache_getFD(cache, stream));
+    gint error = (result < 0) ? errno : 0;
+    g_mutex_unlock(&cache->lock);
+
+    return error;
+}
+
+static ssize_t _outputstream_writeCookie(void* cookie, const char* buffer, size_t size) {
+    outputstream_write((OutputStream*)cookie, buffer, size);
+    return (ssize_t)size;
+}
+
+static int _outputstream_closeCookie(void* cookie) {
+    outputstream_free((OutputStream*)cookie);
+    return 0;
+}
+
+FILE* outputstream_openFile(OutputStream* stream) {
+    MAGIC_ASSERT(stream);
+
+    cookie_io_functions_t functions = {
+        .read = NULL,
+        .write = _outputstream_writeCookie,
+        .seek = NULL,
+        .close = _outputstream_closeCookie,
+    };
+
+    FILE* file = fopencookie(stream, "w", functions);
+    if(file) {
+        setvbuf(file, NULL, _IONBF, 0);
+    }
+    return file;
+}
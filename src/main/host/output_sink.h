@@ -0,0 +1,46 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_OUTPUT_SINK_H_
+#define SHD_OUTPUT_SINK_H_
+
+#include <glib.h>
+#include <stdio.h>
+
+/* A large buffer owned by a worker that collects the stdout and stderr output
+ * of all processes the worker runs, and writes it out in batches. Only a
+ * bounded number of the output files are kept open at a time; the least
+ * recently written ones are closed and reopened in append mode when needed. */
+typedef struct _OutputSink OutputSink;
+
+/* The output of one process to one of its standard streams. */
+typedef struct _OutputStream OutputStream;
+
+OutputSink* outputsink_new(gsize capacity);
+/* writes out everything that is still buffered */
+void outputsink_free(OutputSink* sink);
+void outputsink_flush(OutputSink* sink);
+/* writes out everything that is buffered if the last write out was at least
+ * CONFIG_OUTPUT_SINK_FLUSH_INTERVAL ago, so the output shows up even when
+ * the processes stop writing */
+void outputsink_flushIfDue(OutputSink* sink);
+
+/* the file is not opened until the first batch is written. if it can not be
+ * opened, the output goes to fallbackFD instead. */
+OutputStream* outputstream_new(const gchar* path, gint fallbackFD);
+/* writes out anything that is still buffered for the stream */
+void outputstream_free(OutputStream* stream);
+
+/* buffers the data in the sink of the current worker */
+void outputstream_write(OutputStream* stream, gconstpointer data, gsize nBytes);
+/* writes out anything buffered for the stream and syncs the file to disk.
+ * returns 0 on success, or an errno value. */
+gint outputstream_sync(OutputStream* stream);
+
+/* returns an unbuffered stdio stream that writes into the stream, so that the
+ * plugin output is only buffered once. closing it frees the stream. */
+FILE* outputstream_openFile(OutputStream* stream);
+
+#endif /* SHD_OUTPUT_SINK_H_ */
@@ -64,6 +64,7 @@
 #include "main/host/descriptor/tcp.h"
 #include "main/host/descriptor/timer.h"
 #include "main/host/host.h"
+#include "main/host/output_sink.h"
 #include "main/host/process.h"
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
@@ -166,15 +167,24 @@ struct _Process {
     GString* processName;
     FILE* stdoutFile;
     FILE* stderrFile;
+    /* the buffered output behind the files, NULL if we fell back to the tty */
+    OutputStream* stdoutStream;
+    OutputStream* stderrStream;
 
-    /* the shadow plugin executable */
+    /* the shadow plugin executable. the strings are interned, and so are shared
+     * with all other processes running the same plugin. */
     struct {
-        GString* name;
-        GString* path;
-        GString* startSymbol;
+        const gchar* name;
+        const gchar* path;
+        const gchar* startSymbol;
         void* handle;
-        GString* preloadName;
-        GString* preloadPath;
+        const gchar* preloadName;
+        const gchar* preloadPath;
+        /* identifies the namespaces this process may reuse from exited processes
+         * on our host, i.e., those with the same plugin and preload */
+        const gchar* namespaceKey;
+        /* if the namespace may be reset and reused once we exit */
+        gboolean isResettable;
 
         /* every plug-in needs a main function, which we call to start the virtual process */
         PluginMainFunc main;
@@ -240,7 +250,10 @@ struct _Process {
     /* process boot and shutdown variables */
     SimulationTime startTime;
     SimulationTime stopTime;
-    GString* arguments;
+    /* the interned argument string, and its words which are shared by all
+     * processes that were configured with the same arguments */
+    const gchar* arguments;
+    const gchar* const* argumentWords;
     gchar** argv;
     gint argc;
     gint returnCode;
@@ -284,18 +297,18 @@ static ProcessContext _process_changeContext(Process* proc, ProcessContext from,
 static const gchar* _process_getPluginPath(Process* proc) {
     MAGIC_ASSERT(proc);
     utility_assert(proc->plugin.path);
-    return proc->plugin.path->str;
+    return proc->plugin.path;
 }
 
 static const gchar* _process_getPluginName(Process* proc) {
     MAGIC_ASSERT(proc);
     utility_assert(proc->plugin.name);
-    return proc->plugin.name->str;
+    return proc->plugin.name;
 }
 
 static const gchar* _process_getPluginStartSymbol(Process* proc) {
     MAGIC_ASSERT(proc);
-    return proc->plugin.startSymbol ? proc->plugin.startSymbol->str
+    return proc->plugin.startSymbol ? proc->plugin.startSymbol
                                     : PLUGIN_DEFAULT_SYMBOL;
 }
 
@@ -321,7 +334,7 @@ static void _process_updateErrnoLocation(Process* proc) {
         const gchar* errorMessage = dlerror();
         critical("dlsym() failed: %s", errorMessage);
         error("unable to find the required function symbol '%s' in plug-in '%s'",
-                PLUGIN_ERRNOLOC_SYMBOL, proc->plugin.path->str);
+                PLUGIN_ERRNOLOC_SYMBOL, proc->plugin.path);
     }
 }
 
@@ -362,9 +375,9 @@ static void _process_unloadPlugin(Process* proc) {
         if(dlclose(proc->plugin.handle) != 0) {
             const gchar* errorMessage = dlerror();
             warning("dlclose() failed: %s", errorMessage);
-            warning("failed closing plugin '%s' at address '%p'", proc->plugin.path->str, proc->plugin.handle);
+            warning("failed closing plugin '%s' at address '%p'", proc->plugin.path, proc->plugin.handle);
         } else {
-            message("successfully unloaded private plug-in '%s' at address '%p'", proc->plugin.path->str, proc->plugin.handle);
+            message("successfully unloaded private plug-in '%s' at address '%p'", proc->plugin.path, proc->plugin.handle);
         }
     }
 
@@ -376,9 +389,8 @@ static void _process_pluginSignalHandler(int signum) {
     abort();
 }
 
-static void _process_loadPlugin(Process* proc) {
+static void _process_openPluginNamespace(Process* proc) {
     MAGIC_ASSERT(proc);
-    utility_assert(!proc->plugin.handle);
 
     /*
      * get the plugin handle from the library at filename.
@@ -413,8 +425,10 @@ static void _process_loadPlugin(Process* proc) {
     /* clear dlerror status string */
     dlerror();
 
-    /* We need lazy binding here, so that later loads can interpose symbols. */
-    proc->plugin.handle = dlmopen(LM_ID_NEWLM, proc->plugin.path->str, RTLD_LAZY|RTLD_GLOBAL);
+    /* We need lazy binding here, so that later loads can interpose symbols.
+     * A resettable namespace keeps a copy of its data so it can be reused when we exit. */
+    gint resetFlag = proc->plugin.isResettable ? RTLD_RESETTABLE : 0;
+    proc->plugin.handle = dlmopen(LM_ID_NEWLM, proc->plugin.path, RTLD_LAZY|RTLD_GLOBAL|resetFlag);
     const gchar* errorMessage = dlerror();
 
     _process_changeContext(proc, PCTX_PLUGIN, PCTX_SHADOW);
@@ -427,8 +441,8 @@ static void _process_loadPlugin(Process* proc) {
                 _process_getName(proc), _process_getPluginName(proc), _process_getPluginPath(proc),
                 proc->plugin.handle, secondsElapsedDuringLoad);
     } else {
-        critical("dlmopen() failed to load plugin '%s': %s", proc->plugin.path->str, errorMessage);
-        error("unable to load private plug-in '%s'", proc->plugin.path->str);
+        critical("dlmopen() failed to load plugin '%s': %s", proc->plugin.path, errorMessage);
+        error("unable to load private plug-in '%s'", proc->plugin.path);
     }
     /* clear dlerror status string */
     dlerror();
@@ -444,7 +458,7 @@ static void _process_loadPlugin(Process* proc) {
         proc->lmid = lmid;
     } else {
         critical("dlinfo() failed when querying for LMID: %s", errorMessage2);
-        error("unable to load preload library '%s'", proc->plugin.preloadPath->str);
+        error("unable to load preload library '%s'", proc->plugin.preloadPath);
     }
     /* do we also need to load in a preload library for this plugin? */
     if(proc->plugin.preloadPath) {
@@ -459,7 +473,7 @@ static void _process_loadPlugin(Process* proc) {
         dlerror();
 
         /* now we have the correct lmid, lets load our preload library into it */
-        dlmopen(lmid, proc->plugin.preloadPath->str, RTLD_LAZY|RTLD_GLOBAL|RTLD_INTERPOSE);
+        dlmopen(lmid, proc->plugin.preloadPath, RTLD_LAZY|RTLD_GLOBAL|RTLD_INTERPOSE|resetFlag);
 
         const gchar* errorMessage3 = dlerror();
 
@@ -470,15 +484,100 @@ static void _process_loadPlugin(Process* proc) {
 
         if(!errorMessage3) {
             message("process '%s' successfully loaded preload '%s' at path '%s' into existing namespace '%p' in %f seconds",
-                    _process_getName(proc), proc->plugin.preloadName->str, proc->plugin.preloadPath->str,
+                    _process_getName(proc), proc->plugin.preloadName, proc->plugin.preloadPath,
                     proc->plugin.handle, secondsElapsedDuringLoad);
         } else {
-            critical("dlinfo() failed to load preload '%s': %s", proc->plugin.path->str, errorMessage3);
-            error("unable to load preload library '%s'", proc->plugin.preloadPath->str);
+            critical("dlinfo() failed to load preload '%s': %s", proc->plugin.path, errorMessage3);
+            error("unable to load preload library '%s'", proc->plugin.preloadPath);
         }
     }
 
     g_timer_destroy(loadTimer);
+}
+
+/* a namespace that an exited process of the same plugin left on our host is
+ * returned to its freshly loaded state, which is much cheaper than loading and
+ * relocating the plugin and all of its libraries again. the namespace must come
+ * from our host, because the TLS of the namespace lives in the thread that
+ * runs the host. */
+static gboolean _process_reusePluginNamespace(Process* proc) {
+    MAGIC_ASSERT(proc);
+
+    gpointer handle = host_takePluginNamespace(proc->host, proc->plugin.namespaceKey);
+    if(!handle) {
+        return FALSE;
+    }
+
+    GTimer* loadTimer = g_timer_new();
+
+    /* clear dlerror status string */
+    dlerror();
+
+    Lmid_t lmid = 0;
+    gint result = dlinfo(handle, RTLD_DI_LMID, &lmid);
+
+    if(result == 0) {
+        /* the plugin constructors get called again, so make sure we make that
+         * call from the plugin context. */
+        _process_changeContext(proc, PCTX_SHADOW, PCTX_PLUGIN);
+        result = dl_lmid_reset(lmid);
+        _process_changeContext(proc, PCTX_PLUGIN, PCTX_SHADOW);
+    }
+
+    gdouble secondsElapsedDuringLoad = g_timer_elapsed(loadTimer, NULL);
+    g_timer_destroy(loadTimer);
+
+    if(result != 0) {
+        /* e.g., the plugin dlopened a library on its own while it was running. the
+         * namespace was left as it was, but we can not use it again. */
+        const gchar* errorMessage = dlerror();
+        warning("unable to reset namespace '%p' of plugin '%s', loading it again: %s",
+                handle, _process_getPluginPath(proc), errorMessage);
+        return FALSE;
+    }
+
+    proc->plugin.handle = handle;
+    proc->lmid = lmid;
+
+    message("process '%s' successfully reset plugin '%s' at path '%s' in reused namespace '%p' in %f seconds",
+            _process_getName(proc), _process_getPluginName(proc), _process_getPluginPath(proc),
+            proc->plugin.handle, secondsElapsedDuringLoad);
+    return TRUE;
+}
+
+/* the namespace is kept for the next process of the same plugin on our host,
+ * since elf-loader can not unload it */
+static void _process_releasePlugin(Process* proc) {
+    MAGIC_ASSERT(proc);
+
+    /* without reuse the namespace stays with us, as it always did */
+    if(!proc->plugin.handle || !proc->plugin.isResettable) {
+        return;
+    }
+
+    host_poolPluginNamespace(proc->host, proc->plugin.namespaceKey, proc->plugin.handle);
+
+    proc->plugin.handle = NULL;
+    /* we no longer own the TLS of the namespace, so it must not be swapped */
+    proc->lmid = 0;
+    proc->plugin.main = NULL;
+    proc->plugin.postLibraryLoad = NULL;
+    proc->plugin.preLibraryUnload = NULL;
+    proc->plugin.preProcessEnter = NULL;
+    proc->plugin.postProcessExit = NULL;
+    proc->plugin.sigaction = NULL;
+    proc->plugin.errnoGetLocation = NULL;
+}
+
+static void _process_loadPlugin(Process* proc) {
+    MAGIC_ASSERT(proc);
+    utility_assert(!proc->plugin.handle);
+
+    proc->plugin.isResettable = options_doReusePluginNamespaces(worker_getOptions());
+
+    if(!proc->plugin.isResettable || !_process_reusePluginNamespace(proc)) {
+        _process_openPluginNamespace(proc);
+    }
 
     /* the remaining dlsym lookups should not cause code inside the plugin to get
      * executed, so we should be able to do them from the shadow context. */
@@ -563,6 +662,43 @@ static void _process_loadPlugin(Process* proc) {
     }
 }
 
+/* splits an interned argument string into its space separated words. the result is
+ * cached, so all processes with the same arguments share it until shadow exits. */
+static const gchar* const* _process_getArgumentWords(const gchar* arguments) {
+    static GMutex lock;
+    static GHashTable* argumentsToWords = NULL;
+
+    g_mutex_lock(&lock);
+
+    if(!argumentsToWords) {
+        /* the keys are interned, so we compare them by address */
+        argumentsToWords = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+
+    gchar** words = g_hash_table_lookup(argumentsToWords, arguments);
+    if(!words) {
+        gchar** tokens = g_strsplit(arguments, " ", -1);
+        guint nWords = 0;
+
+        /* repeated spaces produce empty tokens, which are not arguments */
+        for(guint i = 0; tokens[i] != NULL; i++) {
+            if(tokens[i][0] != '\0') {
+                tokens[nWords++] = tokens[i];
+            } else {
+                g_free(tokens[i]);
+            }
+        }
+        tokens[nWords] = NULL;
+
+        words = tokens;
+        g_hash_table_insert(argumentsToWords, (gpointer)arguments, words);
+    }
+
+    g_mutex_unlock(&lock);
+
+    return (const gchar* const*)words;
+}
+
 Process* process_new(gpointer host, guint processID,
         SimulationTime startTime, SimulationTime stopTime, const gchar* pluginName,
         const gchar* pluginPath, const gchar* pluginSymbol, const gchar* preloadName,
@@ -579,15 +715,19 @@ Process* process_new(gpointer host, guint processID,
 
     utility_assert(pluginPath);
     utility_assert(pluginName);
-    proc->plugin.name = g_string_new(pluginName);
-    proc->plugin.path = g_string_new(pluginPath);
+    proc->plugin.name = g_intern_string(pluginName);
+    proc->plugin.path = g_intern_string(pluginPath);
     if(pluginSymbol) {
-        proc->plugin.startSymbol = g_string_new(pluginSymbol);
+        proc->plugin.startSymbol = g_intern_string(pluginSymbol);
     }
     if(preloadName && preloadPath) {
-        proc->plugin.preloadName = g_string_new(preloadName);
-        proc->plugin.preloadPath = g_string_new(preloadPath);
+        proc->plugin.preloadName = g_intern_string(preloadName);
+        proc->plugin.preloadPath = g_intern_string(preloadPath);
     }
+    gchar* namespaceKey = g_strconcat(proc->plugin.path, "|",
+            proc->plugin.preloadPath ? proc->plugin.preloadPath : "", NULL);
+    proc->plugin.namespaceKey = g_intern_string(namespaceKey);
+    g_free(namespaceKey);
 
     proc->processName = g_string_new(NULL);
     g_string_printf(proc->processName, "%s.%s.%u",
@@ -596,7 +736,8 @@ Process* process_new(gpointer host, guint processID,
     proc->startTime = startTime;
     proc->stopTime = stopTime;
     if(arguments && (g_ascii_strncasecmp(arguments, "\0", (gsize) 1) != 0)) {
-        proc->arguments = g_string_new(arguments);
+        proc->arguments = g_intern_string(arguments);
+        proc->argumentWords = _process_getArgumentWords(proc->arguments);
     }
 
     proc->cpuDelayTimer = g_timer_new();
@@ -620,6 +761,22 @@ static void _process_logCachedWarnings(Process* proc) {
     }
 }
 
+/* closing the file also writes out and frees its buffered output */
+static gint _process_closeIOFile(Process* proc, gint fd) {
+    FILE** file = (fd == STDOUT_FILENO) ? &proc->stdoutFile : &proc->stderrFile;
+    OutputStream** stream = (fd == STDOUT_FILENO) ? &proc->stdoutStream : &proc->stderrStream;
+
+    gint ret = 0;
+    /* without a stream, the file is shadow's own tty stream */
+    if(*file && *stream) {
+        ret = fclose(*file);
+    }
+
+    *file = NULL;
+    *stream = NULL;
+    return ret;
+}
+
 static void _process_free(Process* proc) {
     MAGIC_ASSERT(proc);
 
@@ -628,42 +785,17 @@ static void _process_free(Process* proc) {
         process_stop(proc);
     }
 
-    if(proc->arguments) {
-        g_string_free(proc->arguments, TRUE);
-    }
-
     if(proc->atExitFunctions) {
         g_queue_free_full(proc->atExitFunctions, g_free);
     }
 
-    if(proc->stdoutFile) {
-        fclose(proc->stdoutFile);
-        proc->stdoutFile = NULL;
-    }
-    if(proc->stderrFile) {
-        fclose(proc->stderrFile);
-        proc->stderrFile = NULL;
-    }
+    _process_closeIOFile(proc, STDOUT_FILENO);
+    _process_closeIOFile(proc, STDERR_FILENO);
 
     if(proc->cachedWarningMessages) {
         _process_logCachedWarnings(proc);
         g_queue_free(proc->cachedWarningMessages);
     }
-    if(proc->plugin.path) {
-        g_string_free(proc->plugin.path, TRUE);
-    }
-    if(proc->plugin.name) {
-        g_string_free(proc->plugin.name, TRUE);
-    }
-    if(proc->plugin.startSymbol) {
-        g_string_free(proc->plugin.startSymbol, TRUE);
-    }
-    if(proc->plugin.preloadPath) {
-        g_string_free(proc->plugin.preloadPath, TRUE);
-    }
-    if(proc->plugin.preloadName) {
-        g_string_free(proc->plugin.preloadName, TRUE);
-    }
     if(proc->processName) {
         g_string_free(proc->processName, TRUE);
     }
@@ -680,14 +812,22 @@ static void _process_free(Process* proc) {
     g_free(proc);
 }
 
-static FILE* _process_openFile(Process* proc, const gchar* prefix) {
+static FILE* _process_openFile(Process* proc, const gchar* prefix, gint fallbackFD,
+        OutputStream** streamOut) {
     const gchar* hostDataPath = host_getDataPath(proc->host);
     GString* fileNameString = g_string_new(NULL);
     g_string_printf(fileNameString, "%s-%s.log", prefix, _process_getName(proc));
     gchar* pathStr = g_build_filename(hostDataPath, fileNameString->str, NULL);
-    FILE* f = g_fopen(pathStr, "a");
     g_string_free(fileNameString, TRUE);
+
+    /* the output is buffered by our worker, which opens the file only when
+     * writing it out so we do not hold descriptors for every process */
+    OutputStream* stream = outputstream_new(pathStr, fallbackFD);
+    FILE* f = outputstream_openFile(stream);
     if(!f) {
+        outputstream_free(stream);
+        stream = NULL;
+
         /* if we log as normal, glib will freak out about recursion if the plugin was trying to log with glib */
         if(!proc->cachedWarningMessages) {
             proc->cachedWarningMessages = g_queue_new();
@@ -696,11 +836,9 @@ static FILE* _process_openFile(Process* proc, const gchar* prefix) {
         g_string_printf(stringBuffer, "process '%s': unable to open file '%s', error was: %s",
                 _process_getName(proc), pathStr, g_strerror(errno));
         g_queue_push_tail(proc->cachedWarningMessages, g_string_free(stringBuffer, FALSE));
-
-//        warning("process '%s-%u': unable to open file '%s', error was: %s",
-//                _process_getPluginName(proc), proc->processID, pathStr, g_strerror(errno));
     }
     g_free(pathStr);
+    *streamOut = stream;
     return f;
 }
 
@@ -710,7 +848,7 @@ static FILE* _process_getIOFile(Process* proc, gint fd){
 
     if(fd == STDOUT_FILENO) {
         if(!proc->stdoutFile) {
-            proc->stdoutFile = _process_openFile(proc, "stdout");
+            proc->stdoutFile = _process_openFile(proc, "stdout", STDOUT_FILENO, &proc->stdoutStream);
             if(!proc->stdoutFile) {
                 /* if we log as normal, glib will freak out about recursion if the plugin was trying to log with glib */
                 if(!proc->cachedWarningMessages) {
@@ -728,7 +866,7 @@ static FILE* _process_getIOFile(Process* proc, gint fd){
         return proc->stdoutFile;
     } else {
         if(!proc->stderrFile) {
-            proc->stderrFile = _process_openFile(proc, "stderr");
+            proc->stderrFile = _process_openFile(proc, "stderr", STDERR_FILENO, &proc->stderrStream);
             if(!proc->stderrFile) {
                 /* if we log as normal, glib will freak out about recursion if the plugin was trying to log with glib */
                 if(!proc->cachedWarningMessages) {
@@ -755,38 +893,20 @@ static void _process_handleTimerResult(Process* proc, gdouble elapsedTimeSec) {
 }
 
 static gint _process_getArguments(Process* proc, gchar** argvOut[]) {
-    gchar* threadBuffer;
-
-    GQueue *arguments = g_queue_new();
-
-    /* first argument is the name of the program */
-    const gchar* pluginName = _process_getPluginName(proc);
-    g_queue_push_tail(arguments, g_strdup(pluginName));
-
-    /* parse the full argument string into separate strings */
-    if(proc->arguments && proc->arguments->len > 0 && g_ascii_strncasecmp(proc->arguments->str, "\0", (gsize) 1) != 0) {
-        gchar* argumentString = g_strdup(proc->arguments->str);
-        gchar* token = strtok_r(argumentString, " ", &threadBuffer);
-        while(token != NULL) {
-            gchar* argument = g_strdup((const gchar*) token);
-            g_queue_push_tail(arguments, argument);
-            token = strtok_r(NULL, " ", &threadBuffer);
-        }
-        g_free(argumentString);
-    }
+    /* the plugin may modify its argv, so each process gets its own copy of the words */
+    gint nWords = proc->argumentWords ? (gint)g_strv_length((gchar**)proc->argumentWords) : 0;
 
     /* setup for creating new plug-in, i.e. format into argc and argv */
-    gint argc = g_queue_get_length(arguments);
+    gint argc = nWords + 1;
     /* a pointer to an array that holds pointers */
     gchar** argv = g_new0(gchar*, argc);
 
-    for(gint i = 0; i < argc; i++) {
-        argv[i] = g_queue_pop_head(arguments);
+    /* first argument is the name of the program */
+    argv[0] = g_strdup(_process_getPluginName(proc));
+    for(gint i = 0; i < nWords; i++) {
+        argv[i+1] = g_strdup(proc->argumentWords[i]);
     }
 
-    /* cleanup */
-    g_queue_free(arguments);
-
     /* transfer to the caller - they must free argv and each element of it */
     *argvOut = argv;
     return argc;
@@ -917,16 +1037,8 @@ static void _process_executeCleanup(Process* proc) {
     }
 
     /* flush program output */
-    if(proc->stdoutFile) {
-        fflush(proc->stdoutFile);
-        fclose(proc->stdoutFile);
-        proc->stdoutFile = NULL;
-    }
-    if(proc->stderrFile) {
-        fflush(proc->stderrFile);
-        fclose(proc->stderrFile);
-        proc->stderrFile = NULL;
-    }
+    _process_closeIOFile(proc, STDOUT_FILENO);
+    _process_closeIOFile(proc, STDERR_FILENO);
 
     if(proc->argv) {
         /* free the arguments */
@@ -1171,7 +1283,7 @@ static void _process_start(Process* proc) {
         proc->tstate = NULL;
 
         /* free our copy of plug-in resources, and other application state */
-        //_process_unloadPlugin(proc); XXX TODO this should be done once elf-loader supports unloading libs
+        _process_releasePlugin(proc);
         utility_assert(!process_isRunning(proc));
 
         message("process '%s' has completed or is otherwise no longer running", _process_getName(proc));
@@ -1267,7 +1379,7 @@ void process_continue(Process* proc) {
         utility_assert(nThreads == 1);
 
         /* free our copy of plug-in resources, and other application state */
-        //_process_unloadPlugin(proc); XXX TODO this should be done once elf-loader supports unloading libs
+        _process_releasePlugin(proc);
         utility_assert(!process_isRunning(proc));
 
         info("process '%s' has completed or is otherwise no longer running", _process_getName(proc));
@@ -1320,7 +1432,7 @@ void process_stop(Process* proc) {
     worker_setActiveProcess(NULL);
 
     /* free our copy of plug-in resources, and other application state */
-    //_process_unloadPlugin(proc); XXX TODO this should be done once elf-loader supports unloading libs
+    _process_releasePlugin(proc);
 }
 
 static void _process_runStartTask(Process* proc, gpointer nothing) {
@@ -1531,6 +1643,144 @@ static gssize _process_emu_recvHelper(Process* proc, gint fd, gpointer buf, size
     return (gssize) bytes;
 }
 
+static gsize _process_getMessageLength(const struct msghdr* message) {
+    gsize length = 0;
+    for(size_t i = 0; i < message->msg_iovlen; i++) {
+        length += message->msg_iov[i].iov_len;
+    }
+    return length;
+}
+
+/* returns a contiguous view of the message data. a message with a single
+ * iovec, which is the common case, is used in place without copying; the
+ * caller must g_free the result only if it differs from that iovec base. */
+static gpointer _process_gatherMessage(const struct msghdr* message, gsize* length) {
+    if(message->msg_iovlen == 1) {
+        *length = message->msg_iov[0].iov_len;
+        return message->msg_iov[0].iov_base;
+    }
+
+    *length = _process_getMessageLength(message);
+    guchar* buffer = g_malloc(MAX(*length, 1));
+    gsize offset = 0;
+    for(size_t i = 0; i < message->msg_iovlen; i++) {
+        memcpy(buffer + offset, message->msg_iov[i].iov_base, message->msg_iov[i].iov_len);
+        offset += message->msg_iov[i].iov_len;
+    }
+    return buffer;
+}
+
+static void _process_scatterMessage(struct msghdr* message, gconstpointer buffer, gsize length) {
+    const guchar* data = buffer;
+    gsize offset = 0;
+    for(size_t i = 0; i < message->msg_iovlen && offset < length; i++) {
+        gsize copyLength = MIN(length - offset, message->msg_iov[i].iov_len);
+        memcpy(message->msg_iov[i].iov_base, data + offset, copyLength);
+        offset += copyLength;
+    }
+}
+
+static void _process_releaseMessage(const struct msghdr* message, gpointer buffer) {
+    if(message->msg_iovlen != 1) {
+        g_free(buffer);
+    }
+}
+
+static void _process_setMessageAddress(struct msghdr* message, in_addr_t ip, in_port_t port) {
+    if(message->msg_name != NULL && message->msg_namelen >= sizeof(struct sockaddr_in)) {
+        struct sockaddr_in* si = (struct sockaddr_in*) message->msg_name;
+        si->sin_addr.s_addr = ip;
+        si->sin_port = port;
+        si->sin_family = AF_INET;
+        message->msg_namelen = sizeof(struct sockaddr_in);
+    }
+    /* we never return ancillary data or truncation flags */
+    message->msg_controllen = 0;
+    message->msg_flags = 0;
+}
+
+/* returns the number of messages sent. like the kernel, we only report an
+ * error if there were none, in which case error is set to the errno value. */
+static guint _process_emu_sendmmsgHelper(Process* proc, gint fd, struct mmsghdr* msgvec, guint vlen, gint flags, gint* error) {
+    /* this function MUST be called after switching in shadow context */
+    utility_assert(proc->activeContext == PCTX_SHADOW);
+
+    /* TODO flags are ignored */
+    if(!host_isShadowDescriptor(proc->host, fd)){
+        *error = EBADF;
+        return 0;
+    }
+
+    TransportMessage* messages = g_new0(TransportMessage, vlen);
+    for(guint i = 0; i < vlen; i++) {
+        const struct msghdr* message = &msgvec[i].msg_hdr;
+        messages[i].buffer = _process_gatherMessage(message, &messages[i].nBytes);
+        if(message->msg_name != NULL && message->msg_namelen >= sizeof(struct sockaddr_in)) {
+            struct sockaddr_in* si = (struct sockaddr_in*) message->msg_name;
+            messages[i].ip = si->sin_addr.s_addr;
+            messages[i].port = si->sin_port;
+        }
+    }
+
+    guint numSent = 0;
+    gint result = host_sendUserMessages(proc->host, fd, messages, vlen, &numSent);
+
+    for(guint i = 0; i < vlen; i++) {
+        if(i < numSent) {
+            msgvec[i].msg_len = (unsigned int) messages[i].bytesCopied;
+        }
+        _process_releaseMessage(&msgvec[i].msg_hdr, messages[i].buffer);
+    }
+    g_free(messages);
+
+    *error = (numSent == 0) ? result : 0;
+    return numSent;
+}
+
+/* returns the number of messages received. like the kernel, we only report an
+ * error if there were none, in which case error is set to the errno value. */
+static guint _process_emu_recvmmsgHelper(Process* proc, gint fd, struct mmsghdr* msgvec, guint vlen, gint flags, gint* error) {
+    /* this function MUST be called after switching in shadow context */
+    utility_assert(proc->activeContext == PCTX_SHADOW);
+
+    /* TODO flags are ignored */
+    if(!host_isShadowDescriptor(proc->host, fd)){
+        *error = EBADF;
+        return 0;
+    }
+
+    TransportMessage* messages = g_new0(TransportMessage, vlen);
+    for(guint i = 0; i < vlen; i++) {
+        struct msghdr* message = &msgvec[i].msg_hdr;
+        if(message->msg_iovlen == 1) {
+            messages[i].buffer = message->msg_iov[0].iov_base;
+            messages[i].nBytes = message->msg_iov[0].iov_len;
+        } else {
+            messages[i].nBytes = _process_getMessageLength(message);
+            messages[i].buffer = g_malloc(MAX(messages[i].nBytes, 1));
+        }
+    }
+
+    guint numReceived = 0;
+    gint result = host_receiveUserMessages(proc->host, fd, messages, vlen, &numReceived);
+
+    for(guint i = 0; i < vlen; i++) {
+        struct msghdr* message = &msgvec[i].msg_hdr;
+        if(i < numReceived) {
+            if(message->msg_iovlen != 1) {
+                _process_scatterMessage(message, messages[i].buffer, messages[i].bytesCopied);
+            }
+            _process_setMessageAddress(message, messages[i].ip, messages[i].port);
+            msgvec[i].msg_len = (unsigned int) messages[i].bytesCopied;
+        }
+        _process_releaseMessage(message, messages[i].buffer);
+    }
+    g_free(messages);
+
+    *error = (numReceived == 0) ? result : 0;
+    return numReceived;
+}
+
 static gint _process_emu_fcntlHelper(Process* proc, int fd, int cmd, void* argp) {
     /* check if this is a socket */
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
@@ -1540,6 +1790,11 @@ static gint _process_emu_fcntlHelper(Process* proc, int fd, int cmd, void* argp)
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
         if(osfd >= 0) {
+            if(cmd == F_SETFL) {
+                /* buffered writes must land with the flags they were made
+                 * with, e.g. before O_APPEND or O_DIRECT is turned on */
+                host_fileFlagsChanged(proc->host, osfd);
+            }
             ret = fcntl(osfd, cmd, argp);
             if(ret < 0) {
                 _process_setErrno(proc, errno);
@@ -1982,6 +2237,7 @@ void* process_emu_mmap(Process* proc, void *addr, size_t length, int prot, int f
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             gpointer ret = mmap(addr, length, prot, flags, osfd, offset);
             if(ret == MAP_FAILED) {
@@ -2277,12 +2533,69 @@ ssize_t process_emu_sendto(Process* proc, int fd, const void *buf, size_t n, int
 }
 
 ssize_t process_emu_sendmsg(Process* proc, int fd, const struct msghdr *message, int flags) {
-    /* TODO implement */
+    if(message == NULL) {
+        ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+        _process_setErrno(proc, EFAULT);
+        _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+        return -1;
+    }
+
+    struct mmsghdr mmsg = {.msg_hdr = *message, .msg_len = 0};
+    int ret = process_emu_sendmmsg(proc, fd, &mmsg, 1, flags);
+    return (ret == 1) ? (ssize_t) mmsg.msg_len : -1;
+}
+
+int process_emu_sendmmsg(Process* proc, int fd, struct mmsghdr *msgvec, unsigned int vlen, int flags) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
-    warning("sendmsg not implemented");
-    _process_setErrno(proc, ENOSYS);
+    gint ret = 0;
+    guint numSent = 0;
+
+    /* the kernel silently caps the batch size too */
+    vlen = MIN(vlen, IOV_MAX);
+
+    if(msgvec == NULL) {
+        _process_setErrno(proc, EFAULT);
+        ret = -1;
+    } else if(vlen > 0 && prevCTX == PCTX_PLUGIN) {
+        /* the first message goes through pth so that a blocking socket waits
+         * for buffer space; the rest of the batch never blocks */
+        gsize length = 0;
+        gpointer buffer = _process_gatherMessage(&msgvec[0].msg_hdr, &length);
+
+        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+        utility_assert(proc->tstate == pth_gctx_get());
+        gssize n = pth_sendto(fd, buffer, length, flags,
+                msgvec[0].msg_hdr.msg_name, msgvec[0].msg_hdr.msg_namelen);
+        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+
+        _process_releaseMessage(&msgvec[0].msg_hdr, buffer);
+
+        if(n == -1) {
+            _process_setErrno(proc, errno);
+            ret = -1;
+        } else {
+            msgvec[0].msg_len = (unsigned int) n;
+            numSent = 1;
+        }
+    }
+
+    if(ret == 0 && numSent < vlen) {
+        /* if some messages were sent, the error is left for the next call to
+         * report, as sendmmsg does, and errno is not touched */
+        gint error = 0;
+        numSent += _process_emu_sendmmsgHelper(proc, fd, &msgvec[numSent], vlen - numSent, flags, &error);
+        if(numSent == 0 && error != 0) {
+            _process_setErrno(proc, error);
+            ret = -1;
+        }
+    }
+
+    if(ret == 0) {
+        ret = (gint) numSent;
+    }
+
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-    return -1;
+    return ret;
 }
 
 ssize_t process_emu_recv(Process* proc, int fd, void *buf, size_t n, int flags) {
@@ -2322,12 +2635,83 @@ ssize_t process_emu_recvfrom(Process* proc, int fd, void *buf, size_t n, int fla
 }
 
 ssize_t process_emu_recvmsg(Process* proc, int fd, struct msghdr *message, int flags) {
-    /* TODO implement */
+    if(message == NULL) {
+        ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+        _process_setErrno(proc, EFAULT);
+        _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+        return -1;
+    }
+
+    struct mmsghdr mmsg = {.msg_hdr = *message, .msg_len = 0};
+    int ret = process_emu_recvmmsg(proc, fd, &mmsg, 1, flags, NULL);
+    if(ret != 1) {
+        return -1;
+    }
+
+    /* the address length and flags are outputs */
+    *message = mmsg.msg_hdr;
+    return (ssize_t) mmsg.msg_len;
+}
+
+int process_emu_recvmmsg(Process* proc, int fd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
-    warning("recvmsg not implemented");
-    _process_setErrno(proc, ENOSYS);
+    gint ret = 0;
+    guint numReceived = 0;
+
+    /* the kernel silently caps the batch size too */
+    vlen = MIN(vlen, IOV_MAX);
+
+    /* we only ever wait for the first message (as with MSG_WAITFORONE) and
+     * return whatever else is already buffered, so the timeout never applies */
+    if(msgvec == NULL) {
+        _process_setErrno(proc, EFAULT);
+        ret = -1;
+    } else if(vlen > 0 && prevCTX == PCTX_PLUGIN) {
+        /* the first message goes through pth so that a blocking socket waits
+         * for data; the rest of the batch never blocks */
+        struct msghdr* message = &msgvec[0].msg_hdr;
+        gsize length = _process_getMessageLength(message);
+        gpointer buffer = (message->msg_iovlen == 1) ? message->msg_iov[0].iov_base : g_malloc(MAX(length, 1));
+        struct sockaddr_in address = {0};
+        socklen_t addressLength = sizeof(address);
+
+        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+        utility_assert(proc->tstate == pth_gctx_get());
+        gssize n = pth_recvfrom(fd, buffer, length, flags, (struct sockaddr*) &address, &addressLength);
+        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+
+        if(n == -1) {
+            _process_setErrno(proc, errno);
+            ret = -1;
+        } else {
+            if(message->msg_iovlen != 1) {
+                _process_scatterMessage(message, buffer, (gsize) n);
+            }
+            _process_setMessageAddress(message, address.sin_addr.s_addr, address.sin_port);
+            msgvec[0].msg_len = (unsigned int) n;
+            numReceived = 1;
+        }
+
+        _process_releaseMessage(message, buffer);
+    }
+
+    if(ret == 0 && numReceived < vlen) {
+        /* if some messages were received, the error is left for the next call
+         * to report, as recvmmsg does, and errno is not touched */
+        gint error = 0;
+        numReceived += _process_emu_recvmmsgHelper(proc, fd, &msgvec[numReceived], vlen - numReceived, flags, &error);
+        if(numReceived == 0 && error != 0) {
+            _process_setErrno(proc, error);
+            ret = -1;
+        }
+    }
+
+    if(ret == 0) {
+        ret = (gint) numReceived;
+    }
+
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-    return -1;
+    return ret;
 }
 
 int process_emu_getsockopt(Process* proc, int fd, int level, int optname, void* optval, socklen_t* optlen) {
@@ -2678,6 +3062,7 @@ ssize_t process_emu_read(Process* proc, int fd, void *buff, size_t numbytes) {
             ret = (ssize_t) numbytes;
         } else {
             gint osfd = host_getOSHandle(proc->host, fd);
+            host_flushFileWritesTo(proc->host, osfd);
             if(osfd >= 0) {
                 ret = read(osfd, buff, numbytes);
                 if(ret < 0) {
@@ -2722,14 +3107,12 @@ ssize_t process_emu_write(Process* proc, int fd, const void *buff, size_t n) {
         if(host_isShadowDescriptor(proc->host, fd)){
             ret = _process_emu_sendHelper(proc, fd, buff, n, 0, NULL, 0);
         } else {
-            gint osfd = host_getOSHandle(proc->host, fd);
-            if(osfd >= 0) {
-                ret = write(osfd, buff, n);
-                if(ret < 0) {
-                    _process_setErrno(proc, errno);
-                }
+            gsize bytesWritten = 0;
+            gint result = host_writeFile(proc->host, fd, buff, n, &bytesWritten);
+            if(result == 0) {
+                ret = (gssize) bytesWritten;
             } else {
-                _process_setErrno(proc, EBADF);
+                _process_setErrno(proc, result);
                 ret = -1;
             }
         }
@@ -2745,6 +3128,7 @@ ssize_t process_emu_readv(Process* proc, int fd, const struct iovec *iov, int io
 
     if(!host_isShadowDescriptor(proc->host, fd)){
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             ret = readv(osfd, iov, iovcnt);
             if(ret < 0) {
@@ -2810,6 +3194,7 @@ ssize_t process_emu_writev(Process* proc, int fd, const struct iovec *iov, int i
 
     if(!host_isShadowDescriptor(proc->host, fd)){
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             ret = writev(osfd, iov, iovcnt);
             if(ret < 0) {
@@ -2889,6 +3274,7 @@ ssize_t process_emu_pread(Process* proc, int fd, void *buff, size_t numbytes, of
             ret = -1;
         } else {
             gint osfd = host_getOSHandle(proc->host, fd);
+            host_flushFileWritesTo(proc->host, osfd);
             if(osfd >= 0) {
                 ret = pread(osfd, buff, numbytes, offset);
                 if(ret < 0) {
@@ -2927,6 +3313,7 @@ ssize_t process_emu_pwrite(Process* proc, int fd, const void *buf, size_t nbytes
             ret = -1;
         } else {
             gint osfd = host_getOSHandle(proc->host, fd);
+            host_flushFileWritesTo(proc->host, osfd);
             if(osfd >= 0) {
                 ret = pwrite(fd, buf, nbytes, offset);
                 if(ret < 0) {
@@ -2951,19 +3338,11 @@ int process_emu_close(Process* proc, int fd) {
         gint ret = 0;
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
-        if(osfd == STDOUT_FILENO) {
-            if(proc->stdoutFile) {
-                ret = fclose(proc->stdoutFile);
-                if(ret == EOF) {
-                    _process_setErrno(proc, errno);
-                }
-            }
-        } else if (osfd == STDERR_FILENO) {
-            if(proc->stderrFile) {
-                ret = fclose(proc->stderrFile);
-                if(ret == EOF) {
-                    _process_setErrno(proc, errno);
-                }
+        host_flushFileWritesTo(proc->host, osfd);
+        if(osfd == STDOUT_FILENO || osfd == STDERR_FILENO) {
+            ret = _process_closeIOFile(proc, osfd);
+            if(ret == EOF) {
+                _process_setErrno(proc, errno);
             }
         } else if(osfd >= 0) {
             ret = close(osfd);
@@ -3433,6 +3812,8 @@ int process_emu_open(Process* proc, const char *pathname, int flags, mode_t mode
         result = -1;
         _process_setErrno(proc, EEXIST);
     } else {
+        /* the file may be one we still have buffered writes for */
+        host_flushFileWrites(proc->host);
         gint osfd = open(pathname, flags, mode);
         if(osfd == -1) {
             _process_setErrno(proc, errno);
@@ -3457,6 +3838,7 @@ int process_emu_open64(Process* proc, const char *pathname, int flags, mode_t mo
 int process_emu_creat(Process* proc, const char *pathname, mode_t mode) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
 
+    host_flushFileWrites(proc->host);
     gint osfd = creat(pathname, mode);
     if(osfd == -1) {
         _process_setErrno(proc, errno);
@@ -3475,6 +3857,7 @@ FILE *process_emu_fopen(Process* proc, const char *path, const char *mode) {
         /* return error, glib will use UTC time */
         _process_setErrno(proc, EEXIST);
     } else {
+        host_flushFileWrites(proc->host);
         osfile = fopen(path, mode);
         if(osfile == NULL) {
             _process_setErrno(proc, errno);
@@ -3544,6 +3927,7 @@ FILE *process_emu_fdopen(Process* proc, int fd, const char *mode) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             FILE* osfile = fdopen(osfd, mode);
             if(osfile == NULL) {
@@ -3568,6 +3952,7 @@ int process_emu_dup(Process* proc, int oldfd) {
     } else {
         /* check if we have a mapped os fd */
         gint osfdOld = host_getOSHandle(proc->host, oldfd);
+        host_flushFileWritesTo(proc->host, osfdOld);
         if (osfdOld >= 0) {
             gint osfd = dup(osfdOld);
             if(osfd == -1) {
@@ -3594,6 +3979,8 @@ int process_emu_dup2(Process* proc, int oldfd, int newfd) {
         /* check if we have mapped os fds */
         gint osfdOld = host_getOSHandle(proc->host, oldfd);
         gint osfdNew = host_getOSHandle(proc->host, newfd);
+        host_flushFileWritesTo(proc->host, osfdOld);
+        host_flushFileWritesTo(proc->host, osfdNew);
 
         /* if the newfd is not mapped, then we need to map it later */
         gboolean isMapped = osfdNew >= 3 ? TRUE : FALSE;
@@ -3632,6 +4019,8 @@ int process_emu_dup3(Process* proc, int oldfd, int newfd, int flags) {
         /* check if we have mapped os fds */
         gint osfdOld = host_getOSHandle(proc->host, oldfd);
         gint osfdNew = host_getOSHandle(proc->host, newfd);
+        host_flushFileWritesTo(proc->host, osfdOld);
+        host_flushFileWritesTo(proc->host, osfdNew);
 
         /* if the newfd is not mapped, then we need to map it later */
         gboolean isMapped = osfdNew >= 3 ? TRUE : FALSE;
@@ -3662,6 +4051,9 @@ int process_emu_fclose(Process* proc, FILE *fp) {
     gint osfd = fileno(fp);
     gint shadowHandle = osfd >= 0 ? host_getShadowHandle(proc->host, osfd) : -1;
 
+    /* raw writes to the stream's descriptor may still be buffered */
+    host_flushFileWritesTo(proc->host, osfd);
+
     gint ret = fclose(fp);
     if(ret == EOF) {
         _process_setErrno(proc, errno);
@@ -3678,6 +4070,7 @@ int process_emu_fclose(Process* proc, FILE *fp) {
 int process_emu_fseek(Process* proc, FILE *stream, long offset, int whence) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
 
+    host_flushFileWritesTo(proc->host, fileno(stream));
     int ret = fseek(stream, offset, whence);
 
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
@@ -3687,6 +4080,7 @@ int process_emu_fseek(Process* proc, FILE *stream, long offset, int whence) {
 long process_emu_ftell(Process* proc, FILE *stream) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
 
+    host_flushFileWritesTo(proc->host, fileno(stream));
     long ret = ftell(stream);
 
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
@@ -3696,6 +4090,7 @@ long process_emu_ftell(Process* proc, FILE *stream) {
 void process_emu_rewind(Process* proc, FILE *stream) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
 
+    host_flushFileWritesTo(proc->host, fileno(stream));
     rewind(stream);
 
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
@@ -3704,6 +4099,7 @@ void process_emu_rewind(Process* proc, FILE *stream) {
 int process_emu_fgetpos(Process* proc, FILE *stream, fpos_t *pos) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
 
+    host_flushFileWritesTo(proc->host, fileno(stream));
     int ret = fgetpos(stream, pos);
 
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
@@ -3713,6 +4109,7 @@ int process_emu_fgetpos(Process* proc, FILE *stream, fpos_t *pos) {
 int process_emu_fsetpos(Process* proc, FILE *stream, const fpos_t *pos) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
 
+    host_flushFileWritesTo(proc->host, fileno(stream));
     int ret = fsetpos(stream, pos);
 
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
@@ -3728,6 +4125,7 @@ int process_emu___fxstat (Process* proc, int ver, int fd, struct stat *buf) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             gint ret = fstat(osfd, buf);
             if(ret == -1) {
@@ -3753,6 +4151,7 @@ int process_emu___fxstat64 (Process* proc, int ver, int fd, struct stat64 *buf)
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             gint ret = fstat64(osfd, buf);
             if(ret == -1) {
@@ -3769,6 +4168,55 @@ int process_emu___fxstat64 (Process* proc, int ver, int fd, struct stat64 *buf)
     return -1;
 }
 
+/* stat redirects to this. the path may be a file we still have buffered
+ * writes for, whose size and times would be stale otherwise. */
+int process_emu___xstat (Process* proc, int ver, const char *path, struct stat *buf) {
+    ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+    host_flushFileWritesToPath(proc->host, path, TRUE);
+    gint ret = stat(path, buf);
+    if(ret == -1) {
+        _process_setErrno(proc, errno);
+    }
+    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+    return ret;
+}
+
+/* stat64 redirects to this */
+int process_emu___xstat64 (Process* proc, int ver, const char *path, struct stat64 *buf) {
+    ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+    host_flushFileWritesToPath(proc->host, path, TRUE);
+    gint ret = stat64(path, buf);
+    if(ret == -1) {
+        _process_setErrno(proc, errno);
+    }
+    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+    return ret;
+}
+
+/* lstat redirects to this */
+int process_emu___lxstat (Process* proc, int ver, const char *path, struct stat *buf) {
+    ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+    host_flushFileWritesToPath(proc->host, path, FALSE);
+    gint ret = lstat(path, buf);
+    if(ret == -1) {
+        _process_setErrno(proc, errno);
+    }
+    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+    return ret;
+}
+
+/* lstat64 redirects to this */
+int process_emu___lxstat64 (Process* proc, int ver, const char *path, struct stat64 *buf) {
+    ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+    host_flushFileWritesToPath(proc->host, path, FALSE);
+    gint ret = lstat64(path, buf);
+    if(ret == -1) {
+        _process_setErrno(proc, errno);
+    }
+    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+    return ret;
+}
+
 int process_emu_fstatfs (Process* proc, int fd, struct statfs *buf) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
 
@@ -3825,6 +4273,7 @@ off_t process_emu_lseek(Process* proc, int fd, off_t offset, int whence) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             off_t ret = lseek(osfd, offset, whence);
             if(ret == -1) {
@@ -3849,6 +4298,7 @@ off64_t process_emu_lseek64(Process* proc, int fd, off64_t offset, int whence) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             off_t ret = lseek64(osfd, offset, whence);
             if(ret == -1) {
@@ -3895,9 +4345,11 @@ int process_emu_fsync(Process* proc, int fd) {
 
     if(prevCTX == PCTX_PLUGIN && (fd == STDOUT_FILENO || fd == STDERR_FILENO)) {
         FILE* f = _process_getIOFile(proc, fd);
-        ret = fsync(fileno(f));
-        if(ret == -1) {
-            _process_setErrno(proc, errno);
+        OutputStream* stream = (fd == STDOUT_FILENO) ? proc->stdoutStream : proc->stderrStream;
+        gint error = stream ? outputstream_sync(stream) : (fsync(fileno(f)) == 0 ? 0 : errno);
+        if(error != 0) {
+            _process_setErrno(proc, error);
+            ret = -1;
         }
     } else if (host_isShadowDescriptor(proc->host, fd)) {
         warning("fsync not implemented for Shadow descriptor types");
@@ -3906,6 +4358,7 @@ int process_emu_fsync(Process* proc, int fd) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             ret = fsync(osfd);
             if(ret == -1) {
@@ -3929,6 +4382,7 @@ int process_emu_ftruncate(Process* proc, int fd, off_t length) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             gint ret = ftruncate(osfd, length);
             if(ret == -1) {
@@ -3953,6 +4407,7 @@ int process_emu_ftruncate64(Process* proc, int fd, off64_t length) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             gint ret = ftruncate64(osfd, length);
             if(ret == -1) {
@@ -3977,6 +4432,7 @@ int process_emu_posix_fallocate(Process* proc, int fd, off_t offset, off_t len)
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if (osfd >= 0) {
             gint ret = posix_fallocate(osfd, offset, len);
             _process_changeContext(proc, PCTX_SHADOW, prevCTX);
@@ -4024,6 +4480,7 @@ int process_emu_fdatasync(Process* proc, int fd) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if(osfd < 0) {
             _process_setErrno(proc, EBADF);
             ret = -1;
@@ -4048,6 +4505,7 @@ int process_emu_syncfs(Process* proc, int fd) {
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWrites(proc->host);
         if(osfd < 0) {
             _process_setErrno(proc, EBADF);
             ret = -1;
@@ -4072,6 +4530,7 @@ int process_emu_fallocate(Process* proc, int fd, int mode, off_t offset, off_t l
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if(osfd < 0) {
             _process_setErrno(proc, EBADF);
             ret = -1;
@@ -4096,6 +4555,7 @@ int process_emu_fexecve(Process* proc, int fd, char *const argv[], char *const e
     } else {
         /* check if we have a mapped os fd */
         gint osfd = host_getOSHandle(proc->host, fd);
+        host_flushFileWritesTo(proc->host, osfd);
         if(osfd < 0) {
             _process_setErrno(proc, EBADF);
             ret = -1;
@@ -4327,6 +4787,7 @@ size_t process_emu_fread(Process* proc, void *ptr, size_t size, size_t nmemb, FI
                 } else {
                     /* shadow knows about the file, but it is an os-backed file and
                      * osfd is the actual thing we should read from */
+                    host_flushFileWritesTo(proc->host, osfd);
                     ret = fread(ptr, size, nmemb, stream);
                 }
             } else {
@@ -4354,6 +4815,8 @@ size_t process_emu_fwrite(Process* proc, const void *ptr, size_t size, size_t nm
     if(prevCTX == PCTX_PLUGIN && (fd == STDOUT_FILENO || fd == STDERR_FILENO)) {
         ret = fwrite(ptr, size, nmemb, _process_getIOFile(proc, fd));
     } else {
+        /* the stream must not overtake write() calls buffered for its descriptor */
+        host_flushFileWritesTo(proc->host, fd);
         ret = fwrite(ptr, size, nmemb, stream);
     }
 
@@ -4369,6 +4832,7 @@ int process_emu_fputc(Process* proc, int c, FILE *stream) {
     if(prevCTX == PCTX_PLUGIN && (fd == STDOUT_FILENO || fd == STDERR_FILENO)) {
         ret = fputc(c, _process_getIOFile(proc, fd));
     } else {
+        host_flushFileWritesTo(proc->host, fd);
         ret = fputc(c, stream);
     }
 
@@ -4388,6 +4852,7 @@ int process_emu_fputs(Process* proc, const char *s, FILE *stream) {
     if(prevCTX == PCTX_PLUGIN && (fd == STDOUT_FILENO || fd == STDERR_FILENO)) {
         ret = fputs(s, _process_getIOFile(proc, fd));
     } else {
+        host_flushFileWritesTo(proc->host, fd);
         ret = fputs(s, stream);
     }
 
@@ -4453,6 +4918,7 @@ int process_emu_vfprintf(Process* proc, FILE *stream, const char *format, va_lis
     if(prevCTX == PCTX_PLUGIN && (fd == STDOUT_FILENO || fd == STDERR_FILENO)) {
         ret = g_vfprintf(_process_getIOFile(proc, fd), format, ap);
     } else {
+        host_flushFileWritesTo(proc->host, fd);
         ret = g_vfprintf(stream, format, ap);
     }
 
@@ -4468,6 +4934,7 @@ int process_emu_fflush(Process* proc, FILE *stream) {
     if(prevCTX == PCTX_PLUGIN && (fd == STDOUT_FILENO || fd == STDERR_FILENO)) {
         ret = fflush(_process_getIOFile(proc, fd));
     } else {
+        host_flushFileWritesTo(proc->host, fd);
         ret = fflush(stream);
     }
 
@@ -4997,6 +5464,35 @@ int process_emu_syscall(Process* proc, int number, va_list ap) {
 		}
 #endif
 
+#if defined SYS_sendmmsg
+        case SYS_sendmmsg: {
+            int fd = va_arg(args, int);
+            struct mmsghdr* msgvec = va_arg(args, struct mmsghdr*);
+            unsigned int vlen = va_arg(args, unsigned int);
+            int flags = va_arg(args, int);
+
+            _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+            ret = process_emu_sendmmsg(proc, fd, msgvec, vlen, flags);
+            _process_changeContext(proc, prevCTX, PCTX_SHADOW);
+            break;
+        }
+#endif
+
+#if defined SYS_recvmmsg
+        case SYS_recvmmsg: {
+            int fd = va_arg(args, int);
+            struct mmsghdr* msgvec = va_arg(args, struct mmsghdr*);
+            unsigned int vlen = va_arg(args, unsigned int);
+            int flags = va_arg(args, int);
+            struct timespec* timeout = va_arg(args, struct timespec*);
+
+            _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+            ret = process_emu_recvmmsg(proc, fd, msgvec, vlen, flags, timeout);
+            _process_changeContext(proc, prevCTX, PCTX_SHADOW);
+            break;
+        }
+#endif
+
 #if defined SYS_gettid
         /* thread ids need to be unique for every thread, and unique from the pid */
         case SYS_gettid: {
@@ -6106,6 +6602,12 @@ int process_emu_pthread_join(Process* proc, pthread_t thread, void **value_ptr)
 }
 
 int process_emu_pthread_once(Process* proc, pthread_once_t *once_control, void (*init_routine)(void)) {
+    /* after the first call, there is nothing left to do */
+    if(proc->activeContext == PCTX_PLUGIN && once_control != NULL && init_routine != NULL &&
+            *once_control == 1) {
+        return 0;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if(prevCTX == PCTX_PLUGIN) {
@@ -6739,6 +7241,50 @@ int process_emu_pthread_mutexattr_gettype(Process* proc, const pthread_mutexattr
 
 /* pthread mutex */
 
+/* pth mutexes and condition variables fit into the pthread objects of the
+ * plugin, so we keep them inline instead of allocating them. An uncontended
+ * lock or unlock then only updates the owner fields of the inline pth mutex,
+ * which never switches threads, so we do that without leaving the plugin
+ * context and only go through pth when a thread would actually block. */
+G_STATIC_ASSERT(sizeof(pth_mutex_t) <= sizeof(pthread_mutex_t));
+G_STATIC_ASSERT(sizeof(pth_cond_t) <= sizeof(pthread_cond_t));
+
+/* returns TRUE if the mutex holds one of glibc's static initializers. they store
+ * the mutex kind where pth keeps its state, so we must not read them as pth state. */
+static gboolean _process_isStaticMutexInitializer(const pthread_mutex_t* mutex) {
+    static const pthread_mutex_t initializers[] = {
+        PTHREAD_MUTEX_INITIALIZER,
+        PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP,
+        PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP,
+        PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP,
+    };
+    for(gsize i = 0; i < G_N_ELEMENTS(initializers); i++) {
+        if(memcmp(mutex, &initializers[i], sizeof(pthread_mutex_t)) == 0) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static pth_mutex_t* _process_getPthMutex(pthread_mutex_t* mutex) {
+    pth_mutex_t* pm = (pth_mutex_t*)mutex;
+    /* a mutex that pth holds always has an owner, so we only compare the unowned
+     * ones against the initializers. an unlocked pth mutex may look just like
+     * one of them, but initializing it again does not change it. */
+    if(pm->mx_owner == NULL && _process_isStaticMutexInitializer(mutex)) {
+        pth_mutex_init(pm);
+    }
+    return pm;
+}
+
+static pth_cond_t* _process_getPthCond(pthread_cond_t* cond) {
+    pth_cond_t* pcn = (pth_cond_t*)cond;
+    if(!(pcn->cn_state & PTH_COND_INITIALIZED)) {
+        pth_cond_init(pcn);
+    }
+    return pcn;
+}
+
 int process_emu_pthread_mutex_init(Process* proc, pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
@@ -6751,18 +7297,9 @@ int process_emu_pthread_mutex_init(Process* proc, pthread_mutex_t *mutex, const
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
         } else {
-            pth_mutex_t* pm = g_malloc(sizeof(pth_mutex_t));
-
-            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-            int result = pth_mutex_init(pm);
-            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-
-            if (!result) {
-                ret = errno;
-            } else {
-                memmove(mutex, &pm, sizeof(void*));
-                ret = 0;
-            }
+            memset(mutex, 0, sizeof(pthread_mutex_t));
+            pth_mutex_init((pth_mutex_t*)mutex);
+            ret = 0;
         }
     } else {
         warning("pthread_mutex_init() is handled by pth but not implemented by shadow");
@@ -6784,17 +7321,12 @@ int process_emu_pthread_mutex_destroy(Process* proc, pthread_mutex_t *mutex) {
         if (mutex == NULL) {
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
+        } else if(_process_getPthMutex(mutex)->mx_state & PTH_MUTEX_LOCKED) {
+            /* the mutex is still linked into the owner's list of held mutexes */
+            ret = EBUSY;
         } else {
-            pth_mutex_t* pm = NULL;
-            memmove(&pm, mutex, sizeof(void*));
-            if(pm == NULL) {
-                _process_setErrno(proc, EINVAL);
-                ret = EINVAL;
-            } else {
-                free(pm);
-                memset(mutex, 0, sizeof(void*));
-                ret = 0;
-            }
+            memset(mutex, 0, sizeof(pthread_mutex_t));
+            ret = 0;
         }
     } else {
         warning(
@@ -6837,6 +7369,12 @@ int process_emu_pthread_mutex_getprioceiling(Process* proc, const pthread_mutex_
 }
 
 int process_emu_pthread_mutex_lock(Process* proc, pthread_mutex_t *mutex) {
+    /* fast path, see _process_getPthMutex */
+    if(proc->activeContext == PCTX_PLUGIN && mutex != NULL &&
+            pth_mutex_acquire(_process_getPthMutex(mutex), TRUE, NULL)) {
+        return 0;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
@@ -6848,27 +7386,14 @@ int process_emu_pthread_mutex_lock(Process* proc, pthread_mutex_t *mutex) {
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
         } else {
-            pth_mutex_t* pm = NULL;
-            memmove(&pm, mutex, sizeof(void*));
-
-            int init_result = 0;
-            if(pm == NULL) {
-                _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                init_result = process_emu_pthread_mutex_init(proc, mutex, NULL);
-                _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-            }
-            memmove(&pm, mutex, sizeof(void*));
-            if(init_result != 0) {
+            /* another thread holds the mutex, so we wait for it in pth */
+            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+            int result = pth_mutex_acquire(_process_getPthMutex(mutex), FALSE, NULL);
+            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+            if(!result) {
                 ret = errno;
             } else {
-                _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                init_result = pth_mutex_acquire(pm, FALSE, NULL);
-                _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-                if(!init_result) {
-                    ret = errno;
-                } else {
-                    ret = 0;
-                }
+                ret = 0;
             }
         }
     } else {
@@ -6881,40 +7406,16 @@ int process_emu_pthread_mutex_lock(Process* proc, pthread_mutex_t *mutex) {
 }
 
 int process_emu_pthread_mutex_trylock(Process* proc, pthread_mutex_t *mutex) {
+    /* trying never blocks, so we never have to leave the plugin context */
+    if(proc->activeContext == PCTX_PLUGIN && mutex != NULL) {
+        return pth_mutex_acquire(_process_getPthMutex(mutex), TRUE, NULL) ? 0 : errno;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
-        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-        utility_assert(proc->tstate == pth_gctx_get());
-        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-
-        if (mutex == NULL) {
-            _process_setErrno(proc, EINVAL);
-            ret = EINVAL;
-        } else {
-            pth_mutex_t* pm = NULL;
-            memmove(&pm, mutex, sizeof(void*));
-
-            int init_result = 0;
-            if(pm == NULL) {
-                _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                init_result = process_emu_pthread_mutex_init(proc, mutex, NULL);
-                _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-            }
-            memmove(&pm, mutex, sizeof(void*));
-            if(init_result != 0) {
-                ret = errno;
-            } else {
-                _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                init_result = pth_mutex_acquire(pm, TRUE, NULL);
-                _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-                if(!init_result) {
-                    ret = errno;
-                } else {
-                    ret = 0;
-                }
-            }
-        }
+        _process_setErrno(proc, EINVAL);
+        ret = EINVAL;
     } else {
         warning("pthread_mutex_trylock() is handled by pth but not implemented by shadow");
         _process_setErrno(proc, ENOSYS);
@@ -6925,40 +7426,16 @@ int process_emu_pthread_mutex_trylock(Process* proc, pthread_mutex_t *mutex) {
 }
 
 int process_emu_pthread_mutex_unlock(Process* proc, pthread_mutex_t *mutex) {
+    /* releasing never blocks, so we never have to leave the plugin context */
+    if(proc->activeContext == PCTX_PLUGIN && mutex != NULL) {
+        return pth_mutex_release(_process_getPthMutex(mutex)) ? 0 : errno;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
-        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-        utility_assert(proc->tstate == pth_gctx_get());
-        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-
-        if (mutex == NULL) {
-            _process_setErrno(proc, EINVAL);
-            ret = EINVAL;
-        } else {
-            pth_mutex_t* pm = NULL;
-            memmove(&pm, mutex, sizeof(void*));
-
-            int init_result = 0;
-            if(pm == NULL) {
-                _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                init_result = process_emu_pthread_mutex_init(proc, mutex, NULL);
-                _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-            }
-            memmove(&pm, mutex, sizeof(void*));
-            if(init_result != 0) {
-                ret = errno;
-            } else {
-                _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                init_result = pth_mutex_release(pm);
-                _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-                if(!init_result) {
-                    ret = errno;
-                } else {
-                    ret = 0;
-                }
-            }
-        }
+        _process_setErrno(proc, EINVAL);
+        ret = EINVAL;
     } else {
         warning("pthread_mutex_unlock() is handled by pth but not implemented by shadow");
         _process_setErrno(proc, ENOSYS);
@@ -7026,6 +7503,24 @@ int process_emu_pthread_rwlockattr_getpshared(Process* proc, const pthread_rwloc
 
 /* pthread locks */
 
+/* pth rwlocks do not fit into the pthread ones, so the plugin's rwlock holds a
+ * pointer to an allocated pth rwlock, or NULL if it was not used yet */
+static pth_rwlock_t* _process_getPthRwlock(pthread_rwlock_t* rwlock) {
+    pth_rwlock_t* prw = NULL;
+    memmove(&prw, rwlock, sizeof(void*));
+    return prw;
+}
+
+/* the uncontended acquisition only updates the inner pth mutexes, which never
+ * switches threads, so we try it without leaving the plugin context */
+static gboolean _process_tryPthRwlockFast(Process* proc, pthread_rwlock_t* rwlock, int op) {
+    if(proc->activeContext != PCTX_PLUGIN || rwlock == NULL) {
+        return FALSE;
+    }
+    pth_rwlock_t* prw = _process_getPthRwlock(rwlock);
+    return (prw != NULL && pth_rwlock_acquire(prw, op, TRUE, NULL)) ? TRUE : FALSE;
+}
+
 int process_emu_pthread_rwlock_init(Process* proc, pthread_rwlock_t *rwlock, const pthread_rwlockattr_t *attr) {
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
@@ -7095,6 +7590,10 @@ int process_emu_pthread_rwlock_destroy(Process* proc, pthread_rwlock_t *rwlock)
 }
 
 int process_emu_pthread_rwlock_rdlock(Process* proc, pthread_rwlock_t *rwlock) {
+    if(_process_tryPthRwlockFast(proc, rwlock, PTH_RWLOCK_RD)) {
+        return 0;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
@@ -7182,6 +7681,10 @@ int process_emu_pthread_rwlock_tryrdlock(Process* proc, pthread_rwlock_t *rwlock
 }
 
 int process_emu_pthread_rwlock_wrlock(Process* proc, pthread_rwlock_t *rwlock) {
+    if(_process_tryPthRwlockFast(proc, rwlock, PTH_RWLOCK_RW)) {
+        return 0;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
@@ -7226,6 +7729,10 @@ int process_emu_pthread_rwlock_wrlock(Process* proc, pthread_rwlock_t *rwlock) {
 }
 
 int process_emu_pthread_rwlock_trywrlock(Process* proc, pthread_rwlock_t *rwlock) {
+    if(_process_tryPthRwlockFast(proc, rwlock, PTH_RWLOCK_RW)) {
+        return 0;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
@@ -7269,6 +7776,15 @@ int process_emu_pthread_rwlock_trywrlock(Process* proc, pthread_rwlock_t *rwlock
 }
 
 int process_emu_pthread_rwlock_unlock(Process* proc, pthread_rwlock_t *rwlock) {
+    /* releasing a read lock briefly takes the inner reader mutex, which only
+     * blocks while a first reader waits for the writer to finish */
+    pth_rwlock_t* fastRwlock = (proc->activeContext == PCTX_PLUGIN && rwlock != NULL) ?
+            _process_getPthRwlock(rwlock) : NULL;
+    if(fastRwlock && (fastRwlock->rw_mode == PTH_RWLOCK_RW ||
+            !(fastRwlock->rw_mutex_rd.mx_state & PTH_MUTEX_LOCKED))) {
+        return pth_rwlock_release(fastRwlock) ? 0 : errno;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
@@ -7389,18 +7905,9 @@ int process_emu_pthread_cond_init(Process* proc, pthread_cond_t *cond, const pth
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
         } else {
-            pth_cond_t *pcn = g_malloc(sizeof(pth_cond_t));
-
-            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-            int result = pth_cond_init(pcn);
-            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-
-            if (!result) {
-                ret = errno;
-            } else {
-                memmove(cond, &pcn, sizeof(void*));
-                ret = 0;
-            }
+            memset(cond, 0, sizeof(pthread_cond_t));
+            pth_cond_init((pth_cond_t*)cond);
+            ret = 0;
         }
     } else {
         warning("pthread_cond_init() is handled by pth but not implemented by shadow");
@@ -7422,17 +7929,11 @@ int process_emu_pthread_cond_destroy(Process* proc, pthread_cond_t *cond) {
         if (cond == NULL) {
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
+        } else if(_process_getPthCond(cond)->cn_waiters > 0) {
+            ret = EBUSY;
         } else {
-            pth_cond_t* pcn = NULL;
-            memmove(&pcn, cond, sizeof(void*));
-            if(pcn == NULL) {
-                _process_setErrno(proc, EINVAL);
-                ret = EINVAL;
-            } else {
-                free(pcn);
-                memset(cond, 0, sizeof(void*));
-                ret = 0;
-            }
+            memset(cond, 0, sizeof(pthread_cond_t));
+            ret = 0;
         }
     } else {
         warning("pthread_cond_destroy() is handled by pth but not implemented by shadow");
@@ -7444,6 +7945,12 @@ int process_emu_pthread_cond_destroy(Process* proc, pthread_cond_t *cond) {
 }
 
 int process_emu_pthread_cond_broadcast(Process* proc, pthread_cond_t *cond) {
+    /* without waiters there is nobody to wake, and pth would do nothing */
+    if(proc->activeContext == PCTX_PLUGIN && cond != NULL &&
+            _process_getPthCond(cond)->cn_waiters == 0) {
+        return 0;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
@@ -7455,26 +7962,14 @@ int process_emu_pthread_cond_broadcast(Process* proc, pthread_cond_t *cond) {
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
         } else {
-            int init_result = 0;
-            pth_cond_t* pcn = NULL;
-            memmove(&pcn, cond, sizeof(void*));
-            if(pcn == NULL) {
-                _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                init_result = process_emu_pthread_cond_init(proc, cond, NULL);
-                _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-            }
-            memmove(&pcn, cond, sizeof(void*));
-            if(init_result != 0) {
+            /* this yields to the waiters */
+            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+            int result = pth_cond_notify(_process_getPthCond(cond), TRUE);
+            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+            if(!result) {
                 ret = errno;
             } else {
-                _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                init_result = pth_cond_notify(pcn, TRUE);
-                _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-                if(!init_result) {
-                    ret = errno;
-                } else {
-                    ret = 0;
-                }
+                ret = 0;
             }
         }
     } else {
@@ -7487,6 +7982,12 @@ int process_emu_pthread_cond_broadcast(Process* proc, pthread_cond_t *cond) {
 }
 
 int process_emu_pthread_cond_signal(Process* proc, pthread_cond_t *cond) {
+    /* without waiters there is nobody to wake, and pth would do nothing */
+    if(proc->activeContext == PCTX_PLUGIN && cond != NULL &&
+            _process_getPthCond(cond)->cn_waiters == 0) {
+        return 0;
+    }
+
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
     int ret = 0;
     if (prevCTX == PCTX_PLUGIN) {
@@ -7498,26 +7999,14 @@ int process_emu_pthread_cond_signal(Process* proc, pthread_cond_t *cond) {
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
         } else {
-            int init_result = 0;
-            pth_cond_t* pcn = NULL;
-            memmove(&pcn, cond, sizeof(void*));
-            if(pcn == NULL) {
-                _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                init_result = process_emu_pthread_cond_init(proc, cond, NULL);
-                _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-            }
-            memmove(&pcn, cond, sizeof(void*));
-            if(init_result != 0) {
+            /* this yields to the waiters */
+            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+            int result = pth_cond_notify(_process_getPthCond(cond), FALSE);
+            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+            if(!result) {
                 ret = errno;
             } else {
-                _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                init_result = pth_cond_notify(pcn, FALSE);
-                _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-                if(!init_result) {
-                    ret = errno;
-                } else {
-                    ret = 0;
-                }
+                ret = 0;
             }
         }
     } else {
@@ -7541,39 +8030,13 @@ int process_emu_pthread_cond_wait(Process* proc, pthread_cond_t *cond, pthread_m
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
         } else {
-            int init_result = 0;
-            pth_cond_t* pcn = NULL;
-            memmove(&pcn, cond, sizeof(void*));
-            if(pcn == NULL) {
-                _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                init_result = process_emu_pthread_cond_init(proc, cond, NULL);
-                _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-            }
-            memmove(&pcn, cond, sizeof(void*));
-            if(init_result != 0) {
+            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+            int result = pth_cond_await(_process_getPthCond(cond), _process_getPthMutex(mutex), NULL);
+            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+            if(!result) {
                 ret = errno;
             } else {
-                init_result = 0;
-                pth_mutex_t* pm = NULL;
-                memmove(&pm, mutex, sizeof(void*));
-                if(pm == NULL) {
-                    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                    init_result = process_emu_pthread_mutex_init(proc, mutex, NULL);
-                    _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-                }
-                memmove(&pm, mutex, sizeof(void*));
-                if(init_result != 0) {
-                    ret = errno;
-                } else {
-                    _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                    init_result = pth_cond_await(pcn, pm, NULL);
-                    _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-                    if(!init_result) {
-                        ret = errno;
-                    } else {
-                        ret = 0;
-                    }
-                }
+                ret = 0;
             }
         }
     } else {
@@ -7598,54 +8061,27 @@ int process_emu_pthread_cond_timedwait(Process* proc, pthread_cond_t *cond, pthr
             _process_setErrno(proc, EINVAL);
             ret = EINVAL;
         } else {
-            int init_result = 0;
-            pth_cond_t* pcn = NULL;
-            memmove(&pcn, cond, sizeof(void*));
-            if(pcn == NULL) {
-                _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                init_result = process_emu_pthread_cond_init(proc, cond, NULL);
-                _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-            }
-            memmove(&pcn, cond, sizeof(void*));
-            if(init_result != 0) {
+            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+            pth_time_t t = pth_time(abstime->tv_sec, (abstime->tv_nsec)/1000);
+            pth_event_t ev = pth_event(PTH_EVENT_TIME, t);
+            int result = pth_cond_await(_process_getPthCond(cond), _process_getPthMutex(mutex), ev);
+            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+
+            if (!result) {
                 ret = errno;
             } else {
-                pth_event_t ev;
-                init_result = 0;
-                pth_mutex_t* pm = NULL;
-                memmove(&pm, mutex, sizeof(void*));
-                if(pm == NULL) {
-                    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                    init_result = process_emu_pthread_mutex_init(proc, mutex, NULL);
-                    _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-                }
-                memmove(&pm, mutex, sizeof(void*));
-                if(init_result != 0) {
-                    ret = errno;
+                _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+                pth_status_t ev_status = pth_event_status(ev);
+                _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+                if (ev_status == PTH_STATUS_OCCURRED) {
+                    ret = ETIMEDOUT;
                 } else {
-                    _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                    pth_time_t t = pth_time(abstime->tv_sec, (abstime->tv_nsec)/1000);
-                    ev = pth_event(PTH_EVENT_TIME, t);
-                    init_result = pth_cond_await(pcn, pm, ev);
-                    _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-
-                    if (!init_result) {
-                        ret = errno;
-                    } else {
-                        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                        pth_status_t ev_status = pth_event_status(ev);
-                        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
-                        if (ev_status == PTH_STATUS_OCCURRED) {
-                            ret = ETIMEDOUT;
-                        } else {
-                            ret = 0;
-                        }
-                    }
-                    _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
-                    pth_event_free(ev, PTH_FREE_THIS);
-                    _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+                    ret = 0;
                 }
             }
+            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+            pth_event_free(ev, PTH_FREE_THIS);
+            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
         }
     } else {
         warning("pthread_cond_signal() is handled by pth but not implemented by shadow");
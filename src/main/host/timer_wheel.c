@@ -0,0 +1,384 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/host/timer_wheel.h"
+
+#include <glib.h>
+
+#include "main/core/work/task.h"
+#include "main/core/worker.h"
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+/* level 0 slots are 2^16 nanos (~65 microseconds) wide, and each level has
+ * 64 slots, so six levels cover about 52 days of simulated time. anything
+ * further out than that is kept on an unsorted overflow list. */
+#define TIMERWHEEL_TICK_SHIFT 16
+#define TIMERWHEEL_LEVEL_BITS 6
+#define TIMERWHEEL_NUM_SLOTS (1 << TIMERWHEEL_LEVEL_BITS)
+#define TIMERWHEEL_SLOT_MASK (TIMERWHEEL_NUM_SLOTS - 1)
+#define TIMERWHEEL_NUM_LEVELS 6
+
+typedef struct _TimerWheelSlot TimerWheelSlot;
+struct _TimerWheelSlot {
+    TimerWheelEntry* head;
+    guint level;
+    guint index;
+};
+
+struct _TimerWheelEntry {
+    TimerWheel* wheel;
+
+    TimerWheelCallbackFunc callback;
+    gpointer object;
+    gpointer argument;
+    TimerWheelObjectRefFunc objectRef;
+    TimerWheelObjectRefFunc objectUnref;
+
+    SimulationTime expireTime;
+
+    /* the slot we are linked into, or NULL if we are not armed */
+    TimerWheelSlot* slot;
+    TimerWheelEntry* prev;
+    TimerWheelEntry* next;
+
+    MAGIC_DECLARE;
+};
+
+struct _TimerWheel {
+    /* entries on level L share all tick bits above level L with the current
+     * tick, so every entry on a lower level expires before every entry on a
+     * higher level, and slots on a level are ordered by their index */
+    TimerWheelSlot slots[TIMERWHEEL_NUM_LEVELS][TIMERWHEEL_NUM_SLOTS];
+    gulong occupied[TIMERWHEEL_NUM_LEVELS];
+    TimerWheelSlot overflow;
+
+    /* the tick (time >> TIMERWHEEL_TICK_SHIFT) the wheel has advanced to */
+    guint64 currentTick;
+
+    /* the single expire event we keep in the scheduler queue. events that were
+     * superseded by an earlier deadline fire with an old id and are ignored. */
+    gboolean isScheduled;
+    SimulationTime scheduledTime;
+    guint scheduledID;
+
+    /* we are running callbacks and will schedule the next event when done */
+    gboolean isExpiring;
+
+    MAGIC_DECLARE;
+};
+
+TimerWheel* timerwheel_new() {
+    TimerWheel* wheel = g_new0(TimerWheel, 1);
+    MAGIC_INIT(wheel);
+
+    for(guint level = 0; level < TIMERWHEEL_NUM_LEVELS; level++) {
+        for(guint index = 0; index < TIMERWHEEL_NUM_SLOTS; index++) {
+            wheel->slots[level][index].level = level;
+            wheel->slots[level][index].index = index;
+        }
+    }
+    wheel->overflow.level = TIMERWHEEL_NUM_LEVELS;
+
+    return wheel;
+}
+
+static void _timerwheel_link(TimerWheel* wheel, TimerWheelSlot* slot, TimerWheelEntry* entry) {
+    entry->slot = slot;
+    entry->prev = NULL;
+    entry->next = slot->head;
+    if(slot->head) {
+        slot->head->prev = entry;
+    }
+    slot->head = entry;
+
+    if(slot->level < TIMERWHEEL_NUM_LEVELS) {
+        wheel->occupied[slot->level] |= (1UL << slot->index);
+    }
+}
+
+static void _timerwheel_unlink(TimerWheel* wheel, TimerWheelEntry* entry) {
+    TimerWheelSlot* slot = entry->slot;
+    utility_assert(slot);
+
+    if(entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        slot->head = entry->next;
+    }
+    if(entry->next) {
+        entry->next->prev = entry->prev;
+    }
+
+    if(!slot->head && slot->level < TIMERWHEEL_NUM_LEVELS) {
+        wheel->occupied[slot->level] &= ~(1UL << slot->index);
+    }
+
+    entry->slot = NULL;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void _timerwheel_place(TimerWheel* wheel, TimerWheelEntry* entry) {
+    guint64 tick = entry->expireTime >> TIMERWHEEL_TICK_SHIFT;
+
+    /* entries that are already due go in the current slot */
+    tick = MAX(tick, wheel->currentTick);
+
+    for(guint level = 0; level < TIMERWHEEL_NUM_LEVELS; level++) {
+        guint shift = TIMERWHEEL_LEVEL_BITS * (level + 1);
+        if((tick >> shift) == (wheel->currentTick >> shift)) {
+            guint index = (guint)((tick >> (TIMERWHEEL_LEVEL_BITS * level)) & TIMERWHEEL_SLOT_MASK);
+            _timerwheel_link(wheel, &(wheel->slots[level][index]), entry);
+            return;
+        }
+    }
+
+    _timerwheel_link(wheel, &(wheel->overflow), entry);
+}
+
+static void _timerwheel_pullSlot(TimerWheel* wheel, TimerWheelSlot* slot, TimerWheelEntry** pulled) {
+    while(slot->head) {
+        TimerWheelEntry* entry = slot->head;
+        _timerwheel_unlink(wheel, entry);
+        entry->next = *pulled;
+        *pulled = entry;
+    }
+}
+
+/* move the wheel forward to the given tick, cascading every entry whose
+ * position is no longer valid relative to the new tick down the levels */
+static void _timerwheel_advance(TimerWheel* wheel, guint64 newTick) {
+    guint64 oldTick = wheel->currentTick;
+    if(newTick <= oldTick) {
+        return;
+    }
+    wheel->currentTick = newTick;
+
+    TimerWheelEntry* pulled = NULL;
+
+    guint topShift = TIMERWHEEL_LEVEL_BITS * TIMERWHEEL_NUM_LEVELS;
+    if((oldTick >> topShift) != (newTick >> topShift)) {
+        _timerwheel_pullSlot(wheel, &(wheel->overflow), &pulled);
+    }
+
+    for(gint level = TIMERWHEEL_NUM_LEVELS - 1; level >= 0; level--) {
+        guint shift = TIMERWHEEL_LEVEL_BITS * level;
+        guint64 oldBlock = oldTick >> shift;
+        guint64 newBlock = newTick >> shift;
+
+        if(oldBlock == newBlock || !wheel->occupied[level]) {
+            continue;
+        }
+
+        guint first = 0, last = TIMERWHEEL_SLOT_MASK;
+        if((oldBlock >> TIMERWHEEL_LEVEL_BITS) == (newBlock >> TIMERWHEEL_LEVEL_BITS)) {
+            /* we only moved within this level, so only the slots we passed are stale */
+            first = (guint)(oldBlock & TIMERWHEEL_SLOT_MASK);
+            last = (guint)(newBlock & TIMERWHEEL_SLOT_MASK);
+        }
+
+        for(guint index = first; index <= last; index++) {
+            if(wheel->occupied[level] & (1UL << index)) {
+                _timerwheel_pullSlot(wheel, &(wheel->slots[level][index]), &pulled);
+            }
+        }
+    }
+
+    while(pulled) {
+        TimerWheelEntry* entry = pulled;
+        pulled = entry->next;
+        _timerwheel_place(wheel, entry);
+    }
+}
+
+static SimulationTime _timerwheel_getMinExpireTime(TimerWheelSlot* slot) {
+    SimulationTime minTime = SIMTIME_INVALID;
+    for(TimerWheelEntry* entry = slot->head; entry; entry = entry->next) {
+        minTime = MIN(minTime, entry->expireTime);
+    }
+    return minTime;
+}
+
+static SimulationTime _timerwheel_getNextExpireTime(TimerWheel* wheel) {
+    for(guint level = 0; level < TIMERWHEEL_NUM_LEVELS; level++) {
+        if(wheel->occupied[level]) {
+            gint index = g_bit_nth_lsf(wheel->occupied[level], -1);
+            return _timerwheel_getMinExpireTime(&(wheel->slots[level][index]));
+        }
+    }
+    return _timerwheel_getMinExpireTime(&(wheel->overflow));
+}
+
+static void _timerwheel_expire(TimerWheel* wheel, gpointer data);
+
+static void _timerwheel_schedule(TimerWheel* wheel, SimulationTime expireTime) {
+    SimulationTime now = worker_getCurrentTime();
+    expireTime = MAX(expireTime, now);
+
+    wheel->scheduledID++;
+    wheel->scheduledTime = expireTime;
+
+    Task* task = task_new((TaskCallbackFunc)_timerwheel_expire, wheel,
+            GUINT_TO_POINTER(wheel->scheduledID), NULL, NULL);
+    wheel->isScheduled = worker_scheduleTask(task, expireTime - now);
+    task_unref(task);
+}
+
+static void _timerwheel_fire(TimerWheel* wheel, TimerWheelEntry* entry) {
+    _timerwheel_unlink(wheel, entry);
+
+    /* the entry may be re-armed or freed by the callback */
+    gpointer object = entry->object;
+    TimerWheelObjectRefFunc objectUnref = entry->objectUnref;
+
+    entry->callback(object, entry->argument);
+
+    if(objectUnref) {
+        objectUnref(object);
+    }
+}
+
+static TimerWheelEntry* _timerwheel_findExpired(TimerWheel* wheel, SimulationTime now) {
+    guint index = (guint)(wheel->currentTick & TIMERWHEEL_SLOT_MASK);
+    for(TimerWheelEntry* entry = wheel->slots[0][index].head; entry; entry = entry->next) {
+        if(entry->expireTime <= now) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void _timerwheel_expire(TimerWheel* wheel, gpointer data) {
+    MAGIC_ASSERT(wheel);
+
+    guint scheduledID = GPOINTER_TO_UINT(data);
+    if(!wheel->isScheduled || scheduledID != wheel->scheduledID) {
+        /* an earlier deadline was armed after this event was scheduled */
+        return;
+    }
+    wheel->isScheduled = FALSE;
+
+    SimulationTime now = worker_getCurrentTime();
+    _timerwheel_advance(wheel, now >> TIMERWHEEL_TICK_SHIFT);
+
+    /* everything that is due was cascaded into the current level 0 slot */
+    wheel->isExpiring = TRUE;
+    TimerWheelEntry* entry = NULL;
+    while((entry = _timerwheel_findExpired(wheel, now)) != NULL) {
+        _timerwheel_fire(wheel, entry);
+    }
+    wheel->isExpiring = FALSE;
+
+    SimulationTime nextExpireTime = _timerwheel_getNextExpireTime(wheel);
+    if(nextExpireTime != SIMTIME_INVALID) {
+        _timerwheel_schedule(wheel, nextExpireTime);
+    }
+}
+
+static void _timerwheel_releaseSlot(TimerWheel* wheel, TimerWheelSlot* slot) {
+    /* the unref may free the object, which frees its entry, so unlink first */
+    while(slot->head) {
+        TimerWheelEntry* entry = slot->head;
+        _timerwheel_unlink(wheel, entry);
+        if(entry->objectUnref) {
+            entry->objectUnref(entry->object);
+        }
+    }
+}
+
+void timerwheel_free(TimerWheel* wheel) {
+    MAGIC_ASSERT(wheel);
+
+    /* release the objects of entries that never fired */
+    for(guint level = 0; level < TIMERWHEEL_NUM_LEVELS; level++) {
+        for(guint index = 0; index < TIMERWHEEL_NUM_SLOTS; index++) {
+            _timerwheel_releaseSlot(wheel, &(wheel->slots[level][index]));
+        }
+    }
+    _timerwheel_releaseSlot(wheel, &(wheel->overflow));
+
+    MAGIC_CLEAR(wheel);
+    g_free(wheel);
+}
+
+TimerWheelEntry* timerwheel_newEntry(TimerWheel* wheel, TimerWheelCallbackFunc callback,
+        gpointer object, gpointer argument,
+        TimerWheelObjectRefFunc objectRef, TimerWheelObjectRefFunc objectUnref) {
+    MAGIC_ASSERT(wheel);
+    utility_assert(callback);
+    utility_assert((objectRef && objectUnref) || (!objectRef && !objectUnref));
+
+    TimerWheelEntry* entry = g_new0(TimerWheelEntry, 1);
+    MAGIC_INIT(entry);
+
+    entry->wheel = wheel;
+    entry->callback = callback;
+    entry->object = object;
+    entry->argument = argument;
+    entry->objectRef = objectRef;
+    entry->objectUnref = objectUnref;
+
+    return entry;
+}
+
+void timerwheel_freeEntry(TimerWheelEntry* entry) {
+    MAGIC_ASSERT(entry);
+
+    /* the owner is being freed, so there is no reference left to release */
+    if(entry->slot) {
+        _timerwheel_unlink(entry->wheel, entry);
+    }
+
+    MAGIC_CLEAR(entry);
+    g_free(entry);
+}
+
+void timerwheel_arm(TimerWheelEntry* entry, SimulationTime expireTime) {
+    MAGIC_ASSERT(entry);
+    TimerWheel* wheel = entry->wheel;
+    MAGIC_ASSERT(wheel);
+
+    if(entry->slot) {
+        _timerwheel_unlink(wheel, entry);
+    } else if(entry->objectRef) {
+        entry->objectRef(entry->object);
+    }
+
+    _timerwheel_advance(wheel, worker_getCurrentTime() >> TIMERWHEEL_TICK_SHIFT);
+
+    entry->expireTime = expireTime;
+    _timerwheel_place(wheel, entry);
+
+    if(!wheel->isExpiring && (!wheel->isScheduled || expireTime < wheel->scheduledTime)) {
+        _timerwheel_schedule(wheel, expireTime);
+    }
+}
+
+void timerwheel_cancel(TimerWheelEntry* entry) {
+    MAGIC_ASSERT(entry);
+
+    if(!entry->slot) {
+        return;
+    }
+
+    /* the scheduled event stays in place; if it was for this entry, it will
+     * find nothing due and move on to the next deadline */
+    _timerwheel_unlink(entry->wheel, entry);
+
+    if(entry->objectUnref) {
+        entry->objectUnref(entry->object);
+    }
+}
+
+gboolean timerwheel_isArmed(TimerWheelEntry* entry) {
+    MAGIC_ASSERT(entry);
+    return entry->slot ? TRUE : FALSE;
+}
+
+SimulationTime timerwheel_getExpireTime(TimerWheelEntry* entry) {
+    MAGIC_ASSERT(entry);
+    return entry->slot ? entry->expireTime : SIMTIME_INVALID;
+}
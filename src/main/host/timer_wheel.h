@@ -0,0 +1,40 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_TIMER_WHEEL_H_
+#define SHD_TIMER_WHEEL_H_
+
+#include <glib.h>
+
+#include "main/core/support/definitions.h"
+
+/* A hierarchical timing wheel that owns the host-local timers (timerfds,
+ * TCP connection timers, interface refills). Arming and cancelling an entry
+ * are constant time, and the wheel keeps at most one event in the scheduler
+ * queue for its earliest deadline instead of one event per timer. */
+typedef struct _TimerWheel TimerWheel;
+typedef struct _TimerWheelEntry TimerWheelEntry;
+
+typedef void (*TimerWheelCallbackFunc)(gpointer object, gpointer argument);
+typedef void (*TimerWheelObjectRefFunc)(gpointer object);
+
+TimerWheel* timerwheel_new();
+void timerwheel_free(TimerWheel* wheel);
+
+/* the entry is owned by the caller and must be freed with timerwheel_freeEntry.
+ * if objectRef and objectUnref are given, the wheel holds a reference to the
+ * object for as long as the entry is armed. */
+TimerWheelEntry* timerwheel_newEntry(TimerWheel* wheel, TimerWheelCallbackFunc callback,
+        gpointer object, gpointer argument,
+        TimerWheelObjectRefFunc objectRef, TimerWheelObjectRefFunc objectUnref);
+void timerwheel_freeEntry(TimerWheelEntry* entry);
+
+/* (re)arm the entry to fire at the given absolute time; an armed entry is moved */
+void timerwheel_arm(TimerWheelEntry* entry, SimulationTime expireTime);
+void timerwheel_cancel(TimerWheelEntry* entry);
+gboolean timerwheel_isArmed(TimerWheelEntry* entry);
+SimulationTime timerwheel_getExpireTime(TimerWheelEntry* entry);
+
+#endif /* SHD_TIMER_WHEEL_H_ */
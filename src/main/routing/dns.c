@@ -111,7 +111,7 @@ static in_addr_t _dns_generateIP(DNS* dns) {
     return ip;
 }
 
-Address* dns_register(DNS* dns, GQuark id, gchar* name, gchar* requestedIP) {
+Address* dns_register(DNS* dns, GQuark id, gchar* name, const gchar* requestedIP) {
     MAGIC_ASSERT(dns);
     utility_assert(name);
 
@@ -17,6 +17,9 @@
 #include "support/logger/log_level.h"
 #include "support/logger/logger.h"
 
+/* how many packets fit in a PacketQueue before it grows for the first time */
+#define PACKET_QUEUE_INITIAL_CAPACITY 16
+
 /* thread-safe structure representing a data/network packet */
 
 typedef struct _PacketLocalHeader PacketLocalHeader;
@@ -59,6 +62,10 @@ struct _Packet {
     PacketDeliveryStatusFlags allStatus;
     GQueue* orderedStatus;
 
+    /* if this is a TSO aggregate, the back-to-back TCP segments it carries in
+     * sequence order. the aggregate itself has a header but no payload. */
+    GQueue* segments;
+
     MAGIC_DECLARE;
 };
 
@@ -156,10 +163,66 @@ Packet* packet_copy(Packet* packet) {
         }
     }
 
+    if(packet->segments) {
+        copy->segments = g_queue_new();
+        for(GList* item = g_queue_peek_head_link(packet->segments); item; item = g_list_next(item)) {
+            g_queue_push_tail(copy->segments, packet_copy((Packet*)item->data));
+        }
+    }
+
     worker_countObject(OBJECT_TYPE_PACKET, COUNTER_TYPE_NEW);
     return copy;
 }
 
+/* create an aggregate that will carry the given TCP segment and any others added
+ * with packet_addSegment. the aggregate takes its routing information from the
+ * first segment, and holds its own reference to each segment. */
+Packet* packet_newAggregate(Packet* firstSegment) {
+    MAGIC_ASSERT(firstSegment);
+    utility_assert(firstSegment->protocol == PTCP && !firstSegment->segments);
+
+    Packet* aggregate = g_new0(Packet, 1);
+    MAGIC_INIT(aggregate);
+
+    aggregate->referenceCount = 1;
+
+    aggregate->hostID = firstSegment->hostID;
+    aggregate->packetID = firstSegment->packetID;
+    aggregate->priority = firstSegment->priority;
+
+    aggregate->protocol = PTCP;
+    aggregate->header = g_memdup(firstSegment->header, sizeof(PacketTCPHeader));
+    ((PacketTCPHeader*)aggregate->header)->selectiveACKs = NULL;
+
+    aggregate->orderedStatus = g_queue_new();
+    aggregate->segments = g_queue_new();
+
+    worker_countObject(OBJECT_TYPE_PACKET, COUNTER_TYPE_NEW);
+
+    packet_addSegment(aggregate, firstSegment);
+    return aggregate;
+}
+
+void packet_addSegment(Packet* aggregate, Packet* segment) {
+    MAGIC_ASSERT(aggregate);
+    MAGIC_ASSERT(segment);
+    utility_assert(aggregate->segments && !segment->segments);
+    utility_assert(segment->protocol == PTCP);
+
+    packet_ref(segment);
+    g_queue_push_tail(aggregate->segments, segment);
+}
+
+GList* packet_getSegments(Packet* packet) {
+    MAGIC_ASSERT(packet);
+    return packet->segments ? g_queue_peek_head_link(packet->segments) : NULL;
+}
+
+guint packet_getSegmentCount(Packet* packet) {
+    MAGIC_ASSERT(packet);
+    return packet->segments ? g_queue_get_length(packet->segments) : 1;
+}
+
 static void _packet_free(Packet* packet) {
     MAGIC_ASSERT(packet);
 
@@ -179,6 +242,9 @@ static void _packet_free(Packet* packet) {
     if(packet->orderedStatus) {
         g_queue_free(packet->orderedStatus);
     }
+    if(packet->segments) {
+        g_queue_free_full(packet->segments, (GDestroyNotify)packet_unref);
+    }
 
     MAGIC_CLEAR(packet);
     g_free(packet);
@@ -303,7 +369,13 @@ void packet_updateTCP(Packet* packet, guint acknowledgement, GList* selectiveACK
 
 guint packet_getPayloadLength(Packet* packet) {
     MAGIC_ASSERT(packet);
-    if(packet->payload) {
+    if(packet->segments) {
+        guint length = 0;
+        for(GList* item = g_queue_peek_head_link(packet->segments); item; item = g_list_next(item)) {
+            length += packet_getPayloadLength((Packet*)item->data);
+        }
+        return length;
+    } else if(packet->payload) {
         return (guint)payload_getLength(packet->payload);
     } else {
         return 0;
@@ -319,7 +391,8 @@ guint packet_getHeaderSize(Packet* packet) {
     MAGIC_ASSERT(packet);
     guint size = packet->protocol == PUDP ? CONFIG_HEADER_SIZE_UDPIPETH :
             packet->protocol == PTCP ? CONFIG_HEADER_SIZE_TCPIPETH : 0;
-    return size;
+    /* an aggregate occupies the wire like its segments would have separately */
+    return size * packet_getSegmentCount(packet);
 }
 
 in_addr_t packet_getDestinationIP(Packet* packet) {
@@ -662,3 +735,75 @@ PacketDeliveryStatusFlags packet_getDeliveryStatus(Packet* packet) {
     MAGIC_ASSERT(packet);
     return packet->allStatus;
 }
+
+void packetqueue_init(PacketQueue* queue) {
+    utility_assert(queue);
+    queue->packets = NULL;
+    queue->capacity = 0;
+    queue->head = 0;
+    queue->length = 0;
+}
+
+void packetqueue_clear(PacketQueue* queue) {
+    utility_assert(queue);
+    while(!packetqueue_isEmpty(queue)) {
+        packet_unref(packetqueue_pop(queue));
+    }
+    g_free(queue->packets);
+    packetqueue_init(queue);
+}
+
+/* doubles the ring, moving the packets to the front of the new one */
+static void _packetqueue_grow(PacketQueue* queue) {
+    guint capacity = (queue->capacity > 0) ? (queue->capacity * 2) : PACKET_QUEUE_INITIAL_CAPACITY;
+    Packet** packets = g_new(Packet*, capacity);
+
+    for(guint i = 0; i < queue->length; i++) {
+        packets[i] = queue->packets[(queue->head + i) % queue->capacity];
+    }
+
+    g_free(queue->packets);
+    queue->packets = packets;
+    queue->capacity = capacity;
+    queue->head = 0;
+}
+
+void packetqueue_push(PacketQueue* queue, Packet* packet) {
+    utility_assert(queue);
+    MAGIC_ASSERT(packet);
+
+    if(queue->length == queue->capacity) {
+        _packetqueue_grow(queue);
+    }
+
+    queue->packets[(queue->head + queue->length) % queue->capacity] = packet;
+    queue->length++;
+}
+
+Packet* packetqueue_pop(PacketQueue* queue) {
+    utility_assert(queue);
+
+    if(queue->length == 0) {
+        return NULL;
+    }
+
+    Packet* packet = queue->packets[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->length--;
+    return packet;
+}
+
+Packet* packetqueue_peek(const PacketQueue* queue) {
+    utility_assert(queue);
+    return (queue->length > 0) ? queue->packets[queue->head] : NULL;
+}
+
+gboolean packetqueue_isEmpty(const PacketQueue* queue) {
+    utility_assert(queue);
+    return queue->length == 0 ? TRUE : FALSE;
+}
+
+guint packetqueue_getLength(const PacketQueue* queue) {
+    utility_assert(queue);
+    return queue->length;
+}
@@ -15,6 +15,21 @@
 
 typedef struct _Packet Packet;
 
+/* A FIFO of packets in a ring that the queue owns and grows as needed, so
+ * that queueing a packet normally does not allocate. The packets are not
+ * linked to the queue, so the same packet may be in several queues at once,
+ * e.g. in the output buffer of a sender that retransmits it and in the queue
+ * of the local interface that delivers it back to us. The queue owns the
+ * reference it was given. */
+typedef struct _PacketQueue PacketQueue;
+struct _PacketQueue {
+    Packet** packets;
+    guint capacity;
+    /* the index of the oldest packet in the ring */
+    guint head;
+    guint length;
+};
+
 typedef enum _PacketDeliveryStatusFlags PacketDeliveryStatusFlags;
 enum _PacketDeliveryStatusFlags {
     PDS_NONE = 0,
@@ -60,6 +75,11 @@ const gchar* protocol_toString(ProtocolType type);
 Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, guint64 packetID);
 Packet* packet_copy(Packet* packet);
 
+Packet* packet_newAggregate(Packet* firstSegment);
+void packet_addSegment(Packet* aggregate, Packet* segment);
+GList* packet_getSegments(Packet* packet);
+guint packet_getSegmentCount(Packet* packet);
+
 void packet_ref(Packet* packet);
 void packet_unref(Packet* packet);
 
@@ -97,4 +117,14 @@ PacketDeliveryStatusFlags packet_getDeliveryStatus(Packet* packet);
 
 gchar* packet_toString(Packet* packet);
 
+
+void packetqueue_init(PacketQueue* queue);
+/* unrefs the queued packets and frees the ring */
+void packetqueue_clear(PacketQueue* queue);
+void packetqueue_push(PacketQueue* queue, Packet* packet);
+Packet* packetqueue_pop(PacketQueue* queue);
+Packet* packetqueue_peek(const PacketQueue* queue);
+gboolean packetqueue_isEmpty(const PacketQueue* queue);
+guint packetqueue_getLength(const PacketQueue* queue);
+
 #endif /* SHD_PACKET_H_ */
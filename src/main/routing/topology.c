@@ -125,11 +125,11 @@ struct _AttachHelper {
     guint numIPsType;
     guint numIPsAll;
 
-    gchar* ipHint;
-    gchar* citycodeHint;
-    gchar* countrycodeHint;
-    gchar* geocodeHint;
-    gchar* typeHint;
+    const gchar* ipHint;
+    const gchar* citycodeHint;
+    const gchar* countrycodeHint;
+    const gchar* geocodeHint;
+    const gchar* typeHint;
 
     in_addr_t requestedIP;
     gboolean requestedIPIsUsable;
@@ -2074,6 +2074,58 @@ gdouble topology_getLatency(Topology* top, Address* srcAddress, Address* dstAddr
     }
 }
 
+gdouble topology_getMinimumLatency(Topology* top, Address* srcAddress) {
+    MAGIC_ASSERT(top);
+
+    igraph_integer_t srcVertexIndex = _topology_getConnectedVertexIndex(top, srcAddress);
+    if(srcVertexIndex < 0) {
+        return (gdouble) -1;
+    }
+
+    /* every path, including the one back to the source itself, starts with one
+     * of the outgoing edges, so the shortest of those is a lower bound */
+    _topology_lockGraph(top);
+
+    igraph_es_t edgeSelector;
+    gint result = igraph_es_incident(&edgeSelector, srcVertexIndex, IGRAPH_OUT);
+    if(result != IGRAPH_SUCCESS) {
+        critical("igraph_es_incident return non-success code %i", result);
+        _topology_unlockGraph(top);
+        return (gdouble) -1;
+    }
+
+    igraph_eit_t edgeIterator;
+    result = igraph_eit_create(&top->graph, edgeSelector, &edgeIterator);
+    if(result != IGRAPH_SUCCESS) {
+        critical("igraph_eit_create return non-success code %i", result);
+        igraph_es_destroy(&edgeSelector);
+        _topology_unlockGraph(top);
+        return (gdouble) -1;
+    }
+
+    igraph_real_t minLatency = 0.0f;
+    while (!IGRAPH_EIT_END(edgeIterator)) {
+        igraph_integer_t edgeIndex = IGRAPH_EIT_GET(edgeIterator);
+
+        igraph_real_t edgeLatency = 0.0f;
+        gboolean found = _topology_findEdgeAttributeDouble(top, edgeIndex, EDGE_ATTR_LATENCY, &edgeLatency);
+        utility_assert(found);
+
+        if(minLatency == 0 || edgeLatency < minLatency) {
+            minLatency = edgeLatency;
+        }
+
+        IGRAPH_EIT_NEXT(edgeIterator);
+    }
+
+    _topology_unlockGraph(top);
+
+    igraph_eit_destroy(&edgeIterator);
+    igraph_es_destroy(&edgeSelector);
+
+    return (gdouble) minLatency;
+}
+
 gdouble topology_getReliability(Topology* top, Address* srcAddress, Address* dstAddress) {
     MAGIC_ASSERT(top);
 
@@ -2246,7 +2298,8 @@ static igraph_integer_t* _topology_getLongestPrefixMatch(Topology* top, GQueue*
 }
 
 static igraph_integer_t _topology_findAttachmentVertex(Topology* top, Random* randomSourcePool, in_addr_t nodeIP,
-        gchar* ipHint, gchar* citycodeHint, gchar* countrycodeHint, gchar* geocodeHint, gchar* typeHint) {
+        const gchar* ipHint, const gchar* citycodeHint, const gchar* countrycodeHint,
+        const gchar* geocodeHint, const gchar* typeHint) {
     MAGIC_ASSERT(top);
 
     igraph_integer_t vertexIndex = (igraph_integer_t) -1;
@@ -2369,7 +2422,8 @@ static igraph_integer_t _topology_findAttachmentVertex(Topology* top, Random* ra
 }
 
 void topology_attach(Topology* top, Address* address, Random* randomSourcePool,
-        gchar* ipHint, gchar* citycodeHint, gchar* countrycodeHint, gchar* geocodeHint, gchar* typeHint,
+        const gchar* ipHint, const gchar* citycodeHint, const gchar* countrycodeHint,
+        const gchar* geocodeHint, const gchar* typeHint,
         guint64* bwDownOut, guint64* bwUpOut) {
     MAGIC_ASSERT(top);
     utility_assert(address);
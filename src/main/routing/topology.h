@@ -18,12 +18,15 @@ Topology* topology_new(const gchar* graphPath);
 void topology_free(Topology* top);
 
 void topology_attach(Topology* top, Address* address, Random* randomSourcePool,
-        gchar* ipHint, gchar* citycodeHint, gchar* countrycodeHint, gchar* geocodeHint, gchar* typeHint,
+        const gchar* ipHint, const gchar* citycodeHint, const gchar* countrycodeHint,
+        const gchar* geocodeHint, const gchar* typeHint,
         guint64* bwDownOut, guint64* bwUpOut);
 void topology_detach(Topology* top, Address* address);
 
 gboolean topology_isRoutable(Topology* top, Address* srcAddress, Address* dstAddress);
 gdouble topology_getLatency(Topology* top, Address* srcAddress, Address* dstAddress);
+/* a lower bound on the latency of any path from the address, or -1 on error */
+gdouble topology_getMinimumLatency(Topology* top, Address* srcAddress);
 gdouble topology_getReliability(Topology* top, Address* srcAddress, Address* dstAddress);
 void topology_incrementPathPacketCounter(Topology* top, Address* srcAddress, Address* dstAddress);
 
@@ -0,0 +1,211 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/utility/cpu_topology.h"
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+#define CPU_TOPOLOGY_NODE_PATH "/sys/devices/system/node"
+#define CPU_TOPOLOGY_CPU_PATH "/sys/devices/system/cpu"
+
+typedef struct _CPUInfo CPUInfo;
+struct _CPUInfo {
+    gint cpu;
+    gint node;
+    /* the lowest CPU sharing our last level cache, or -1 */
+    gint cacheDomain;
+};
+
+struct _CPUTopology {
+    /* CPUInfo for each CPU we may run on, sorted by node */
+    GArray* cpus;
+    /* the nodes of the CPUs, in the same order */
+    GArray* nodes;
+    MAGIC_DECLARE;
+};
+
+/* parses the kernel's cpu list format, e.g. "0-3,8,10-11" */
+static GArray* _cputopology_parseList(const gchar* list) {
+    GArray* values = g_array_new(FALSE, FALSE, sizeof(gint));
+    gchar** ranges = g_strsplit(g_strstrip((gchar*)list), ",", -1);
+
+    for(gint i = 0; ranges[i] != NULL; i++) {
+        if(ranges[i][0] == '\0') {
+            continue;
+        }
+
+        gchar* end = NULL;
+        gint first = (gint)strtol(ranges[i], &end, 10);
+        gint last = first;
+        if(end && *end == '-') {
+            last = (gint)strtol(end + 1, NULL, 10);
+        }
+
+        for(gint value = first; value <= last; value++) {
+            g_array_append_val(values, value);
+        }
+    }
+
+    g_strfreev(ranges);
+    return values;
+}
+
+static CPUInfo* _cputopology_lookup(CPUTopology* topology, gint cpu) {
+    for(guint i = 0; i < topology->cpus->len; i++) {
+        CPUInfo* info = &g_array_index(topology->cpus, CPUInfo, i);
+        if(info->cpu == cpu) {
+            return info;
+        }
+    }
+    return NULL;
+}
+
+static void _cputopology_readNodes(CPUTopology* topology) {
+    GDir* dir = g_dir_open(CPU_TOPOLOGY_NODE_PATH, 0, NULL);
+    if(!dir) {
+        /* no NUMA support, everything stays on node 0 */
+        return;
+    }
+
+    const gchar* name = NULL;
+    while((name = g_dir_read_name(dir)) != NULL) {
+        gint node = 0;
+        if(!g_str_has_prefix(name, "node") || sscanf(name, "node%i", &node) != 1) {
+            continue;
+        }
+
+        gchar* path = g_build_filename(CPU_TOPOLOGY_NODE_PATH, name, "cpulist", NULL);
+        gchar* contents = NULL;
+        if(g_file_get_contents(path, &contents, NULL, NULL)) {
+            GArray* cpus = _cputopology_parseList(contents);
+            for(guint i = 0; i < cpus->len; i++) {
+                CPUInfo* info = _cputopology_lookup(topology, g_array_index(cpus, gint, i));
+                if(info) {
+                    info->node = node;
+                }
+            }
+            g_array_free(cpus, TRUE);
+            g_free(contents);
+        }
+        g_free(path);
+    }
+
+    g_dir_close(dir);
+}
+
+static void _cputopology_readCacheDomains(CPUTopology* topology) {
+    for(guint i = 0; i < topology->cpus->len; i++) {
+        CPUInfo* info = &g_array_index(topology->cpus, CPUInfo, i);
+
+        /* index3 is the L3 cache, which is shared by a core complex (or a whole socket) */
+        gchar* name = g_strdup_printf("cpu%i", info->cpu);
+        gchar* path = g_build_filename(CPU_TOPOLOGY_CPU_PATH, name, "cache", "index3", "shared_cpu_list", NULL);
+        gchar* contents = NULL;
+        if(g_file_get_contents(path, &contents, NULL, NULL)) {
+            GArray* cpus = _cputopology_parseList(contents);
+            for(guint j = 0; j < cpus->len; j++) {
+                gint cpu = g_array_index(cpus, gint, j);
+                if(info->cacheDomain < 0 || cpu < info->cacheDomain) {
+                    info->cacheDomain = cpu;
+                }
+            }
+            g_array_free(cpus, TRUE);
+            g_free(contents);
+        }
+        g_free(path);
+        g_free(name);
+    }
+}
+
+static gint _cputopology_compare(const CPUInfo* a, const CPUInfo* b) {
+    if(a->node != b->node) {
+        return a->node < b->node ? -1 : 1;
+    }
+    return a->cpu < b->cpu ? -1 : (a->cpu > b->cpu ? 1 : 0);
+}
+
+CPUTopology* cputopology_new() {
+    CPUTopology* topology = g_new0(CPUTopology, 1);
+    MAGIC_INIT(topology);
+
+    topology->cpus = g_array_new(FALSE, FALSE, sizeof(CPUInfo));
+    topology->nodes = g_array_new(FALSE, FALSE, sizeof(gint));
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0) {
+        warning("unable to get the CPU affinity of the process: %s", g_strerror(errno));
+        return topology;
+    }
+
+    for(gint cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if(CPU_ISSET(cpu, &allowed)) {
+            CPUInfo info = {.cpu = cpu, .node = 0, .cacheDomain = -1};
+            g_array_append_val(topology->cpus, info);
+        }
+    }
+
+    _cputopology_readNodes(topology);
+    _cputopology_readCacheDomains(topology);
+    g_array_sort(topology->cpus, (GCompareFunc)_cputopology_compare);
+
+    for(guint i = 0; i < topology->cpus->len; i++) {
+        CPUInfo* info = &g_array_index(topology->cpus, CPUInfo, i);
+        if(topology->nodes->len == 0 ||
+                g_array_index(topology->nodes, gint, topology->nodes->len - 1) != info->node) {
+            g_array_append_val(topology->nodes, info->node);
+        }
+    }
+
+    return topology;
+}
+
+void cputopology_free(CPUTopology* topology) {
+    MAGIC_ASSERT(topology);
+    g_array_free(topology->cpus, TRUE);
+    g_array_free(topology->nodes, TRUE);
+    MAGIC_CLEAR(topology);
+    g_free(topology);
+}
+
+guint cputopology_getNumCPUs(CPUTopology* topology) {
+    MAGIC_ASSERT(topology);
+    return topology->cpus->len;
+}
+
+gint cputopology_getCPU(CPUTopology* topology, guint index) {
+    MAGIC_ASSERT(topology);
+    utility_assert(index < topology->cpus->len);
+    return g_array_index(topology->cpus, CPUInfo, index).cpu;
+}
+
+guint cputopology_getNumNodes(CPUTopology* topology) {
+    MAGIC_ASSERT(topology);
+    return topology->nodes->len;
+}
+
+gint cputopology_getNode(CPUTopology* topology, guint index) {
+    MAGIC_ASSERT(topology);
+    utility_assert(index < topology->nodes->len);
+    return g_array_index(topology->nodes, gint, index);
+}
+
+gint cputopology_getNodeOfCPU(CPUTopology* topology, gint cpu) {
+    MAGIC_ASSERT(topology);
+    CPUInfo* info = _cputopology_lookup(topology, cpu);
+    return info ? info->node : -1;
+}
+
+gint cputopology_getCacheDomainOfCPU(CPUTopology* topology, gint cpu) {
+    MAGIC_ASSERT(topology);
+    CPUInfo* info = _cputopology_lookup(topology, cpu);
+    return info ? info->cacheDomain : -1;
+}
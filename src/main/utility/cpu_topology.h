@@ -0,0 +1,34 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_CPU_TOPOLOGY_H_
+#define SHD_CPU_TOPOLOGY_H_
+
+#include <glib.h>
+
+/* The CPUs this process may run on, and the NUMA node and last level cache
+ * of each, as reported by the kernel in sysfs. If the machine has no NUMA
+ * information, all CPUs are on node 0. */
+typedef struct _CPUTopology CPUTopology;
+
+CPUTopology* cputopology_new();
+void cputopology_free(CPUTopology* topology);
+
+/* the CPUs are ordered by node, so that neighboring indices share a node */
+guint cputopology_getNumCPUs(CPUTopology* topology);
+gint cputopology_getCPU(CPUTopology* topology, guint index);
+
+/* only counts nodes that have at least one of our CPUs */
+guint cputopology_getNumNodes(CPUTopology* topology);
+/* the node at the given index, in the same order as the CPUs */
+gint cputopology_getNode(CPUTopology* topology, guint index);
+
+/* returns -1 if the CPU is unknown */
+gint cputopology_getNodeOfCPU(CPUTopology* topology, gint cpu);
+/* CPUs that share an L3 cache have the same cache domain, which is the lowest
+ * of their CPU numbers. returns -1 if the CPU or its cache is unknown */
+gint cputopology_getCacheDomainOfCPU(CPUTopology* topology, gint cpu);
+
+#endif /* SHD_CPU_TOPOLOGY_H_ */
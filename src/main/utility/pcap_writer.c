@@ -136,7 +136,7 @@ void pcapwriter_writePacket(PCapWriter* pcap, PCapPacket* packet) {
     }
 }
 
-PCapWriter* pcapwriter_new(gchar* pcapDirectory, gchar* pcapFilename) {
+PCapWriter* pcapwriter_new(const gchar* pcapDirectory, gchar* pcapFilename) {
     PCapWriter* pcap = g_new0(PCapWriter, 1);
 
     /* open the PCAP file for writing */
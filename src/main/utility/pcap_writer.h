@@ -45,7 +45,7 @@ struct _PCapPacket {
     gpointer payload;
 };
 
-PCapWriter* pcapwriter_new(gchar* pcapDirectory, gchar* pcapFilename);
+PCapWriter* pcapwriter_new(const gchar* pcapDirectory, gchar* pcapFilename);
 void pcapwriter_free(PCapWriter* pcap);
 void pcapwriter_writePacket(PCapWriter* pcap, PCapPacket* packet);
 
@@ -0,0 +1,201 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include <glib.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "main/utility/round_barrier.h"
+#include "main/utility/utility.h"
+
+/* how many arrivals are combined in each node of the tree */
+#define ROUND_BARRIER_FANIN 4
+/* how many times a waiter polls the barrier before it goes to sleep */
+#define ROUND_BARRIER_SPIN_LIMIT 4096
+#define ROUND_BARRIER_CACHE_LINE 64
+
+typedef struct _RoundBarrierNode RoundBarrierNode;
+struct _RoundBarrierNode {
+    /* the arrivals still missing at this node in the current round */
+    guint remaining;
+    /* the number of parties or nodes that arrive at this node */
+    guint numChildren;
+    /* the minimum of the values that arrived here in the current round */
+    guint64 value;
+    /* NULL for the root */
+    RoundBarrierNode* parent;
+} __attribute__((aligned(ROUND_BARRIER_CACHE_LINE)));
+
+struct _RoundBarrier {
+    guint numParties;
+    gboolean hasController;
+    RoundBarrierCompletionFunc onCompletion;
+    gpointer userData;
+
+    /* the leaves come first, followed by each higher level of the tree */
+    RoundBarrierNode* nodes;
+
+    /* the reduced value of the last completed round */
+    guint64 result;
+
+    /* the sense of the round flips when everyone arrived, and again when the
+     * parties are released. both are used as futex words. */
+    gint arrivalSense __attribute__((aligned(ROUND_BARRIER_CACHE_LINE)));
+    gint numArrivalSleepers;
+    gint releaseSense __attribute__((aligned(ROUND_BARRIER_CACHE_LINE)));
+    gint numReleaseSleepers;
+};
+
+static void _roundbarrier_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static void _roundbarrier_wait(gint* sense, gint oldSense, gint* numSleepers) {
+    for(guint i = 0; i < ROUND_BARRIER_SPIN_LIMIT; i++) {
+        if(__atomic_load_n(sense, __ATOMIC_ACQUIRE) != oldSense) {
+            return;
+        }
+        _roundbarrier_relax();
+    }
+
+    /* the sleeper count lets the waker skip the syscall when nobody is asleep.
+     * the futex rechecks the sense, so we can not miss the wakeup. */
+    __atomic_add_fetch(numSleepers, 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(sense, __ATOMIC_SEQ_CST) == oldSense) {
+        syscall(SYS_futex, sense, FUTEX_WAIT_PRIVATE, oldSense, NULL, NULL, 0);
+    }
+    __atomic_sub_fetch(numSleepers, 1, __ATOMIC_SEQ_CST);
+}
+
+static void _roundbarrier_set(gint* sense, gint newSense, gint* numSleepers) {
+    __atomic_store_n(sense, newSense, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(numSleepers, __ATOMIC_SEQ_CST) > 0) {
+        syscall(SYS_futex, sense, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+static void _roundbarrier_updateMin(guint64* target, guint64 value) {
+    guint64 current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while(value < current &&
+            !__atomic_compare_exchange_n(target, &current, value, TRUE,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        /* current was reloaded, try again */
+    }
+}
+
+RoundBarrier* roundbarrier_new(guint numParties, gboolean hasController,
+        RoundBarrierCompletionFunc onCompletion, gpointer userData) {
+    utility_assert(numParties > 0);
+
+    RoundBarrier* barrier = g_new0(RoundBarrier, 1);
+    barrier->numParties = numParties;
+    barrier->hasController = hasController;
+    barrier->onCompletion = onCompletion;
+    barrier->userData = userData;
+    barrier->result = G_MAXUINT64;
+
+    guint numNodes = 0;
+    guint width = numParties;
+    do {
+        width = (width + ROUND_BARRIER_FANIN - 1) / ROUND_BARRIER_FANIN;
+        numNodes += width;
+    } while(width > 1);
+
+    barrier->nodes = g_new0(RoundBarrierNode, numNodes);
+
+    /* build the tree one level at a time, starting from the leaves */
+    RoundBarrierNode* level = barrier->nodes;
+    guint numChildren = numParties;
+    while(TRUE) {
+        width = (numChildren + ROUND_BARRIER_FANIN - 1) / ROUND_BARRIER_FANIN;
+
+        for(guint i = 0; i < width; i++) {
+            RoundBarrierNode* node = &level[i];
+            node->numChildren = MIN(ROUND_BARRIER_FANIN, numChildren - (i * ROUND_BARRIER_FANIN));
+            node->remaining = node->numChildren;
+            node->value = G_MAXUINT64;
+            node->parent = (width > 1) ? &level[width + (i / ROUND_BARRIER_FANIN)] : NULL;
+        }
+
+        if(width == 1) {
+            break;
+        }
+
+        level += width;
+        numChildren = width;
+    }
+
+    return barrier;
+}
+
+void roundbarrier_free(RoundBarrier* barrier) {
+    utility_assert(barrier);
+    g_free(barrier->nodes);
+    g_free(barrier);
+}
+
+guint64 roundbarrier_arriveAndAwait(RoundBarrier* barrier, guint partyID, guint64 value) {
+    utility_assert(barrier);
+    utility_assert(partyID < barrier->numParties);
+
+    /* the round can not be released before we arrive, so this is the sense
+     * of the round we are arriving in */
+    gint sense = __atomic_load_n(&barrier->releaseSense, __ATOMIC_ACQUIRE);
+
+    RoundBarrierNode* node = &barrier->nodes[partyID / ROUND_BARRIER_FANIN];
+    while(node) {
+        _roundbarrier_updateMin(&node->value, value);
+
+        if(__atomic_sub_fetch(&node->remaining, 1, __ATOMIC_ACQ_REL) > 0) {
+            /* the last one to arrive at this node carries it up the tree */
+            _roundbarrier_wait(&barrier->releaseSense, sense, &barrier->numReleaseSleepers);
+            return __atomic_load_n(&barrier->result, __ATOMIC_RELAXED);
+        }
+
+        /* nobody else touches this node until the round is released */
+        value = __atomic_load_n(&node->value, __ATOMIC_RELAXED);
+        node->value = G_MAXUINT64;
+        node->remaining = node->numChildren;
+        node = node->parent;
+    }
+
+    /* everyone arrived */
+    if(barrier->onCompletion) {
+        barrier->onCompletion(barrier->userData, value);
+    }
+    __atomic_store_n(&barrier->result, value, __ATOMIC_RELAXED);
+    _roundbarrier_set(&barrier->arrivalSense, !sense, &barrier->numArrivalSleepers);
+
+    if(barrier->hasController) {
+        _roundbarrier_wait(&barrier->releaseSense, sense, &barrier->numReleaseSleepers);
+    } else {
+        _roundbarrier_set(&barrier->releaseSense, !sense, &barrier->numReleaseSleepers);
+    }
+
+    return value;
+}
+
+guint64 roundbarrier_awaitArrivals(RoundBarrier* barrier) {
+    utility_assert(barrier && barrier->hasController);
+
+    /* only the controller changes the release sense */
+    gint sense = barrier->releaseSense;
+    _roundbarrier_wait(&barrier->arrivalSense, sense, &barrier->numArrivalSleepers);
+
+    return __atomic_load_n(&barrier->result, __ATOMIC_RELAXED);
+}
+
+void roundbarrier_release(RoundBarrier* barrier) {
+    utility_assert(barrier && barrier->hasController);
+
+    gint sense = __atomic_load_n(&barrier->arrivalSense, __ATOMIC_ACQUIRE);
+    utility_assert(sense != barrier->releaseSense);
+
+    _roundbarrier_set(&barrier->releaseSense, sense, &barrier->numReleaseSleepers);
+}
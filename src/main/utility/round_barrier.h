@@ -0,0 +1,41 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_ROUND_BARRIER_H_
+#define SHD_ROUND_BARRIER_H_
+
+#include <glib.h>
+
+/* A reusable barrier for a fixed set of parties that also computes the
+ * minimum of a value contributed by each party. Arrivals are combined in a
+ * small tree so that parties mostly touch different cache lines, and waiters
+ * spin for a short while before sleeping on a futex.
+ *
+ * The barrier may optionally be held by a controller thread (that is not one
+ * of the parties): once everyone arrived, the controller is woken with the
+ * reduced value and the parties stay blocked until the controller releases
+ * them. Without a controller, the last party to arrive releases the others. */
+typedef struct _RoundBarrier RoundBarrier;
+
+/* if given, this is run by the last party to arrive, with the reduced value,
+ * before anyone is released or the controller is woken */
+typedef void (*RoundBarrierCompletionFunc)(gpointer userData, guint64 value);
+
+RoundBarrier* roundbarrier_new(guint numParties, gboolean hasController,
+        RoundBarrierCompletionFunc onCompletion, gpointer userData);
+void roundbarrier_free(RoundBarrier* barrier);
+
+/* called by a party, which must pass a partyID in [0, numParties).
+ * blocks until the barrier is released, and returns the minimum value
+ * contributed by all parties in this round */
+guint64 roundbarrier_arriveAndAwait(RoundBarrier* barrier, guint partyID, guint64 value);
+
+/* called by the controller to wait until all parties arrived; returns the
+ * minimum value contributed by all parties in this round */
+guint64 roundbarrier_awaitArrivals(RoundBarrier* barrier);
+/* called by the controller to let the parties continue past the barrier */
+void roundbarrier_release(RoundBarrier* barrier);
+
+#endif /* SHD_ROUND_BARRIER_H_ */
@@ -6,12 +6,16 @@
 
 #include <errno.h>
 #include <execinfo.h>
+#include <fcntl.h>
 #include <glib/gstdio.h>
+#include <linux/fs.h>
 #include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include "main/utility/utility.h"
@@ -181,17 +185,133 @@ gboolean utility_removeAll(const gchar* path) {
     return isSuccess;
 }
 
-/* destructive copy that will remove dst path if it exists */
-gboolean utility_copyAll(const gchar* srcPath, const gchar* dstPath) {
-    if(!dstPath || !srcPath || !g_file_test(srcPath, G_FILE_TEST_EXISTS)) {
+typedef struct _CopyJob CopyJob;
+struct _CopyJob {
+    gchar* srcPath;
+    gchar* dstPath;
+    mode_t mode;
+};
+
+static CopyJob* _utility_newCopyJob(const gchar* srcPath, const gchar* dstPath, mode_t mode) {
+    CopyJob* job = g_new0(CopyJob, 1);
+    job->srcPath = g_strdup(srcPath);
+    job->dstPath = g_strdup(dstPath);
+    job->mode = mode;
+    return job;
+}
+
+static void _utility_freeCopyJob(CopyJob* job) {
+    g_free(job->srcPath);
+    g_free(job->dstPath);
+    g_free(job);
+}
+
+/* streams the file in the kernel, without passing the data through our memory.
+ * returns FALSE if the kernel or filesystem does not support it. */
+static gboolean _utility_copyFileRange(gint srcFD, gint dstFD, gsize length) {
+#ifdef SYS_copy_file_range
+    gsize remaining = length;
+    while(remaining > 0) {
+        gssize result = (gssize)syscall(SYS_copy_file_range, srcFD, NULL, dstFD, NULL, remaining, 0);
+        if(result < 0 && errno == EINTR) {
+            continue;
+        } else if(result <= 0) {
+            /* e.g. ENOSYS, EXDEV, or EINVAL, or the file got shorter */
+            return FALSE;
+        }
+        remaining -= (gsize)result;
+    }
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/* the old way: the whole file goes through memory */
+static gboolean _utility_readWriteFile(const gchar* srcPath, const gchar* dstPath) {
+    gchar* srcContents = NULL;
+    gsize srcLength = 0;
+    GError* err = NULL;
+
+    gboolean isSuccess = g_file_get_contents(srcPath, &srcContents, &srcLength, &err);
+
+    if(isSuccess && !err) {
+        isSuccess = g_file_set_contents(dstPath, srcContents, (gssize)srcLength, &err);
+    }
+
+    if(srcContents) {
+        g_free(srcContents);
+    }
+
+    if(err) {
+        warning("unable to copy file '%s': error %i: %s", srcPath, err->code, err->message);
+        g_error_free(err);
         return FALSE;
     }
 
-    /* if destination already exists, delete it */
-    if(g_file_test(dstPath, G_FILE_TEST_EXISTS) && !utility_removeAll(dstPath)) {
+    return isSuccess;
+}
+
+/* shares the extents of the source file if the filesystem supports reflinks
+ * (e.g. btrfs or xfs), so that blocks are only copied once they are written.
+ * otherwise, the file is streamed with copy_file_range, and if that fails too
+ * we read and write the whole file. */
+static gboolean _utility_copyFileFast(const gchar* srcPath, const gchar* dstPath, mode_t mode) {
+    const gchar* method = NULL;
+
+    gint srcFD = g_open(srcPath, O_RDONLY|O_CLOEXEC, 0);
+    if(srcFD >= 0) {
+        struct stat statbuf;
+        memset(&statbuf, 0, sizeof(struct stat));
+
+        /* make sure we can write it, we fix the mode when we are done */
+        gint dstFD = -1;
+        if(fstat(srcFD, &statbuf) == 0) {
+            dstFD = g_open(dstPath, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, (mode & 0777) | S_IWUSR);
+        }
+
+        if(dstFD >= 0) {
+#ifdef FICLONE
+            if(ioctl(dstFD, FICLONE, srcFD) == 0) {
+                method = "cloned";
+            }
+#endif
+            if(!method && _utility_copyFileRange(srcFD, dstFD, (gsize)statbuf.st_size)) {
+                method = "streamed";
+            }
+            close(dstFD);
+        }
+        close(srcFD);
+    }
+
+    if(!method) {
+        if(!_utility_readWriteFile(srcPath, dstPath)) {
+            return FALSE;
+        }
+        method = "copied";
+    }
+
+    if(g_chmod(dstPath, mode) != 0) {
+        warning("unable to chmod dst path '%s': error %i: %s", dstPath, errno, strerror(errno));
         return FALSE;
     }
 
+    info("%s path '%s' to '%s'", method, srcPath, dstPath);
+    return TRUE;
+}
+
+static void _utility_runCopyJob(CopyJob* job, gint* numFailures) {
+    if(!_utility_copyFileFast(job->srcPath, job->dstPath, job->mode)) {
+        g_atomic_int_inc(numFailures);
+    }
+    _utility_freeCopyJob(job);
+}
+
+/* creates the directories right away, but only collects the files so that we
+ * can copy them in parallel. the directories are prepended to dirJobs, so the
+ * children come before their parents. */
+static gboolean _utility_collectCopyJobs(const gchar* srcPath, const gchar* dstPath,
+        GQueue* fileJobs, GQueue* dirJobs) {
     /* get file/dir mode */
     struct stat statbuf;
     memset(&statbuf, 0, sizeof(struct stat));
@@ -200,73 +320,108 @@ gboolean utility_copyAll(const gchar* srcPath, const gchar* dstPath) {
         return FALSE;
     }
 
-    /* now create the dir or copy the file */
-    if(g_file_test(srcPath, G_FILE_TEST_IS_DIR)) {
-        /* create new dir with same mode as the old */
-        if(g_mkdir(dstPath, statbuf.st_mode) != 0) {
-            warning("unable to make dst path '%s': error %i: %s", dstPath, errno, strerror(errno));
-            return FALSE;
-        } else {
-            /* now recurse into this directory */
-            GError* err = NULL;
-            GDir* dir = g_dir_open(srcPath, 0, &err);
-
-            if(err) {
-                warning("unable to open directory '%s': error %i: %s", srcPath, err->code, err->message);
-                return FALSE;
-            } else {
-                gboolean isSuccess = TRUE;
-
-                const gchar* entry = NULL;
-                while((entry = g_dir_read_name(dir)) != NULL) {
-                    gchar* srcChildPath = g_build_filename(srcPath, entry, NULL);
-                    gchar* dstChildPath = g_build_filename(dstPath, entry, NULL);
-                    isSuccess = utility_copyAll(srcChildPath, dstChildPath);
-                    g_free(srcChildPath);
-                    g_free(dstChildPath);
-                    if(!isSuccess) {
-                        break;
-                    }
-                }
+    if(!g_file_test(srcPath, G_FILE_TEST_IS_DIR)) {
+        g_queue_push_tail(fileJobs, _utility_newCopyJob(srcPath, dstPath, statbuf.st_mode));
+        return TRUE;
+    }
 
-                g_dir_close(dir);
+    /* create new dir that we can write into, the mode is set when we are done */
+    if(g_mkdir(dstPath, statbuf.st_mode | S_IRWXU) != 0) {
+        warning("unable to make dst path '%s': error %i: %s", dstPath, errno, strerror(errno));
+        return FALSE;
+    }
+    g_queue_push_head(dirJobs, _utility_newCopyJob(srcPath, dstPath, statbuf.st_mode));
 
-                if(!isSuccess) {
-                    return FALSE;
-                }
-            }
-        }
-    } else {
-        gchar* srcContents = NULL;
-        gsize srcLength = 0;
-        GError* err = NULL;
+    /* now recurse into this directory */
+    GError* err = NULL;
+    GDir* dir = g_dir_open(srcPath, 0, &err);
 
-        gboolean isSuccess = g_file_get_contents(srcPath, &srcContents, &srcLength, &err);
+    if(err) {
+        warning("unable to open directory '%s': error %i: %s", srcPath, err->code, err->message);
+        g_error_free(err);
+        return FALSE;
+    }
 
-        if(isSuccess && !err) {
-            isSuccess = g_file_set_contents(dstPath, srcContents, (gssize)srcLength, &err);
-            if(isSuccess & !err) {
-                info("copied path '%s' to '%s'", srcPath, dstPath);
-            }
-        }
+    gboolean isSuccess = TRUE;
 
-        if(srcContents) {
-            g_free(srcContents);
+    const gchar* entry = NULL;
+    while((entry = g_dir_read_name(dir)) != NULL) {
+        gchar* srcChildPath = g_build_filename(srcPath, entry, NULL);
+        gchar* dstChildPath = g_build_filename(dstPath, entry, NULL);
+        isSuccess = _utility_collectCopyJobs(srcChildPath, dstChildPath, fileJobs, dirJobs);
+        g_free(srcChildPath);
+        g_free(dstChildPath);
+        if(!isSuccess) {
+            break;
         }
+    }
 
-        if(err) {
-            warning("unable to read file '%s': error %i: %s", srcPath, err->code, err->message);
-            g_error_free(err);
-            return FALSE;
-        }
+    g_dir_close(dir);
+    return isSuccess;
+}
+
+/* destructive copy that will remove dst path if it exists */
+gboolean utility_copyAll(const gchar* srcPath, const gchar* dstPath) {
+    if(!dstPath || !srcPath || !g_file_test(srcPath, G_FILE_TEST_EXISTS)) {
+        return FALSE;
     }
 
-    if(g_chmod(dstPath, statbuf.st_mode) != 0) {
-        warning("unable to chmod dst path '%s': error %i: %s", dstPath, errno, strerror(errno));
+    /* if destination already exists, delete it */
+    if(g_file_test(dstPath, G_FILE_TEST_EXISTS) && !utility_removeAll(dstPath)) {
         return FALSE;
     }
 
-    return TRUE;
+    GQueue* fileJobs = g_queue_new();
+    GQueue* dirJobs = g_queue_new();
+
+    gboolean isSuccess = _utility_collectCopyJobs(srcPath, dstPath, fileJobs, dirJobs);
+
+    gint numFailures = 0;
+    guint numFiles = g_queue_get_length(fileJobs);
+    guint numThreads = MIN(MIN(numFiles, g_get_num_processors()), CONFIG_TEMPLATE_COPY_THREADS);
+
+    GThreadPool* pool = NULL;
+    if(isSuccess && numThreads > 1) {
+        pool = g_thread_pool_new((GFunc)_utility_runCopyJob, &numFailures,
+                (gint)numThreads, TRUE, NULL);
+    }
+
+    CopyJob* job = NULL;
+    while((job = g_queue_pop_head(fileJobs)) != NULL) {
+        if(!isSuccess) {
+            _utility_freeCopyJob(job);
+        } else if(pool) {
+            g_thread_pool_push(pool, job, NULL);
+        } else {
+            _utility_runCopyJob(job, &numFailures);
+        }
+    }
+
+    if(pool) {
+        /* waits for all of the copies to finish */
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
+
+    if(g_atomic_int_get(&numFailures) > 0) {
+        isSuccess = FALSE;
+    }
+
+    /* the files are in place, so the directories can get their real modes */
+    while((job = g_queue_pop_head(dirJobs)) != NULL) {
+        if(isSuccess && g_chmod(job->dstPath, job->mode) != 0) {
+            warning("unable to chmod dst path '%s': error %i: %s", job->dstPath, errno, strerror(errno));
+            isSuccess = FALSE;
+        }
+        _utility_freeCopyJob(job);
+    }
+
+    g_queue_free(fileJobs);
+    g_queue_free(dirJobs);
+
+    if(isSuccess) {
+        info("copied %u files from '%s' to '%s' using %u threads", numFiles, srcPath, dstPath, MAX(numThreads, 1));
+    }
+    return isSuccess;
 }
 
 GString* utility_getFileContents(const gchar* fileName) {
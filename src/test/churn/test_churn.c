@@ -0,0 +1,57 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* every process must start with this state, no matter what earlier processes
+ * of the same plugin on the same host did with it */
+static int initialized_data = 42;
+static char initialized_string[] = "fresh";
+static int zeroed_data;
+static __thread int thread_data = 7;
+static int constructor_calls;
+
+__attribute__((constructor)) static void _test_churn_init() {
+    constructor_calls++;
+}
+
+static int _check_int(const char* name, int value, int expected) {
+    if(value != expected) {
+        fprintf(stdout, "%s is %i instead of %i\n", name, value, expected);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int result = 0;
+
+    result |= _check_int("initialized_data", initialized_data, 42);
+    result |= _check_int("zeroed_data", zeroed_data, 0);
+    result |= _check_int("thread_data", thread_data, 7);
+    result |= _check_int("constructor_calls", constructor_calls, 1);
+    if(strcmp(initialized_string, "fresh") != 0) {
+        fprintf(stdout, "initialized_string is '%s' instead of 'fresh'\n", initialized_string);
+        result = -1;
+    }
+
+    if(result != 0) {
+        fprintf(stdout, "########## churn test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    /* leave a mess behind for the next process */
+    initialized_data = -1;
+    zeroed_data = -1;
+    thread_data = -1;
+    constructor_calls = -1;
+    strcpy(initialized_string, "stale");
+
+    fprintf(stdout, "########## churn test passed! ##########\n");
+    return EXIT_SUCCESS;
+}
@@ -334,6 +334,68 @@ static void _test_fstat() {
     fclose(file);
 }
 
+static void _test_write_then_observe() {
+    g_auto(TmpFile) tf = tmpfile_make("testfile", "");
+
+    /* other descriptors to the same file, opened before the write */
+    int filed, otherfd, dupfd;
+    assert_nonneg_errno(filed = open("testfile", O_RDWR));
+    assert_nonneg_errno(otherfd = open("testfile", O_RDONLY));
+    assert_nonneg_errno(dupfd = dup(filed));
+    assert_nonneg_errno(write(filed, "abc", 3));
+
+    /* the size includes what was just written, however we ask for it */
+    struct stat filestat = {0};
+    assert_nonneg_errno(fstat(filed, &filestat));
+    g_assert_cmpint(filestat.st_size, ==, 3);
+    assert_nonneg_errno(stat("testfile", &filestat));
+    g_assert_cmpint(filestat.st_size, ==, 3);
+    assert_nonneg_errno(write(filed, "d", 1));
+    assert_nonneg_errno(fstat(dupfd, &filestat));
+    g_assert_cmpint(filestat.st_size, ==, 4);
+
+    /* and the data can be read through any of the descriptors */
+    char buf[20] = {0};
+    assert_nonneg_errno(write(filed, "e", 1));
+    assert_nonneg_errno(pread(otherfd, buf, sizeof(buf) - 1, 0));
+    g_assert_cmpstr(buf, ==, "abcde");
+
+    int laterfd;
+    assert_nonneg_errno(write(filed, "f", 1));
+    assert_nonneg_errno(laterfd = open("testfile", O_RDONLY));
+    memset(buf, 0, sizeof(buf));
+    assert_nonneg_errno(read(laterfd, buf, sizeof(buf) - 1));
+    g_assert_cmpstr(buf, ==, "abcdef");
+    assert_nonneg_errno(close(laterfd));
+    assert_nonneg_errno(close(otherfd));
+    assert_nonneg_errno(close(dupfd));
+
+    /* stdio output on the same descriptor comes after it */
+    FILE* file;
+    assert_nonnull_errno(file = fdopen(filed, "r+"));
+    assert_nonneg_errno(fputs("ghi", file));
+    assert_nonneg_errno(fflush(file));
+    assert_nonneg_errno(write(filed, "jkl", 3));
+
+    memset(buf, 0, sizeof(buf));
+    assert_nonneg_errno(pread(filed, buf, 12, 0));
+    g_assert_cmpstr(buf, ==, "abcdefghijkl");
+
+    g_assert_cmpint(lseek(filed, 0, SEEK_CUR), ==, 12);
+
+    /* a write made before O_APPEND is turned on still lands where it was made */
+    g_assert_cmpint(lseek(filed, 0, SEEK_SET), ==, 0);
+    assert_nonneg_errno(write(filed, "ABC", 3));
+    assert_nonneg_errno(fcntl(filed, F_SETFL, O_APPEND));
+    assert_nonneg_errno(write(filed, "mno", 3));
+
+    memset(buf, 0, sizeof(buf));
+    assert_nonneg_errno(pread(filed, buf, 15, 0));
+    g_assert_cmpstr(buf, ==, "ABCdefghijklmno");
+
+    fclose(file);
+}
+
 static void _test_open_close() {
     g_auto(TmpFile) tf = tmpfile_make("testfile", "test");
 
@@ -355,6 +417,7 @@ int main(int argc, char* argv[]) {
     g_test_add_func("/file/fscanf", _test_fscanf);
     g_test_add_func("/file/chmod", _test_chmod);
     g_test_add_func("/file/fstat", _test_fstat);
+    g_test_add_func("/file/write_then_observe", _test_write_then_observe);
     g_test_run();
 
     return 0;
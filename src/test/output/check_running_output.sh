@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# Runs shadow in the background, and checks that the line the test process
+# writes first shows up in its stdout file while the simulation still runs.
+# The process waits until we create a file in the data directory, so shadow
+# only finishes once we found the line.
+# USAGE: check_running_output.sh DATA_DIRECTORY shadow [args...]
+
+set -euo pipefail
+
+DATA=$1
+shift
+
+rm -rf "$DATA"
+
+"$@" -d "$DATA" &
+SHADOW=$!
+
+FOUND=0
+while kill -0 $SHADOW 2>/dev/null; do
+    if grep -qs "^waiting for" "$DATA"/hosts/testnode/stdout-*.log; then
+        FOUND=1
+        touch "$DATA/output-done"
+        break
+    fi
+    sleep 0.1
+done
+
+wait $SHADOW
+
+if [ $FOUND -ne 1 ]; then
+    echo "the process output did not show up while shadow was running"
+    exit 1
+fi
+
+grep -q "output test passed" "$DATA"/hosts/testnode/stdout-*.log
@@ -0,0 +1,37 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* how long we wait for the test script to find our first line, in simulated
+ * time. the script finds it in wall clock time, so this is plenty. */
+#define MAX_WAIT_USECONDS 100000000000L
+#define WAIT_INTERVAL_USECONDS 10000L
+
+/* Writes a line to stdout, and then waits until the file at the given path
+ * exists. The test script only creates that file after it read our line
+ * from our stdout file, so this fails if our output stays buffered while we
+ * are running. */
+int main(int argc, char* argv[]) {
+    if(argc != 2) {
+        fprintf(stdout, "USAGE: %s DONE_PATH\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "waiting for %s\n", argv[1]);
+
+    for(long waited = 0; waited < MAX_WAIT_USECONDS; waited += WAIT_INTERVAL_USECONDS) {
+        if(access(argv[1], F_OK) == 0) {
+            fprintf(stdout, "########## output test passed! ##########\n");
+            return EXIT_SUCCESS;
+        }
+        usleep(WAIT_INTERVAL_USECONDS);
+    }
+
+    fprintf(stdout, "########## output test failed: %s was never created ##########\n", argv[1]);
+    return EXIT_FAILURE;
+}
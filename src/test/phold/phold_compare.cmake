@@ -0,0 +1,13 @@
+## compares the peer logs of the phold run in COMPARE_DIR against those in REFERENCE_DIR
+macro(EXEC_DIFF_CHECK FILE1 FILE2)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${FILE1} ${FILE2} RESULT_VARIABLE RESULT OUTPUT_VARIABLE OUTPUT)
+    if(RESULT)
+        message(FATAL_ERROR "Error in diff: ${OUTPUT}")
+    endif()
+endmacro()
+foreach(LOOPIDX RANGE 1 10)
+	exec_diff_check(
+		${REFERENCE_DIR}/hosts/peer${LOOPIDX}/stdout-peer${LOOPIDX}.testphold.1000.log
+		${COMPARE_DIR}/hosts/peer${LOOPIDX}/stdout-peer${LOOPIDX}.testphold.1000.log
+	)
+endforeach(LOOPIDX)
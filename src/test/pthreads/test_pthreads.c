@@ -3,11 +3,13 @@
  * See LICENSE for licensing information
  */
 
+#include <errno.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define NUM_THREADS 5
 
@@ -16,6 +18,13 @@ struct mux_sum {
     int* sum;
 };
 
+/* the main thread holds the lock until it sets released */
+struct lock_wait {
+    pthread_mutex_t* mux;
+    pthread_rwlock_t* rwlock;
+    int released;
+};
+
 struct mux_try {
     pthread_mutex_t mux1;
     pthread_mutex_t mux2;
@@ -103,6 +112,87 @@ static void* _test_thread_muxtrylock(void* mx) {
     return NULL;
 }
 
+static void* _test_thread_muxtrybusy(void* mux) {
+    /* the main thread holds the mutex, so we must not get it */
+    intptr_t retval = 0;
+    if(pthread_mutex_trylock((pthread_mutex_t*)mux) != EBUSY) {
+        fprintf(stdout, "error: pthread_mutex_trylock did not return EBUSY\n");
+        retval = -1;
+    }
+    return (void*)retval;
+}
+
+static void* _test_thread_muxwait(void* data) {
+    intptr_t retval = 0;
+    struct lock_wait* lw = (struct lock_wait*)data;
+
+    /* the main thread holds the mutex, so we have to wait for it */
+    if(pthread_mutex_lock(lw->mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_lock failed\n");
+        return (void*)-1;
+    }
+
+    if(!lw->released) {
+        fprintf(stdout, "error: pthread_mutex_lock returned while the mutex was held\n");
+        retval = -1;
+    }
+
+    if(pthread_mutex_unlock(lw->mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_unlock failed\n");
+        retval = -1;
+    }
+
+    return (void*)retval;
+}
+
+static void* _test_thread_rwlockwait(void* data) {
+    intptr_t retval = 0;
+    struct lock_wait* lw = (struct lock_wait*)data;
+
+    /* the main thread holds a read lock, so we have to wait for it */
+    if(pthread_rwlock_wrlock(lw->rwlock) != 0) {
+        fprintf(stdout, "error: pthread_rwlock_wrlock failed\n");
+        return (void*)-1;
+    }
+
+    if(!lw->released) {
+        fprintf(stdout, "error: pthread_rwlock_wrlock returned while a read lock was held\n");
+        retval = -1;
+    }
+
+    if(pthread_rwlock_unlock(lw->rwlock) != 0) {
+        fprintf(stdout, "error: pthread_rwlock_unlock failed\n");
+        retval = -1;
+    }
+
+    return (void*)retval;
+}
+
+/* runs the thread while we hold the lock, and gives it time to wait for it */
+static int _test_releaseToWaiter(struct lock_wait* lw, void* (*waiter)(void*)) {
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, waiter, lw) != 0) {
+        fprintf(stdout, "error: pthread_create failed!\n");
+        return -1;
+    }
+
+    usleep(10000);
+    lw->released = 1;
+
+    int result = lw->mux ? pthread_mutex_unlock(lw->mux) : pthread_rwlock_unlock(lw->rwlock);
+    if(result != 0) {
+        fprintf(stdout, "error: unlocking the contended lock failed\n");
+        return -1;
+    }
+
+    intptr_t retval = 0;
+    if(pthread_join(thread, (void**)&retval) != 0 || retval != 0) {
+        fprintf(stdout, "error: the waiting thread failed\n");
+        return -1;
+    }
+    return 0;
+}
+
 static int _test_joinThreads(pthread_t* threads) {
     int* retval=NULL;
     long t;
@@ -277,6 +367,115 @@ fail2:
 fail1:
     return value_to_return;
 }
+/* locks a mutex that was set up with a static initializer, first without
+ * and then with another thread waiting for it */
+static int _test_mutex_static(pthread_mutex_t* mux, int isRecursive, const char* name) {
+    pthread_t thread;
+    intptr_t retval = 0;
+
+    if(pthread_mutex_lock(mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_lock failed on %s\n", name);
+        return -1;
+    }
+    if(isRecursive && pthread_mutex_trylock(mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_trylock failed to relock %s\n", name);
+        return -1;
+    }
+
+    if(pthread_create(&thread, NULL, _test_thread_muxtrybusy, mux) != 0 ||
+            pthread_join(thread, (void**)&retval) != 0 || retval != 0) {
+        fprintf(stdout, "error: another thread could lock %s while we held it\n", name);
+        return -1;
+    }
+
+    if(isRecursive && pthread_mutex_unlock(mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_unlock failed to unlock %s once\n", name);
+        return -1;
+    }
+    if(pthread_mutex_unlock(mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_unlock failed on %s\n", name);
+        return -1;
+    }
+
+    if(pthread_mutex_trylock(mux) != 0 || pthread_mutex_unlock(mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_trylock failed on the unlocked %s\n", name);
+        return -1;
+    }
+
+    struct lock_wait lw;
+    memset(&lw, 0, sizeof(struct lock_wait));
+    lw.mux = mux;
+    if(pthread_mutex_lock(mux) != 0 || _test_releaseToWaiter(&lw, _test_thread_muxwait) != 0) {
+        fprintf(stdout, "error: waiting for the contended %s failed\n", name);
+        return -1;
+    }
+
+    if(pthread_mutex_destroy(mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_destroy failed on %s\n", name);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _test_mutex_static_initializers() {
+    pthread_mutex_t normal = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_t recursive = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+    pthread_mutex_t errorcheck = PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP;
+    pthread_mutex_t adaptive = PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP;
+
+    if(_test_mutex_static(&normal, 0, "PTHREAD_MUTEX_INITIALIZER") < 0 ||
+            _test_mutex_static(&recursive, 1, "PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP") < 0 ||
+            _test_mutex_static(&errorcheck, 0, "PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP") < 0 ||
+            _test_mutex_static(&adaptive, 0, "PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP") < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _test_mutex_destroy_locked() {
+    pthread_mutex_t mux = PTHREAD_MUTEX_INITIALIZER;
+
+    if(pthread_mutex_lock(&mux) != 0) {
+        fprintf(stdout, "error: pthread_mutex_lock failed\n");
+        return -1;
+    }
+    if(pthread_mutex_destroy(&mux) != EBUSY) {
+        fprintf(stdout, "error: pthread_mutex_destroy did not return EBUSY on a locked mutex\n");
+        return -1;
+    }
+    if(pthread_mutex_unlock(&mux) != 0 || pthread_mutex_destroy(&mux) != 0) {
+        fprintf(stdout, "error: the mutex was not usable after pthread_mutex_destroy failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _test_rwlock_contended() {
+    pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+    /* we release our read lock while a writer waits for it */
+    struct lock_wait lw;
+    memset(&lw, 0, sizeof(struct lock_wait));
+    lw.rwlock = &rwlock;
+    if(pthread_rwlock_rdlock(&rwlock) != 0) {
+        fprintf(stdout, "error: pthread_rwlock_rdlock failed\n");
+        return -1;
+    }
+    if(_test_releaseToWaiter(&lw, _test_thread_rwlockwait) != 0) {
+        return -1;
+    }
+
+    if(pthread_rwlock_destroy(&rwlock) != 0) {
+        fprintf(stdout, "error: pthread_rwlock_destroy failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     fprintf(stdout, "########## pthreads test starting ##########\n");
 
@@ -298,6 +497,21 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    if(_test_mutex_static_initializers() < 0) {
+        fprintf(stdout, "########## _test_mutex_static_initializers() failed\n");
+        return -1;
+    }
+
+    if(_test_mutex_destroy_locked() < 0) {
+        fprintf(stdout, "########## _test_mutex_destroy_locked() failed\n");
+        return -1;
+    }
+
+    if(_test_rwlock_contended() < 0) {
+        fprintf(stdout, "########## _test_rwlock_contended() failed\n");
+        return -1;
+    }
+
     fprintf(stdout, "########## pthreads test passed! ##########\n");
     return 0;
 }
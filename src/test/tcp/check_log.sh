@@ -0,0 +1,17 @@
+#!/bin/bash
+
+# Runs shadow with the remaining arguments, and checks that its log contains
+# a line matching PATTERN, e.g. to show that a code path we test was taken.
+# USAGE: check_log.sh PATTERN shadow [args...]
+
+set -euo pipefail
+
+PATTERN=$1
+shift
+
+LOG=`mktemp`
+trap "rm -f $LOG" EXIT
+
+"$@" | tee $LOG
+
+grep -q "$PATTERN" $LOG
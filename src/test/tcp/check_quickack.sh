@@ -0,0 +1,48 @@
+#!/bin/bash
+
+# Runs shadow with the remaining arguments, and checks the cadence of the
+# delayed ACKs of each connection in its log. MODE is 'initial' if the first
+# 1000 ACKs of a connection are quick, or 'linux' if the quick ACKs come in
+# runs of at most 16 like in Linux's quick ACK mode.
+# USAGE: check_quickack.sh MODE shadow [args...]
+
+set -euo pipefail
+
+MODE=$1
+shift
+
+LOG=`mktemp`
+trap "rm -f $LOG" EXIT
+
+"$@" | tee $LOG
+
+sed -n 's/.*\] \([^ ]*\) <-> \([^ ]*\): delaying ACK by \([0-9]*\) ms.*/\1-\2 \3/p' $LOG | awk -v mode=$MODE '
+{
+    total++
+    if ($2 == 1) {
+        quick[$1]++
+        run[$1]++
+        if (mode == "initial" && delayed[$1] > 0) {
+            print "quick ACK on " $1 " after its ACKs were already delayed"; failed = 1
+        }
+        if (mode == "linux" && run[$1] > 16) {
+            print "more than 16 quick ACKs in a row on " $1; failed = 1
+        }
+    } else {
+        delayed[$1]++
+        run[$1] = 0
+        numDelayed++
+        if (mode == "initial" && quick[$1] != 1000) {
+            print "delayed ACK on " $1 " after " quick[$1]+0 " quick ACKs instead of 1000"; failed = 1
+        }
+    }
+}
+END {
+    if (total == 0) {
+        print "no delayed ACKs were logged"; failed = 1
+    }
+    if (mode == "linux" && numDelayed == 0) {
+        print "no ACKs were delayed after quick ACK mode ended"; failed = 1
+    }
+    exit failed
+}'
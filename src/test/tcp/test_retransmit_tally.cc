@@ -0,0 +1,244 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/* Drives the retransmit tally through random ack, sack, loss and retransmit
+ * sequences, and checks its lost ranges after every step against a reference
+ * model that keeps the same ranges with plain linear scans. */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glib.h>
+
+#include "main/host/descriptor/tcp_retransmit_tally.h"
+
+namespace {
+
+/* inserts value, merging it with every range it overlaps or touches */
+void ref_insert(Ranges *ranges, SeqRange value) {
+   Ranges result;
+   bool inserted = false;
+
+   for (const auto &range : *ranges) {
+      if (range.second < value.first) {
+         result.push_back(range);
+      } else if (value.second < range.first) {
+         if (!inserted) {
+            result.push_back(value);
+            inserted = true;
+         }
+         result.push_back(range);
+      } else {
+         value.first = std::min(value.first, range.first);
+         value.second = std::max(value.second, range.second);
+      }
+   }
+
+   if (!inserted) {
+      result.push_back(value);
+   }
+
+   *ranges = result;
+}
+
+Ranges ref_subtract(const Ranges &lhs, const Ranges &rhs) {
+   Ranges result = lhs;
+
+   for (const auto &cut : rhs) {
+      Ranges next;
+      for (const auto &range : result) {
+         if (cut.second <= range.first || range.second <= cut.first) {
+            next.push_back(range);
+            continue;
+         }
+         if (range.first < cut.first) {
+            next.emplace_back(range.first, cut.first);
+         }
+         if (cut.second < range.second) {
+            next.emplace_back(cut.second, range.second);
+         }
+      }
+      result = next;
+   }
+
+   return result;
+}
+
+struct RefTally {
+   SeqNum last_ack = -1;
+   std::size_t num_dupl_ack = 0;
+   Ranges marked_lost, sacked, retransmitted, lost;
+
+   void compute_lost() {
+      lost = ref_subtract(ref_subtract(marked_lost, sacked), retransmitted);
+   }
+
+   /* a new ack trims the first range if it lands inside it, and otherwise
+    * drops every range that ends at or before it */
+   void tidy(Ranges *ranges) {
+      if (ranges->empty()) {
+         return;
+      }
+
+      if (last_ack >= ranges->front().first && last_ack < ranges->front().second - 1) {
+         ranges->front().first = last_ack;
+      } else if (last_ack >= ranges->front().second - 1) {
+         Ranges kept;
+         for (const auto &range : *ranges) {
+            if (last_ack < range.second) {
+               kept.push_back(range);
+            }
+         }
+         *ranges = kept;
+      }
+   }
+
+   void update(std::uint32_t ack, bool is_dup) {
+      if (is_dup && ack == last_ack) {
+         num_dupl_ack++;
+      } else if (ack > last_ack) {
+         last_ack = ack;
+         num_dupl_ack = 0;
+         tidy(&marked_lost);
+         tidy(&sacked);
+         tidy(&retransmitted);
+      }
+
+      bool is_retransmitted = false;
+      for (const auto &range : retransmitted) {
+         is_retransmitted = is_retransmitted || (last_ack >= range.first && last_ack < range.second);
+      }
+
+      if (num_dupl_ack >= RetransmitTally::kDuplAckLostThresh && !is_retransmitted) {
+         ref_insert(&marked_lost, {last_ack, (std::uint32_t)last_ack + 1});
+         compute_lost();
+      }
+   }
+
+   void mark_sacked(const std::vector<int> &sequences) {
+      for (std::size_t i = 0; i < sequences.size();) {
+         std::size_t j = i + 1;
+         while (j < sequences.size() && sequences[j] == sequences[j - 1] + 1) {
+            j++;
+         }
+         ref_insert(&sacked, {sequences[i], sequences[j - 1] + 1});
+         i = j;
+      }
+   }
+
+   void mark_lost(std::uint32_t begin, std::uint32_t end) {
+      if (begin == end + 1) {
+         return;
+      }
+      if (begin == end) {
+         end += 1;
+      }
+      ref_insert(&marked_lost, {begin, end});
+      compute_lost();
+   }
+
+   void mark_retransmitted(std::uint32_t begin, std::uint32_t end) {
+      ref_insert(&retransmitted, {begin, end});
+      compute_lost();
+   }
+};
+
+bool lost_ranges_match(void *tally, const RefTally &ref) {
+   std::size_t n = retransmit_tally_num_lost_ranges(tally);
+   if (n != ref.lost.size()) {
+      return false;
+   }
+
+   std::vector<std::uint32_t> lost(2 * n);
+   retransmit_tally_populate_lost_ranges(tally, lost.data());
+   for (std::size_t i = 0; i < n; i++) {
+      if (lost[2 * i] != (std::uint32_t)ref.lost[i].first
+          || lost[2 * i + 1] != (std::uint32_t)ref.lost[i].second) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+   const int num_connections = 100;
+   const int num_steps = 2000;
+   std::mt19937 rng(12345);
+
+   for (int conn = 0; conn < num_connections; conn++) {
+      void *tally;
+      retransmit_tally_init(&tally);
+      RefTally ref;
+      std::uint32_t ack = 1;
+
+      for (int step = 0; step < num_steps; step++) {
+         /* the blocks stay within a window above the current ack, so that the
+          * ranges overlap, touch and get acked often */
+         switch (rng() % 6) {
+            case 0: {
+               ack += (rng() % 3 == 0) ? rng() % 40 : 0;
+               bool is_dup = rng() % 2;
+               retransmit_tally_update(tally, ack, ack + 500, is_dup);
+               ref.update(ack, is_dup);
+               break;
+            }
+            case 1: {
+               std::uint32_t begin = ack + rng() % 400;
+               std::uint32_t end = begin + rng() % 20;
+               retransmit_tally_mark_lost(tally, begin, end);
+               ref.mark_lost(begin, end);
+               break;
+            }
+            case 2: {
+               std::uint32_t begin = ack + rng() % 400;
+               std::uint32_t end = begin + 1 + rng() % 15;
+               retransmit_tally_mark_retransmitted(tally, begin, end);
+               ref.mark_retransmitted(begin, end);
+               break;
+            }
+            case 3: {
+               std::vector<int> sequences(rng() % 30);
+               int sequence = ack + rng() % 400;
+               GList *sacked = NULL;
+               for (auto &s : sequences) {
+                  sequence += (rng() % 4 == 0) ? 2 + rng() % 5 : 1;
+                  s = sequence;
+                  sacked = g_list_append(sacked, GINT_TO_POINTER(s));
+               }
+               retransmit_tally_mark_sacked(tally, sacked);
+               ref.mark_sacked(sequences);
+               g_list_free(sacked);
+               break;
+            }
+            case 4:
+               if (rng() % 20 == 0) {
+                  retransmit_tally_clear_retransmitted(tally);
+                  ref.retransmitted.clear();
+               }
+               break;
+            default:
+               retransmit_tally_update(tally, ack, ack + 500, true);
+               ref.update(ack, true);
+               break;
+         }
+
+         if (!lost_ranges_match(tally, ref)) {
+            std::fprintf(stderr, "lost ranges differ at connection %d step %d\n", conn, step);
+            return EXIT_FAILURE;
+         }
+      }
+
+      retransmit_tally_destroy(tally);
+   }
+
+   std::printf("retransmit tally matched the reference model\n");
+   return EXIT_SUCCESS;
+}
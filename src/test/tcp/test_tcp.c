@@ -25,9 +25,13 @@
 
 #include "test/test_glib_helpers.h"
 
-#define USAGE "USAGE: 'shd-test-tcp iomode type'; iomode=('blocking'|'nonblocking-poll'|'nonblocking-epoll'|'nonblocking-select') type=('client' server_ip|'server')"
+#define USAGE "USAGE: 'shd-test-tcp iomode type'; iomode=('blocking'|'nonblocking-poll'|'nonblocking-epoll'|'nonblocking-select'|'iov'|'bulk'|'bulk-slowread') type=('client' server_ip|'server')"
 #define MYLOG(...) _mylog(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__)
 #define BUFFERSIZE 20000
+// the bulk transfer is long enough for a flow to reach its steady state
+#define BULK_TRANSFER_SIZE (8*1024*1024)
+// the receive buffer of a server that reads the bulk transfer slowly
+#define BULK_SLOW_READ_BUFFER_SIZE 4096
 #define ARRAY_LENGTH(arr)  (sizeof (arr) / sizeof ((arr)[0]))
 // Env variable that contains the message queue id used for server port exchange
 #define MESSAGE_QUEUE_ID_ENV_NAME "QUEUE"
@@ -710,7 +714,94 @@ static int _test_iov_server(int clientfd)
     return 0;
 }
 
-static int _run_client(iowait_func iowait, const char* servername, const int use_iov, int message_queue) {
+/* the byte at the given offset of the bulk transfer */
+static char _bulk_byte(long offset) {
+    return (char)('a' + (offset % 26));
+}
+
+static int _test_bulk_client(int serverfd) {
+    char buf[BUFFERSIZE];
+    long offset = 0;
+
+    while(offset < BULK_TRANSFER_SIZE) {
+        int amount = (int)MIN((long)BUFFERSIZE, BULK_TRANSFER_SIZE - offset);
+        for(int i = 0; i < amount; i++) {
+            buf[i] = _bulk_byte(offset + i);
+        }
+
+        int sent = 0;
+        while(sent < amount) {
+            ssize_t n = send(serverfd, &buf[sent], (size_t)(amount - sent), 0);
+            if(n < 0) {
+                MYLOG("send() error was: %s", strerror(errno));
+                return -1;
+            }
+            sent += (int)n;
+        }
+        offset += amount;
+    }
+
+    MYLOG("sent %li/%i bytes", offset, BULK_TRANSFER_SIZE);
+
+    /* the server closes once it has everything */
+    if(shutdown(serverfd, SHUT_WR) < 0) {
+        MYLOG("shutdown() error was: %s", strerror(errno));
+        return -1;
+    }
+    ssize_t n = recv(serverfd, buf, sizeof(buf), 0);
+    if(n != 0) {
+        MYLOG("expected EOF from the server, recv() returned %li", (long)n);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _test_bulk_server(int clientfd, int slow_read) {
+    char buf[BUFFERSIZE];
+    long offset = 0;
+
+    if(slow_read) {
+        /* shrinking the receive buffer under the segments that are already in
+         * flight, and not draining it for a while, makes the client
+         * retransmit the segments that we had to drop */
+        int size = BULK_SLOW_READ_BUFFER_SIZE;
+        if(setsockopt(clientfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+            MYLOG("setsockopt() error was: %s", strerror(errno));
+            return -1;
+        }
+        sleep(1);
+    }
+
+    while(1) {
+        ssize_t n = recv(clientfd, buf, sizeof(buf), 0);
+        if(n < 0) {
+            MYLOG("recv() error was: %s", strerror(errno));
+            return -1;
+        } else if(n == 0) {
+            break;
+        }
+
+        for(ssize_t i = 0; i < n; i++) {
+            if(buf[i] != _bulk_byte(offset + i)) {
+                MYLOG("inconsistent byte at offset %li", offset + (long)i);
+                return -1;
+            }
+        }
+        offset += (long)n;
+    }
+
+    MYLOG("received %li/%i bytes %s", offset, BULK_TRANSFER_SIZE,
+            (offset == BULK_TRANSFER_SIZE) ? ":)" : ":(");
+    if(offset != BULK_TRANSFER_SIZE) {
+        MYLOG("we did not receive the expected number of bytes (%i)!", BULK_TRANSFER_SIZE);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _run_client(iowait_func iowait, const char* servername, const int use_iov, const int use_bulk, int message_queue) {
     struct sockaddr_in serveraddr;
     if(_do_addr(servername, &serveraddr, message_queue) < 0) {
         return -1;
@@ -726,7 +817,12 @@ static int _run_client(iowait_func iowait, const char* servername, const int use
         return -1;
     }
 
-    if (!use_iov) {
+    if (use_bulk) {
+        if (_test_bulk_client(serversd) < 0) {
+            return -1;
+        }
+    }
+    else if (!use_iov) {
         /* now prepare a message */
         char outbuf[BUFFERSIZE];
         memset(outbuf, 0, BUFFERSIZE);
@@ -766,7 +862,7 @@ static int _run_client(iowait_func iowait, const char* servername, const int use
     return 0;
 }
 
-static int _run_server(iowait_func iowait, int use_iov, int message_queue) {
+static int _run_server(iowait_func iowait, int use_iov, int use_bulk, int slow_read, int message_queue) {
     int listensd;
     int type = iowait ? (SOCK_STREAM|SOCK_NONBLOCK) : SOCK_STREAM;
     if(_do_socket(type, &listensd) < 0) {
@@ -784,7 +880,12 @@ static int _run_server(iowait_func iowait, int use_iov, int message_queue) {
         return -1;
     }
 
-    if (!use_iov) {
+    if (use_bulk) {
+        if (_test_bulk_server(clientsd, slow_read) < 0) {
+            return -1;
+        }
+    }
+    else if (!use_iov) {
         /* got one, now read the entire message */
         char buf[BUFFERSIZE];
         memset(buf, 0, BUFFERSIZE);
@@ -823,6 +924,8 @@ int main(int argc, char *argv[]) {
     const char *execution_mode = argv[2];
     iowait_func wait = NULL;
     int use_iov = 0;
+    int use_bulk = 0;
+    int slow_read = 0;
     int message_queue = get_msgqueue();
 
     if(strncasecmp(io_mode, "blocking", 8) == 0) {
@@ -836,6 +939,13 @@ int main(int argc, char *argv[]) {
     } else if(strncasecmp(io_mode, "iov", 3) == 0) {
         wait = NULL;
         use_iov = 1;
+    } else if(strncasecmp(io_mode, "bulk-slowread", 13) == 0) {
+        wait = NULL;
+        use_bulk = 1;
+        slow_read = 1;
+    } else if(strncasecmp(io_mode, "bulk", 4) == 0) {
+        wait = NULL;
+        use_bulk = 1;
     } else {
         MYLOG("error, invalid iomode specified; see usage");
         return -1;
@@ -848,10 +958,10 @@ int main(int argc, char *argv[]) {
             return -1;
         }
         MYLOG("running client in mode %s", io_mode);
-        result = _run_client(wait, argv[3], use_iov, message_queue);
+        result = _run_client(wait, argv[3], use_iov, use_bulk, message_queue);
     } else if(strncasecmp(execution_mode, "server", 6) == 0) {
         MYLOG("running server in mode %s", io_mode);
-        result = _run_server(wait, use_iov, message_queue);
+        result = _run_server(wait, use_iov, use_bulk, slow_read, message_queue);
     } else {
         MYLOG("error, invalid type specified; see usage");
         result = -1;
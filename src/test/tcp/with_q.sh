@@ -10,4 +10,4 @@ export QUEUE=`ipcmk --queue | sed 's/[^0-9]*//g'`
 trap "ipcrm -q $QUEUE" EXIT
 
 # Interpret remaining args as a command to run:
-$@
+"$@"
@@ -12,6 +12,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "test/test_glib_helpers.h"
@@ -138,6 +139,202 @@ static void test_echo() {
     assert_nonneg_errno(close(client_sock));
 }
 
+static void test_sendmmsg_recvmmsg() {
+    int client_sock, server_sock;
+    struct sockaddr_in addr = {0};
+    _udp_socketpair(&client_sock, &server_sock, &addr);
+
+    enum { NUM_MESSAGES = 4, MESSAGE_SIZE = 100 };
+    char client_send_bufs[NUM_MESSAGES][MESSAGE_SIZE];
+    struct iovec send_iovs[NUM_MESSAGES][2];
+    struct mmsghdr send_msgs[NUM_MESSAGES];
+    memset(send_msgs, 0, sizeof(send_msgs));
+
+    /* split each datagram over two iovecs to exercise gathering */
+    for (int i = 0; i < NUM_MESSAGES; i++) {
+        memset(client_send_bufs[i], i + 1, MESSAGE_SIZE);
+        send_iovs[i][0] = (struct iovec){client_send_bufs[i], MESSAGE_SIZE / 2};
+        send_iovs[i][1] = (struct iovec){client_send_bufs[i] + MESSAGE_SIZE / 2,
+                                         MESSAGE_SIZE / 2};
+        send_msgs[i].msg_hdr.msg_name = &addr;
+        send_msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+        send_msgs[i].msg_hdr.msg_iov = send_iovs[i];
+        send_msgs[i].msg_hdr.msg_iovlen = 2;
+    }
+
+    int sent;
+    assert_nonneg_errno(sent = sendmmsg(client_sock, send_msgs, NUM_MESSAGES, 0));
+    g_assert_cmpint(sent, ==, NUM_MESSAGES);
+    for (int i = 0; i < NUM_MESSAGES; i++) {
+        g_assert_cmpint(send_msgs[i].msg_len, ==, MESSAGE_SIZE);
+    }
+
+    char server_bufs[NUM_MESSAGES][MESSAGE_SIZE];
+    struct iovec recv_iovs[NUM_MESSAGES];
+    struct sockaddr_in recv_addrs[NUM_MESSAGES];
+    struct mmsghdr recv_msgs[NUM_MESSAGES];
+    memset(recv_msgs, 0, sizeof(recv_msgs));
+
+    for (int i = 0; i < NUM_MESSAGES; i++) {
+        recv_iovs[i] = (struct iovec){server_bufs[i], MESSAGE_SIZE};
+        recv_msgs[i].msg_hdr.msg_name = &recv_addrs[i];
+        recv_msgs[i].msg_hdr.msg_namelen = sizeof(recv_addrs[i]);
+        recv_msgs[i].msg_hdr.msg_iov = &recv_iovs[i];
+        recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    /* datagrams may trickle in, so keep going until we have all of them */
+    int received = 0;
+    while (received < NUM_MESSAGES) {
+        int recvd;
+        assert_nonneg_errno(recvd = recvmmsg(server_sock, &recv_msgs[received],
+                                             NUM_MESSAGES - received, 0, NULL));
+        g_assert_cmpint(recvd, >, 0);
+        received += recvd;
+    }
+
+    for (int i = 0; i < NUM_MESSAGES; i++) {
+        g_assert_cmpmem(server_bufs[i], recv_msgs[i].msg_len,
+                        client_send_bufs[i], MESSAGE_SIZE);
+        g_assert_cmpint(recv_msgs[i].msg_hdr.msg_namelen, ==,
+                        sizeof(struct sockaddr_in));
+        g_assert_cmpint(recv_addrs[i].sin_family, ==, AF_INET);
+    }
+
+    assert_nonneg_errno(close(server_sock));
+    assert_nonneg_errno(close(client_sock));
+}
+
+static void test_sendmmsg_recvmmsg_partial() {
+    int client_sock, server_sock;
+    struct sockaddr_in addr = {0};
+    _udp_socketpair(&client_sock, &server_sock, &addr);
+
+    char client_send_bufs[2][10];
+    struct iovec send_iovs[2];
+    struct mmsghdr send_msgs[2];
+    memset(send_msgs, 0, sizeof(send_msgs));
+    for (int i = 0; i < 2; i++) {
+        memset(client_send_bufs[i], i + 1, sizeof(client_send_bufs[i]));
+        send_iovs[i] = (struct iovec){client_send_bufs[i], sizeof(client_send_bufs[i])};
+        send_msgs[i].msg_hdr.msg_iov = &send_iovs[i];
+        send_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    /* the socket is not connected, so the second datagram has nowhere to go */
+    send_msgs[0].msg_hdr.msg_name = &addr;
+    send_msgs[0].msg_hdr.msg_namelen = sizeof(addr);
+
+    /* a partial batch succeeds, and the error is only reported by the next call */
+    errno = 0;
+    g_assert_cmpint(sendmmsg(client_sock, send_msgs, 2, 0), ==, 1);
+    assert_errno_is(0);
+    g_assert_cmpint(sendmmsg(client_sock, &send_msgs[1], 1, 0), ==, -1);
+    assert_errno_is(EDESTADDRREQ);
+
+    char server_bufs[2][10];
+    struct iovec recv_iovs[2];
+    struct mmsghdr recv_msgs[2];
+    memset(recv_msgs, 0, sizeof(recv_msgs));
+    for (int i = 0; i < 2; i++) {
+        recv_iovs[i] = (struct iovec){server_bufs[i], sizeof(server_bufs[i])};
+        recv_msgs[i].msg_hdr.msg_iov = &recv_iovs[i];
+        recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    /* wait for the one datagram, then there is nothing left for the second */
+    int received;
+    assert_nonneg_errno(received = recvmmsg(server_sock, recv_msgs, 1, 0, NULL));
+    g_assert_cmpint(received, ==, 1);
+    g_assert_cmpint(recvmmsg(server_sock, recv_msgs, 2, MSG_DONTWAIT, NULL), ==, -1);
+    assert_errno_is(EWOULDBLOCK);
+
+    assert_nonneg_errno(close(server_sock));
+    assert_nonneg_errno(close(client_sock));
+}
+
+static void test_sendmmsg_empty_datagrams() {
+    int client_sock, server_sock;
+    struct sockaddr_in addr = {0};
+    _udp_socketpair(&client_sock, &server_sock, &addr);
+
+    /* an empty datagram between two others, then one sent alone */
+    char client_send_bufs[3][10];
+    size_t send_lens[3] = {sizeof(client_send_bufs[0]), 0, sizeof(client_send_bufs[2])};
+    struct iovec send_iovs[3];
+    struct mmsghdr send_msgs[3];
+    memset(send_msgs, 0, sizeof(send_msgs));
+    for (int i = 0; i < 3; i++) {
+        memset(client_send_bufs[i], i + 1, sizeof(client_send_bufs[i]));
+        send_iovs[i] = (struct iovec){client_send_bufs[i], send_lens[i]};
+        send_msgs[i].msg_hdr.msg_name = &addr;
+        send_msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+        send_msgs[i].msg_hdr.msg_iov = &send_iovs[i];
+        send_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    g_assert_cmpint(sendmmsg(client_sock, send_msgs, 3, 0), ==, 3);
+    g_assert_cmpint(
+        sendto(client_sock, client_send_bufs[0], 0, 0, (struct sockaddr*)&addr, sizeof(addr)), ==, 0);
+
+    /* every datagram arrives, in order, including the empty ones */
+    size_t recv_lens[4] = {sizeof(client_send_bufs[0]), 0, sizeof(client_send_bufs[2]), 0};
+    for (int i = 0; i < 4; i++) {
+        char server_buf[10];
+        ssize_t received;
+        assert_nonneg_errno(received = recv(server_sock, server_buf, sizeof(server_buf), 0));
+        g_assert_cmpint(received, ==, recv_lens[i]);
+        if (received > 0) {
+            g_assert_cmpmem(server_buf, received, client_send_bufs[i], received);
+        }
+    }
+    g_assert_cmpint(recv(server_sock, NULL, 0, MSG_DONTWAIT), ==, -1);
+    assert_errno_is(EWOULDBLOCK);
+
+    assert_nonneg_errno(close(server_sock));
+    assert_nonneg_errno(close(client_sock));
+}
+
+static void test_loopback_order_and_overflow() {
+    int client_sock, server_sock;
+    struct sockaddr_in addr = {0};
+    _udp_socketpair(&client_sock, &server_sock, &addr);
+
+    /* far more small datagrams than a receive buffer holds, all sent before
+     * the server reads any of them */
+    const uint32_t num_sent = 4096;
+    for (uint32_t i = 0; i < num_sent; i++) {
+        ssize_t sent;
+        assert_nonneg_errno(sent = sendto(client_sock, &i, sizeof(i), 0, &addr, sizeof(addr)));
+        g_assert_cmpint(sent, ==, sizeof(i));
+    }
+
+    /* what fit arrives in the order it was sent, and the rest was dropped */
+    uint32_t num_received = 0;
+    while (1) {
+        uint32_t value;
+        ssize_t received = recv(server_sock, &value, sizeof(value), MSG_DONTWAIT);
+        if (received < 0) {
+            assert_errno_is(EWOULDBLOCK);
+            break;
+        }
+        g_assert_cmpint(received, ==, sizeof(value));
+        g_assert_cmpint(value, ==, num_received);
+        num_received++;
+    }
+    g_assert_cmpint(num_received, >, 0);
+    g_assert_cmpint(num_received, <, num_sent);
+
+    /* once there is room again, new datagrams are accepted */
+    uint32_t last = num_sent;
+    assert_nonneg_errno(sendto(client_sock, &last, sizeof(last), 0, &addr, sizeof(addr)));
+    uint32_t value = 0;
+    g_assert_cmpint(recv(server_sock, &value, sizeof(value), 0), ==, sizeof(value));
+    g_assert_cmpint(value, ==, last);
+
+    assert_nonneg_errno(close(server_sock));
+    assert_nonneg_errno(close(client_sock));
+}
+
 int main(int argc, char* argv[]) {
     g_test_init(&argc, &argv, NULL);
     g_test_add_func("/udp_uniprocess/create_socket", test_create_socket);
@@ -145,6 +342,10 @@ int main(int argc, char* argv[]) {
     g_test_add_func("/udp_uniprocess/getaddrinfo", test_getaddrinfo);
     g_test_add_func("/udp_uniprocess/sendto_one_byte", test_sendto_one_byte);
     g_test_add_func("/udp_uniprocess/echo", test_echo);
+    g_test_add_func("/udp_uniprocess/sendmmsg_recvmmsg", test_sendmmsg_recvmmsg);
+    g_test_add_func("/udp_uniprocess/sendmmsg_recvmmsg_partial", test_sendmmsg_recvmmsg_partial);
+    g_test_add_func("/udp_uniprocess/sendmmsg_empty_datagrams", test_sendmmsg_empty_datagrams);
+    g_test_add_func("/udp_uniprocess/loopback_order_and_overflow", test_loopback_order_and_overflow);
     g_test_run();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,194 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/* Pushes into the async priority queue from several threads at once, and
+ * checks the order, that duplicates are rejected, and the length that the
+ * consumer sees. */
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/utility/async_priority_queue.h"
+
+#define NUM_PRODUCERS 4
+/* more than one segment per producer */
+#define NUM_PER_PRODUCER 5000
+
+/* the queue asserts through this, so fail the test the same way */
+void utility_handleError(const gchar* file, gint line, const gchar* function, const gchar* message) {
+    fprintf(stderr, "**ERROR encountered**: At file %s line %i function %s: %s\n",
+            file, line, function, message);
+    abort();
+}
+
+typedef struct _ProducerArgs {
+    AsyncPriorityQueue* q;
+    gint* values;
+    gint numValues;
+    /* where this producer starts in values, so that the pushes interleave */
+    gint offset;
+    /* how many of our pushes added new data */
+    gint numAdded;
+} ProducerArgs;
+
+static gint _compare_values(const gint* a, const gint* b, gpointer userData) {
+    return (*a > *b) ? 1 : ((*a < *b) ? -1 : 0);
+}
+
+static gint* _new_values(gint numValues) {
+    gint* values = g_new(gint, numValues);
+    for(gint i = 0; i < numValues; i++) {
+        values[i] = i;
+    }
+    return values;
+}
+
+static void* _push_values(void* data) {
+    ProducerArgs* args = data;
+    args->numAdded = 0;
+    for(gint i = 0; i < args->numValues; i++) {
+        gint index = (args->offset + i) % args->numValues;
+        if(asyncpriorityqueue_push(args->q, &args->values[index])) {
+            args->numAdded++;
+        }
+    }
+    return NULL;
+}
+
+static void _run_producers(ProducerArgs* args) {
+    pthread_t threads[NUM_PRODUCERS];
+    for(gint i = 0; i < NUM_PRODUCERS; i++) {
+        g_assert_cmpint(pthread_create(&threads[i], NULL, _push_values, &args[i]), ==, 0);
+    }
+    for(gint i = 0; i < NUM_PRODUCERS; i++) {
+        g_assert_cmpint(pthread_join(threads[i], NULL), ==, 0);
+    }
+}
+
+/* pops everything left and checks that it comes out in order */
+static gint _pop_in_order(AsyncPriorityQueue* q) {
+    gint numPopped = 0;
+    gint last = -1;
+    gint* value = NULL;
+
+    while((value = asyncpriorityqueue_pop(q)) != NULL) {
+        g_assert_cmpint(*value, >, last);
+        last = *value;
+        numPopped++;
+    }
+
+    g_assert_true(asyncpriorityqueue_isEmpty(q));
+    g_assert_cmpint(asyncpriorityqueue_getLength(q), ==, 0);
+    return numPopped;
+}
+
+static void _test_distinct(void) {
+    const gint numValues = NUM_PRODUCERS * NUM_PER_PRODUCER;
+    gint* values = _new_values(numValues);
+    AsyncPriorityQueue* q = asyncpriorityqueue_new((GCompareDataFunc)_compare_values, NULL, NULL);
+
+    /* every producer pushes its own values, starting halfway through them */
+    ProducerArgs args[NUM_PRODUCERS];
+    for(gint i = 0; i < NUM_PRODUCERS; i++) {
+        args[i].q = q;
+        args[i].values = &values[i * NUM_PER_PRODUCER];
+        args[i].numValues = NUM_PER_PRODUCER;
+        args[i].offset = NUM_PER_PRODUCER / 2;
+    }
+    _run_producers(args);
+
+    for(gint i = 0; i < NUM_PRODUCERS; i++) {
+        g_assert_cmpint(args[i].numAdded, ==, NUM_PER_PRODUCER);
+    }
+    g_assert_cmpint(asyncpriorityqueue_getLength(q), ==, numValues);
+    g_assert_true(asyncpriorityqueue_peek(q) == &values[0]);
+    g_assert_true(asyncpriorityqueue_find(q, &values[numValues - 1]) == &values[numValues - 1]);
+    g_assert_cmpint(_pop_in_order(q), ==, numValues);
+
+    asyncpriorityqueue_free(q);
+    g_free(values);
+}
+
+static void _test_duplicates(void) {
+    gint* values = _new_values(NUM_PER_PRODUCER);
+    AsyncPriorityQueue* q = asyncpriorityqueue_new((GCompareDataFunc)_compare_values, NULL, NULL);
+
+    /* every producer pushes the same values, starting at different places */
+    ProducerArgs args[NUM_PRODUCERS];
+    for(gint i = 0; i < NUM_PRODUCERS; i++) {
+        args[i].q = q;
+        args[i].values = values;
+        args[i].numValues = NUM_PER_PRODUCER;
+        args[i].offset = i * (NUM_PER_PRODUCER / NUM_PRODUCERS);
+    }
+    _run_producers(args);
+
+    /* only the first push of each value adds it */
+    gint numAdded = 0;
+    for(gint i = 0; i < NUM_PRODUCERS; i++) {
+        numAdded += args[i].numAdded;
+    }
+    g_assert_cmpint(numAdded, ==, NUM_PER_PRODUCER);
+    g_assert_cmpint(asyncpriorityqueue_getLength(q), ==, NUM_PER_PRODUCER);
+    g_assert_true(asyncpriorityqueue_peek(q) == &values[0]);
+
+    /* pushing a queued value again does not add it */
+    g_assert_false(asyncpriorityqueue_push(q, &values[1]));
+    g_assert_cmpint(asyncpriorityqueue_getLength(q), ==, NUM_PER_PRODUCER);
+    g_assert_cmpint(_pop_in_order(q), ==, NUM_PER_PRODUCER);
+
+    asyncpriorityqueue_free(q);
+    g_free(values);
+}
+
+static void _test_concurrent_pop(void) {
+    const gint numValues = NUM_PRODUCERS * NUM_PER_PRODUCER;
+    gint* values = _new_values(numValues);
+    gboolean* seen = g_new0(gboolean, numValues);
+    AsyncPriorityQueue* q = asyncpriorityqueue_new((GCompareDataFunc)_compare_values, NULL, NULL);
+
+    ProducerArgs args[NUM_PRODUCERS];
+    pthread_t threads[NUM_PRODUCERS];
+    for(gint i = 0; i < NUM_PRODUCERS; i++) {
+        args[i].q = q;
+        args[i].values = &values[i * NUM_PER_PRODUCER];
+        args[i].numValues = NUM_PER_PRODUCER;
+        args[i].offset = 0;
+        g_assert_cmpint(pthread_create(&threads[i], NULL, _push_values, &args[i]), ==, 0);
+    }
+
+    /* pop while the producers push; every value must come out exactly once */
+    gint numPopped = 0;
+    while(numPopped < numValues) {
+        gint* value = asyncpriorityqueue_pop(q);
+        if(value) {
+            g_assert_false(seen[*value]);
+            seen[*value] = TRUE;
+            numPopped++;
+        }
+    }
+
+    for(gint i = 0; i < NUM_PRODUCERS; i++) {
+        g_assert_cmpint(pthread_join(threads[i], NULL), ==, 0);
+    }
+
+    g_assert_null(asyncpriorityqueue_pop(q));
+    g_assert_true(asyncpriorityqueue_isEmpty(q));
+
+    asyncpriorityqueue_free(q);
+    g_free(seen);
+    g_free(values);
+}
+
+int main(int argc, char* argv[]) {
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/async_priority_queue/distinct", _test_distinct);
+    g_test_add_func("/async_priority_queue/duplicates", _test_duplicates);
+    g_test_add_func("/async_priority_queue/concurrent_pop", _test_concurrent_pop);
+    g_test_run();
+    return 0;
+}